@@ -0,0 +1,112 @@
+#include "bench.hpp"
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+namespace bench {
+Settings& settings() {
+    static Settings value;
+    return value;
+}
+
+std::vector<Result>& results() {
+    static std::vector<Result> value;
+    return value;
+}
+
+bool selected(const std::string& name) {
+    return settings().filter.empty() || name.find(settings().filter) != std::string::npos;
+}
+
+bool selected_any(const std::string& prefix, std::initializer_list<const char*> names) {
+    return std::any_of(names.begin(), names.end(), [&](const char* name) { return selected(prefix + name); });
+}
+
+namespace {
+size_t failure_count = 0;
+}
+
+void fail(const std::string& what) {
+    failure_count++;
+    std::cerr << "FAILED: " << what << '\n';
+}
+
+size_t failures() {
+    return failure_count;
+}
+
+void summarize(Result& result, std::vector<double>& sample_us) {
+    result.samples = sample_us.size();
+    if (sample_us.empty()) {
+        return;
+    }
+    std::sort(sample_us.begin(), sample_us.end());
+    const auto at = [&](double p) { return sample_us[static_cast<size_t>(p * (sample_us.size() - 1) + 0.5)]; };
+    result.min_us = sample_us.front();
+    result.p50_us = at(0.5);
+    result.p90_us = at(0.9);
+    result.p99_us = at(0.99);
+    result.max_us = sample_us.back();
+}
+
+namespace {
+std::string escaped(const std::string& text) {
+    std::string out;
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+std::string compiler() {
+#if defined(__VERSION__)
+    return __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+// JSON has no infinity, a benchmark too fast for the clock says 0
+double finite(double value) {
+    return std::isfinite(value) ? value : 0.0;
+}
+}
+
+bool write_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+    out << "{\n";
+    out << "  \"context\": {\"compiler\": \"" << escaped(compiler()) << "\", \"build\": \"" << build
+        << "\", \"threads\": " << std::thread::hardware_concurrency() << "},\n";
+    out << "  \"benchmarks\": [\n";
+    const auto& all = results();
+    for (size_t i = 0; i < all.size(); i++) {
+        const auto& r = all[i];
+        out << "    {\"name\": \"" << escaped(r.name) << "\", \"iterations\": " << r.iterations
+            << ", \"seconds\": " << r.seconds
+            << ", \"us_per_op\": " << finite(r.microseconds_each())
+            << ", \"ops_per_second\": " << finite(r.per_second())
+            << ", \"samples\": " << r.samples
+            << ", \"min_us\": " << r.min_us
+            << ", \"p50_us\": " << r.p50_us
+            << ", \"p90_us\": " << r.p90_us
+            << ", \"p99_us\": " << r.p99_us
+            << ", \"max_us\": " << r.max_us << "}"
+            << (i + 1 < all.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+}
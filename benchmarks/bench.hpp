@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+// A tiny benchmarking helper, so that benchmarks don't need any external library
+namespace bench {
+    // Keeps the compiler from optimizing away results that are otherwise unused
+    template <typename T>
+    void consume(const T& value) {
+        static volatile char sink;
+        sink = *reinterpret_cast<const volatile char*>(&value);
+        (void)sink;
+    }
+
+    struct Result {
+        std::string name;
+        // the ones that were measured, without the warmup
+        size_t iterations;
+        double seconds;
+        // time per iteration, over the samples
+        double min_us = 0.0;
+        double p50_us = 0.0;
+        double p90_us = 0.0;
+        double p99_us = 0.0;
+        double max_us = 0.0;
+        size_t samples = 0;
+
+        double per_second() const { return iterations / seconds; }
+        double microseconds_each() const { return seconds * 1e6 / iterations; }
+    };
+
+    struct Settings {
+        // the iterations are timed in up to this many samples, for the percentiles
+        size_t max_samples = 50;
+        // the first samples warm up the caches and the branch predictors, and aren't counted
+        double warmup_fraction = 0.1;
+        // only benchmarks with this in their name run, all of them if it's empty
+        std::string filter;
+    };
+
+    Settings& settings();
+    // Everything that ran so far, in order
+    std::vector<Result>& results();
+    bool selected(const std::string& name);
+    // True if any of prefix + name would run. Benchmarks with an expensive setup (a big map, a hierarchy) check this
+    // first, so that a --filter for something else doesn't wait for it
+    bool selected_any(const std::string& prefix, std::initializer_list<const char*> names);
+    // For benchmarks that check their results too: says what's wrong, and the run ends with a nonzero exit code
+    void fail(const std::string& what);
+    size_t failures();
+    void summarize(Result& result, std::vector<double>& sample_us);
+    // Writes the results as JSON, for comparing builds. False if the file couldn't be written
+    bool write_json(const std::string& path);
+
+    // Calls fn(i) for i in 0..iterations, and reports the time it took. fn is called exactly once for every i, in
+    // order - benchmarks can keep state between the calls. The calls are timed in batches (samples), the ones at the
+    // start are the warmup. A benchmark that the filter skips isn't called at all, and its result has 0 iterations -
+    // anything computed from the times has to check for that
+    template <typename F>
+    Result run(const std::string& name, size_t iterations, F&& fn) {
+        if (!selected(name) || iterations == 0) {
+            return Result{name, 0, 0.0};
+        }
+        const size_t samples = std::min(iterations, std::max<size_t>(settings().max_samples, 1));
+        const size_t warmup = samples >= 10 ? static_cast<size_t>(samples * settings().warmup_fraction) : 0;
+
+        Result result{name, 0, 0.0};
+        std::vector<double> sample_us;
+        sample_us.reserve(samples);
+        size_t i = 0;
+        for (size_t sample = 0; sample < samples; sample++) {
+            const size_t end = iterations * (sample + 1) / samples;
+            const auto start = std::chrono::steady_clock::now();
+            for (; i < end; i++) {
+                fn(i);
+            }
+            const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+            const size_t count = end - iterations * sample / samples;
+            if (sample < warmup || count == 0) continue;
+            result.iterations += count;
+            result.seconds += took.count();
+            sample_us.push_back(took.count() * 1e6 / count);
+        }
+        summarize(result, sample_us);
+        std::cout << name << ": " << result.microseconds_each() << " us/op, " << result.per_second() << " ops/s";
+        if (result.samples > 1) {
+            std::cout << " (p50 " << result.p50_us << ", p90 " << result.p90_us << ", p99 " << result.p99_us << " us over " << result.samples << " samples)";
+        }
+        std::cout << "\n";
+        results().push_back(result);
+        return result;
+    }
+};
@@ -0,0 +1,54 @@
+#include "bench.hpp"
+#include "bench_maps.hpp"
+#include "flow_field.hpp"
+
+namespace {
+void flow_field_on(int width, int height, size_t units) {
+    const auto size = std::to_string(width) + "x" + std::to_string(height);
+    JobSystem jobs(JobSystem::workers_from_environment());
+    const auto threaded = "generate_" + std::to_string(jobs.worker_count() + 1) + "_threads";
+    if (!bench::selected_any("flow_field/" + size + "/", {"generate_1_thread", threaded.c_str(), "generate_within_60", "astar_per_unit", "follow_per_unit"})) {
+        return;
+    }
+    const auto world = bench::generate_map(width, height, 1234);
+    const Pathfinder pathfinder(bench::bench_movement_costs());
+    const auto target = bench::passable_tiles(world, 1, 5).front();
+    const std::vector<int> targets = {world.wrapped_index(target.q, target.r)};
+    FlowField field;
+
+    // the result is the same for any number of threads, only the time changes
+    FlowFieldGenerator generator(pathfinder);
+    bench::run("flow_field/" + size + "/generate_1_thread", 5, [&](size_t) {
+        generator.generate(world, targets, FlowField::NO_COST, field);
+    });
+    generator.set_jobs(&jobs);
+    bench::run("flow_field/" + size + "/" + threaded, 5, [&](size_t) {
+        generator.generate(world, targets, FlowField::NO_COST, field);
+    });
+    // what the AI would use to look around a city
+    bench::run("flow_field/" + size + "/generate_within_60", 100, [&](size_t) {
+        generator.generate(world, targets, 60, field);
+    });
+    generator.generate(world, targets, FlowField::NO_COST, field);
+
+    // a group of units sent to the same place - one field against a search for every unit
+    const auto from = bench::passable_tiles(world, units, 6);
+    std::vector<HexCoords> path;
+    bench::run("flow_field/" + size + "/astar_per_unit", units, [&](size_t i) {
+        bench::consume(pathfinder.find_path(world, from[i], target, path));
+    });
+    size_t steps = 0;
+    const auto followed = bench::run("flow_field/" + size + "/follow_per_unit", units, [&](size_t i) {
+        field.follow(world, from[i], path);
+        steps += path.size();
+    });
+    if (followed.iterations > 0) {
+        std::cout << "    " << steps / units << " steps per unit\n";
+    }
+}
+}
+
+void flow_field_benchmarks() {
+    flow_field_on(256, 256, 1000);
+    flow_field_on(1024, 1024, 100);
+}
@@ -0,0 +1,155 @@
+#include <unordered_map>
+#include <random>
+#include "bench.hpp"
+#include "hex.hpp"
+#include "flat_hash_map.hpp"
+
+namespace {
+constexpr int WORLD_SIZE = 1024;
+constexpr int LOOKUP_ROUNDS = 20;
+
+// what std::hash<HexCoords> used to be - q and r put side by side, and no mixing after that
+struct OldHexHash {
+    size_t operator()(const HexCoords& hc) const noexcept {
+        const uint64_t whole = (static_cast<uint64_t>(static_cast<uint32_t>(hc.r)) << 32) | static_cast<uint32_t>(hc.q);
+        return std::hash<size_t>()(whole);
+    }
+};
+
+struct KeySet {
+    std::string name;
+    std::vector<HexCoords> keys;
+    // same kind of keys, none of them in keys
+    std::vector<HexCoords> misses;
+};
+
+std::vector<HexCoords> unique_of(std::vector<HexCoords> keys) {
+    std::sort(keys.begin(), keys.end(), [](auto a, auto b) { return std::pair(a.r, a.q) < std::pair(b.r, b.q); });
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+// what systems actually put into hex keyed containers
+std::vector<KeySet> make_key_sets() {
+    std::mt19937 rng(32);
+    std::vector<KeySet> sets;
+
+    // everything a unit sees, or the camera covers
+    const auto center = HexCoords::from_axial(500, 400);
+    sets.push_back({"visible_block", center.spiral_around(30), (center + HexCoords::from_axial(100, 0)).spiral_around(30)});
+
+    // units gathered around a few cities
+    std::normal_distribution<float> spread(0.0f, 12.0f);
+    std::uniform_int_distribution<int> coord(0, WORLD_SIZE - 1);
+    const auto clustered = [&](size_t count) {
+        std::vector<HexCoords> cities(24);
+        for (auto& city : cities) city = HexCoords::from_axial(coord(rng), coord(rng));
+        std::vector<HexCoords> keys;
+        for (size_t i = 0; i < count; i++) {
+            const auto& city = cities[i % cities.size()];
+            keys.push_back(HexCoords::from_axial(
+                positive_modulo(city.q + static_cast<int>(spread(rng)), WORLD_SIZE),
+                std::clamp(city.r + static_cast<int>(spread(rng)), 0, WORLD_SIZE - 1)
+            ));
+        }
+        return unique_of(keys);
+    };
+    auto units = clustered(20000);
+    auto other_units = clustered(20000);
+    std::erase_if(other_units, [&](auto hc) { return std::binary_search(units.begin(), units.end(), hc, [](auto a, auto b) { return std::pair(a.r, a.q) < std::pair(b.r, b.q); }); });
+    sets.push_back({"clustered_units", units, other_units});
+
+    // paths across the map
+    const auto lines = [&](int count) {
+        std::vector<HexCoords> keys;
+        for (int i = 0; i < count; i++) {
+            const auto line = HexCoords::make_line(HexCoords::from_axial(coord(rng) / 2, coord(rng)), HexCoords::from_axial(coord(rng) / 2, coord(rng)));
+            keys.insert(keys.end(), line.begin(), line.end());
+        }
+        return unique_of(keys);
+    };
+    auto paths = lines(40);
+    auto other_paths = lines(40);
+    std::erase_if(other_paths, [&](auto hc) { return std::binary_search(paths.begin(), paths.end(), hc, [](auto a, auto b) { return std::pair(a.r, a.q) < std::pair(b.r, b.q); }); });
+    sets.push_back({"path_lines", paths, other_paths});
+
+    for (auto& set : sets) {
+        std::shuffle(set.keys.begin(), set.keys.end(), rng);
+        std::shuffle(set.misses.begin(), set.misses.end(), rng);
+    }
+    return sets;
+}
+
+template <typename Map, typename ToKey>
+void map_benchmarks(const std::string& name, const KeySet& set, ToKey to_key) {
+    const auto prefix = name + "/" + set.name + "/";
+    if (!bench::selected_any(prefix, {"insert", "find_hit", "find_miss", "erase"})) {
+        return;
+    }
+    Map map;
+    const auto insert = [&](size_t) {
+        map = Map{};
+        for (size_t i = 0; i < set.keys.size(); i++) {
+            map[to_key(set.keys[i])] = static_cast<int>(i);
+        }
+    };
+    // find_hit expects every key to be there
+    if (bench::run(prefix + "insert", LOOKUP_ROUNDS, insert).iterations == 0) {
+        insert(0);
+    }
+    long sum = 0;
+    bench::run(prefix + "find_hit", LOOKUP_ROUNDS, [&](size_t) {
+        for (const auto hc : set.keys) {
+            const auto it = map.find(to_key(hc));
+            if constexpr (std::is_pointer_v<decltype(it)>) {
+                sum += *it;
+            } else {
+                sum += it->second;
+            }
+        }
+    });
+    bench::run(prefix + "find_miss", LOOKUP_ROUNDS, [&](size_t) {
+        for (const auto hc : set.misses) {
+            sum += map.contains(to_key(hc));
+        }
+    });
+    bench::run(prefix + "erase", 1, [&](size_t) {
+        for (const auto hc : set.keys) {
+            sum += map.erase(to_key(hc));
+        }
+    });
+    bench::consume(sum);
+}
+
+// How evenly the hash spreads keys over a table of the size a std::unordered_map would use for them
+template <typename Hash>
+void report_bucket_spread(const std::string& name, const KeySet& set) {
+    if (!bench::selected(name + "/" + set.name + "/buckets")) {
+        return;
+    }
+    std::unordered_map<HexCoords, int, Hash> map(set.keys.size());
+    for (const auto hc : set.keys) map[hc] = 0;
+    size_t used = 0;
+    size_t longest = 0;
+    for (size_t b = 0; b < map.bucket_count(); b++) {
+        used += map.bucket_size(b) > 0;
+        longest = std::max(longest, map.bucket_size(b));
+    }
+    std::cout << name << "/" << set.name << "/buckets: " << set.keys.size() << " keys in " << used
+              << " of " << map.bucket_count() << " buckets, longest " << longest << "\n";
+}
+}
+
+void hash_benchmarks() {
+    const auto sets = make_key_sets();
+    const auto same = [](HexCoords hc) { return hc; };
+    const auto packed = [](HexCoords hc) { return HexKey::from(hc); };
+    for (const auto& set : sets) {
+        report_bucket_spread<OldHexHash>("hash/old", set);
+        report_bucket_spread<std::hash<HexCoords>>("hash/mixed", set);
+        map_benchmarks<std::unordered_map<HexCoords, int, OldHexHash>>("unordered_map/old_hash", set, same);
+        map_benchmarks<std::unordered_map<HexCoords, int>>("unordered_map", set, same);
+        map_benchmarks<std::unordered_map<HexKey, int>>("unordered_map/hex_key", set, packed);
+        map_benchmarks<FlatHashMap<HexKey, int>>("flat_hash_map/hex_key", set, packed);
+    }
+}
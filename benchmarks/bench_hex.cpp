@@ -0,0 +1,124 @@
+#include <random>
+#include "bench.hpp"
+#include "hex.hpp"
+#include "hex_batch.hpp"
+
+namespace {
+constexpr int REPEATS = 10000;
+}
+
+void hex_benchmarks() {
+    std::mt19937 rng(33);
+    std::uniform_int_distribution<int> coord(0, 1023);
+    std::vector<HexCoords> centers(256);
+    for (auto& hc : centers) hc = HexCoords::from_axial(coord(rng), coord(rng));
+
+    long sum = 0;
+    bench::run("hex/distance", REPEATS * 100, [&](size_t i) {
+        sum += centers[i % centers.size()].distance(centers[(i + 1) % centers.size()]);
+    });
+    bench::run("hex/neighbours", REPEATS * 100, [&](size_t i) {
+        for (const auto hc : centers[i % centers.size()].neighbours()) sum += hc.q;
+    });
+    std::uniform_real_distribution<float> position(-2000.0f, 2000.0f);
+    std::vector<std::pair<float, float>> points(1024);
+    for (auto& [x, y] : points) {
+        x = position(rng);
+        y = position(rng);
+    }
+    bench::run("hex/from_world_unscaled", REPEATS * 100, [&](size_t i) {
+        const auto [x, y] = points[i % points.size()];
+        sum += HexCoords::from_world_unscaled(x, y).q;
+    });
+    bench::run("hex/to_world_unscaled", REPEATS * 100, [&](size_t i) {
+        sum += static_cast<long>(centers[i % centers.size()].to_world_unscaled().first);
+    });
+
+    // a unit's sight, and something wider than the offset table
+    for (const int range : {3, 8, 24}) {
+        const auto suffix = "_" + std::to_string(range);
+        bench::run("hex/spiral_around" + suffix, REPEATS, [&](size_t i) {
+            for (const auto hc : centers[i % centers.size()].spiral_around(range)) sum += hc.q;
+        });
+        bench::run("hex/spiral" + suffix, REPEATS, [&](size_t i) {
+            for (const auto hc : centers[i % centers.size()].spiral(range)) sum += hc.q;
+        });
+    }
+    bench::run("hex/ring_around_8", REPEATS, [&](size_t i) {
+        for (const auto hc : centers[i % centers.size()].ring_around(8)) sum += hc.q;
+    });
+    bench::run("hex/ring_8", REPEATS, [&](size_t i) {
+        for (const auto hc : centers[i % centers.size()].ring(8)) sum += hc.q;
+    });
+    bench::run("hex/make_line", REPEATS, [&](size_t i) {
+        for (const auto hc : HexCoords::make_line(centers[i % centers.size()], centers[(i + 1) % centers.size()])) sum += hc.q;
+    });
+    bench::run("hex/line", REPEATS, [&](size_t i) {
+        for (const auto hc : HexCoords::line(centers[i % centers.size()], centers[(i + 1) % centers.size()])) sum += hc.q;
+    });
+    bench::consume(sum);
+}
+
+void hex_batch_benchmarks() {
+    constexpr size_t POINT_COUNT = 1 << 16;
+    std::mt19937 rng(34);
+    std::uniform_real_distribution<float> position(-2000.0f, 2000.0f);
+    std::vector<float> xs(POINT_COUNT), ys(POINT_COUNT);
+    for (size_t i = 0; i < POINT_COUNT; i++) {
+        xs[i] = position(rng);
+        ys[i] = position(rng);
+    }
+    // the places where rounding can go either way - hex centers, edges and corners
+    for (size_t i = 0; i < POINT_COUNT / 4; i++) {
+        const auto hc = HexCoords::from_axial(static_cast<int>(position(rng)) / 4, static_cast<int>(position(rng)) / 4);
+        const auto [cx, cy] = hc.to_world_unscaled();
+        const auto [dq, dr] = axial_directions[i % 6];
+        const auto [nx, ny] = HexCoords::from_axial(hc.q + dq, hc.r + dr).to_world_unscaled();
+        const float t = (i / 6) % 3 == 0 ? 0.0f : (i / 6) % 3 == 1 ? 0.5f : 2.0f / 3.0f;
+        xs[i] = cx + (nx - cx) * t;
+        ys[i] = cy + (ny - cy) * t;
+    }
+
+    std::vector<HexCoords> expected(POINT_COUNT), hexes(POINT_COUNT);
+    std::vector<float> expected_xs(POINT_COUNT), expected_ys(POINT_COUNT), back_xs(POINT_COUNT), back_ys(POINT_COUNT);
+    for (size_t i = 0; i < POINT_COUNT; i++) {
+        expected[i] = HexCoords::from_world_unscaled(xs[i], ys[i]);
+        std::tie(expected_xs[i], expected_ys[i]) = expected[i].to_world_unscaled();
+    }
+
+    const auto best = hex_batch_kernel();
+    for (const auto kernel : {HexBatchKernel::Scalar, HexBatchKernel::SSE2, HexBatchKernel::AVX2}) {
+        const std::string name = std::string("hex_batch/") + hex_batch_kernel_name(kernel);
+        if (!bench::selected_any(name + "/", {"from_world_64k", "to_world_64k"})) {
+            continue;
+        }
+        if (set_hex_batch_kernel(kernel) != kernel) {
+            std::cout << name << ": not supported here\n";
+            continue;
+        }
+        // an odd count, so that the scalar tail is checked too
+        const size_t count = POINT_COUNT - 3;
+        hexes_from_world_unscaled(std::span(xs).first(count), std::span(ys).first(count), hexes);
+        hexes_to_world_unscaled(std::span(expected).first(count), back_xs, back_ys);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < count; i++) {
+            mismatches += !(hexes[i] == expected[i]);
+            mismatches += back_xs[i] != expected_xs[i] || back_ys[i] != expected_ys[i];
+        }
+        if (mismatches == 0) {
+            std::cout << name << "/exact: yes\n";
+        } else {
+            bench::fail(name + " doesn't match the scalar conversions, " + std::to_string(mismatches) + " differ");
+        }
+
+        bench::run(name + "/from_world_64k", 100, [&](size_t) {
+            hexes_from_world_unscaled(xs, ys, hexes);
+        });
+        bench::run(name + "/to_world_64k", 100, [&](size_t) {
+            hexes_to_world_unscaled(expected, back_xs, back_ys);
+        });
+        bench::consume(hexes[POINT_COUNT / 2]);
+        bench::consume(back_xs[POINT_COUNT / 2]);
+    }
+    set_hex_batch_kernel(best);
+}
@@ -0,0 +1,81 @@
+#include "bench.hpp"
+#include "bench_maps.hpp"
+#include "hierarchical_pathfinding.hpp"
+
+namespace {
+void hierarchical_on(int width, int height, size_t queries) {
+    const auto size = std::to_string(width) + "x" + std::to_string(height);
+    if (!bench::selected_any("hpa/" + size + "/", {"build", "flat_astar", "abstract_only", "abstract_and_first_segment", "fully_refined", "rebuild_one_chunk"})) {
+        return;
+    }
+    auto world = bench::generate_map(width, height, 1234);
+    const Pathfinder pathfinder(bench::bench_movement_costs());
+    HierarchicalPathfinder hierarchical(pathfinder);
+
+    // everything after this needs the hierarchy, filtered out or not
+    if (bench::run("hpa/" + size + "/build", 1, [&](size_t) { hierarchical.rebuild(world); }).iterations == 0) {
+        hierarchical.rebuild(world);
+    }
+    std::cout << "    " << hierarchical.entrance_count() << " entrances\n";
+
+    const auto from = bench::passable_tiles(world, queries, 1);
+    const auto to = bench::passable_tiles(world, queries, 2);
+    std::vector<int> flat_costs(queries, -1);
+    std::vector<HexCoords> path;
+
+    const auto find_flat = [&](size_t i) {
+        const auto result = pathfinder.find_path(world, from[i], to[i], path);
+        flat_costs[i] = result.found ? result.cost : -1;
+    };
+    // fully_refined is checked against these
+    if (bench::run("hpa/" + size + "/flat_astar", queries, find_flat).iterations == 0 && bench::selected("hpa/" + size + "/fully_refined")) {
+        for (size_t i = 0; i < queries; i++) find_flat(i);
+    }
+    bench::run("hpa/" + size + "/abstract_only", queries, [&](size_t i) {
+        bench::consume(hierarchical.find_abstract_path(world, from[i], to[i], path));
+    });
+    // what a unit needs to start walking - the route and its first leg
+    std::vector<HexCoords> first_leg;
+    bench::run("hpa/" + size + "/abstract_and_first_segment", queries, [&](size_t i) {
+        const auto result = hierarchical.find_abstract_path(world, from[i], to[i], path);
+        if (result.found && path.size() > 1) {
+            bench::consume(hierarchical.refine_segment(world, path, 0, first_leg));
+        }
+    });
+
+    double cost_ratio = 0.0;
+    size_t compared = 0;
+    size_t missed = 0;
+    const auto refined = bench::run("hpa/" + size + "/fully_refined", queries, [&](size_t i) {
+        const auto result = hierarchical.find_path(world, from[i], to[i], path);
+        if (flat_costs[i] < 0) return;
+        if (!result.found) {
+            missed++;
+            return;
+        }
+        cost_ratio += static_cast<double>(result.cost) / std::max(1, flat_costs[i]);
+        compared++;
+    });
+    if (refined.iterations > 0) {
+        std::cout << "    path cost vs A*: " << cost_ratio / std::max<size_t>(1, compared) << "x on average, " << missed << " paths missed\n";
+    }
+    // the abstraction has to find every path A* finds, if only a longer one
+    if (missed > 0) {
+        bench::fail("hpa/" + size + ": " + std::to_string(missed) + " paths that A* found were missed");
+    }
+
+    // a change in a single chunk only rebuilds the chunk and the ones around it
+    bench::run("hpa/" + size + "/rebuild_one_chunk", 100, [&](size_t i) {
+        const auto hc = from[i % from.size()];
+        auto& tile = world.at_ref_normalized(hc);
+        tile.tileid = tile.tileid == bench::Mountain ? bench::Grass : bench::Mountain;
+        hierarchical.mark_changed(world, hc);
+        hierarchical.update(world);
+    });
+}
+}
+
+void hierarchical_pathfinding_benchmarks() {
+    hierarchical_on(256, 256, 500);
+    hierarchical_on(1024, 1024, 100);
+}
@@ -0,0 +1,71 @@
+#include <thread>
+#include "bench.hpp"
+#include "bench_maps.hpp"
+#include "job_system.hpp"
+
+namespace {
+// some work per tile, about what generating a tile would cost
+uint32_t churn(const HexData& hx, int index) {
+    uint32_t h = static_cast<uint32_t>(index) * 2654435761u + static_cast<uint32_t>(hx.tileid);
+    for (int i = 0; i < 16; i++) {
+        h ^= h >> 15;
+        h *= 2246822519u;
+        h ^= h >> 13;
+    }
+    return h;
+}
+
+void jobs_with(int workers, const CylinderHexWorld<HexData>& world) {
+    JobSystem jobs(workers);
+    const auto threads = "_" + std::to_string(jobs.worker_count() + 1) + "_threads";
+
+    bench::run("jobs/submit_and_wait" + threads, 10000, [&](size_t) {
+        jobs.wait(jobs.submit([] {}));
+    });
+
+    // one job fanning out to many, and one after all of them
+    bench::run("jobs/graph_64_wide" + threads, 1000, [&](size_t) {
+        std::atomic<int> sum{0};
+        const auto start = jobs.submit([] {});
+        std::vector<JobSystem::Handle> middle;
+        for (int i = 0; i < 64; i++) {
+            middle.push_back(jobs.submit([&sum, i] { sum += i; }, {start}));
+        }
+        jobs.wait(jobs.submit([] {}, middle));
+        bench::consume(sum.load());
+    });
+
+    std::vector<uint32_t> per_chunk(world.chunk_count());
+    bench::run("jobs/for_each_chunk_" + std::to_string(world.width) + threads, 20, [&](size_t) {
+        jobs.for_each_chunk(world, [&](int chunk) {
+            const auto [origin, size] = world.chunk_bounds(chunk);
+            uint32_t h = 0;
+            for (int r = origin.r; r < origin.r + size.second; r++) {
+                for (int q = origin.q; q < origin.q + size.first; q++) {
+                    const int index = r * world.width + q;
+                    h += churn(world.data[index], index);
+                }
+            }
+            per_chunk[chunk] = h;
+        });
+        bench::consume(per_chunk[0]);
+    });
+}
+}
+
+void jobs_benchmarks() {
+    const auto world = bench::generate_map(1024, 1024, 99);
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    // how it scales, STRATGAME_THREADS adds a count of its own
+    std::vector<int> worker_counts = {1, 3, cores - 1};
+    if (const int configured = JobSystem::workers_from_environment(); configured > 0) {
+        worker_counts.push_back(configured);
+    }
+    std::sort(worker_counts.begin(), worker_counts.end());
+    worker_counts.erase(std::unique(worker_counts.begin(), worker_counts.end()), worker_counts.end());
+    for (const int workers : worker_counts) {
+        if (workers > 0) {
+            jobs_with(workers, world);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <random>
+#include <vector>
+#include <cstdint>
+#include "hex.hpp"
+
+// Generated worlds for benchmarks. Tiles follow smoothed noise, so there are
+// lakes, ridges and chokepoints, like in a real map, instead of uniform static
+namespace bench {
+    // Tile kinds used by generate_map, and their movement costs (0 means impassable)
+    enum BenchTile { Water = 0, Grass, Sand, Rocks, Mountain, BenchTileCount };
+    inline std::vector<int> bench_movement_costs() { return {0, 1, 1, 2, 3}; }
+    inline std::vector<int> bench_vision_costs() { return {1, 1, 1, 1, 3}; }
+
+    inline CylinderHexWorld<HexData> generate_map(int width, int height, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+        // two octaves of value noise, lattice wraps around in q like the world does
+        const auto make_lattice = [&](int cell) {
+            const int lw = (width + cell - 1) / cell;
+            const int lh = height / cell + 2;
+            std::vector<float> lattice(lw * lh);
+            for (auto& v : lattice) v = dist(rng);
+            return [=](int q, int r) {
+                const float fq = static_cast<float>(q) / cell;
+                const float fr = static_cast<float>(r) / cell;
+                const int q0 = static_cast<int>(fq);
+                const int r0 = static_cast<int>(fr);
+                const float tq = fq - q0;
+                const float tr = fr - r0;
+                const auto at = [&](int lq, int lr) { return lattice[lr * lw + lq % lw]; };
+                const float top = at(q0, r0) * (1 - tq) + at(q0 + 1, r0) * tq;
+                const float bottom = at(q0, r0 + 1) * (1 - tq) + at(q0 + 1, r0 + 1) * tq;
+                return top * (1 - tr) + bottom * tr;
+            };
+        };
+        const auto coarse = make_lattice(24);
+        const auto fine = make_lattice(5);
+
+        CylinderHexWorld<HexData> world(width, height, HexData{.tileid = Grass}, HexData{});
+        for (int r = 0; r < height; r++) {
+            for (int q = 0; q < width; q++) {
+                const float v = coarse(q, r) * 0.7f + fine(q, r) * 0.3f;
+                int tile = Grass;
+                if (v < 0.3f) tile = Water;
+                else if (v < 0.55f) tile = Grass;
+                else if (v < 0.62f) tile = Sand;
+                else if (v < 0.7f) tile = Rocks;
+                else tile = Mountain;
+                world.data[r * width + q].tileid = tile;
+            }
+        }
+        return world;
+    }
+
+    // Random tiles that units could stand on
+    inline std::vector<HexCoords> passable_tiles(const CylinderHexWorld<HexData>& world, size_t count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> pick(0, static_cast<int>(world.data.size()) - 1);
+        std::vector<HexCoords> result;
+        result.reserve(count);
+        while (result.size() < count) {
+            const int idx = pick(rng);
+            if (world.data[idx].tileid != Water) {
+                result.push_back(world.coords_of_index(idx));
+            }
+        }
+        return result;
+    }
+};
@@ -0,0 +1,36 @@
+#include <vector>
+#include "bench.hpp"
+#include "noise.hpp"
+#include "job_system.hpp"
+
+namespace {
+constexpr int WIDTH = 256;
+constexpr int HEIGHT = 128;
+}
+
+void noise_benchmarks() {
+    const noise::Source source(13);
+    double sum = 0.0;
+    for (const auto& [name, basis] : {std::pair{"perlin", noise::Basis::Perlin}, std::pair{"simplex", noise::Basis::Simplex}, std::pair{"value", noise::Basis::Value}}) {
+        bench::run(std::string("noise/") + name + "_sample", 1000000, [&](size_t i) {
+            sum += source.basis(basis, i * 0.013, i * 0.007, 0.5);
+        });
+    }
+
+    // what the default world generator asks for
+    const noise::Settings terrain{.basis = noise::Basis::Perlin, .fractal = noise::Fractal::FBm, .seed = 13, .octaves = 8, .frequency = 1.0};
+    std::vector<float> out(WIDTH * HEIGHT);
+    bench::run("noise/fill_fbm8_256x128", 10, [&](size_t) {
+        noise::fill(source, terrain, WIDTH, HEIGHT, true, out);
+    });
+    JobSystem jobs(JobSystem::workers_from_environment());
+    bench::run("noise/fill_fbm8_256x128_jobs", 10, [&](size_t) {
+        noise::fill(source, terrain, WIDTH, HEIGHT, true, out, &jobs);
+    });
+    const noise::Settings ridged{.basis = noise::Basis::Simplex, .fractal = noise::Fractal::Ridged, .seed = 13, .octaves = 6, .frequency = 2.0};
+    bench::run("noise/fill_ridged6_256x128_jobs", 10, [&](size_t) {
+        noise::fill(source, ridged, WIDTH, HEIGHT, true, out, &jobs);
+    });
+    bench::consume(sum);
+    bench::consume(out[0]);
+}
@@ -0,0 +1,71 @@
+#include "bench.hpp"
+#include "bench_maps.hpp"
+#include "pathfinding.hpp"
+#include "path_planner.hpp"
+
+namespace {
+void pathfinding_on(int width, int height, size_t long_queries, size_t short_queries) {
+    const auto size = std::to_string(width) + "x" + std::to_string(height);
+    if (!bench::selected_any("astar/" + size + "/", {"any_to_any", "short_range", "preview_from_scratch", "preview_incremental"})) {
+        return;
+    }
+    const auto world = bench::generate_map(width, height, 1234);
+    const Pathfinder pathfinder(bench::bench_movement_costs());
+    std::vector<HexCoords> path;
+
+    const auto run_queries = [&](const std::string& name, const std::vector<HexCoords>& from, const std::vector<HexCoords>& to) {
+        size_t found = 0;
+        size_t expanded = 0;
+        const auto result = bench::run(name, from.size(), [&](size_t i) {
+            const auto result = pathfinder.find_path(world, from[i], to[i], path);
+            found += result.found;
+            expanded += result.expanded;
+        });
+        if (result.iterations == 0) {
+            return;
+        }
+        std::cout << "    found " << found << "/" << from.size() << ", " << expanded / from.size() << " tiles expanded per query\n";
+    };
+
+    // anywhere to anywhere, the worst case for A*
+    const auto long_from = bench::passable_tiles(world, long_queries, 1);
+    const auto long_to = bench::passable_tiles(world, long_queries, 2);
+    run_queries("astar/" + size + "/any_to_any", long_from, long_to);
+
+    // orders a player would give, up to 20 tiles away
+    const auto short_from = bench::passable_tiles(world, short_queries, 3);
+    std::vector<HexCoords> short_to;
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<int> offset(-20, 20);
+    for (const auto from : short_from) {
+        auto to = from + HexCoords::from_axial(offset(rng), 0);
+        to.r = std::clamp(from.r + offset(rng), 0, height - 1);
+        to.s = -to.q - to.r;
+        short_to.push_back(to);
+    }
+    run_queries("astar/" + size + "/short_range", short_from, short_to);
+
+    // the path preview - the unit stays, the goal follows the mouse one hex at a time
+    const auto unit = short_from.front();
+    std::vector<HexCoords> goals = {unit + HexCoords::from_axial(15, 0)};
+    std::uniform_int_distribution<int> direction(0, 5);
+    while (goals.size() < short_queries) {
+        const auto [dq, dr] = axial_directions[direction(rng)];
+        auto next = goals.back() + HexCoords::from_axial(dq, dr);
+        if (next.r < 0 || next.r >= height || next.distance(unit) > 25) continue;
+        goals.push_back(next);
+    }
+    bench::run("astar/" + size + "/preview_from_scratch", goals.size(), [&](size_t i) {
+        bench::consume(pathfinder.find_path(world, unit, goals[i], path));
+    });
+    PathPlanner planner(pathfinder);
+    bench::run("astar/" + size + "/preview_incremental", goals.size(), [&](size_t i) {
+        bench::consume(planner.plan(world, unit, goals[i], path));
+    });
+}
+}
+
+void pathfinding_benchmarks() {
+    pathfinding_on(256, 256, 1000, 20000);
+    pathfinding_on(1024, 1024, 100, 20000);
+}
@@ -0,0 +1,97 @@
+#include <random>
+#include "bench.hpp"
+#include "bench_maps.hpp"
+#include "game_packets.hpp"
+
+namespace {
+// A whole world has to fit in one PacketWriter buffer (2 MB, 68 bytes per hex), so the worlds here stay small
+constexpr int SMALL_WORLD = 64;
+constexpr int LARGE_WORLD = 128;
+constexpr size_t READS = 1 << 18;
+
+void world_packet_benchmarks(const std::string& name, int size) {
+    if (!bench::selected_any("serialization/", {("world_serialize_" + name).c_str(), ("world_deserialize_" + name).c_str()})) {
+        return;
+    }
+    const WorldUpdatePacket packet{bench::generate_map(size, size, 13)};
+    const double megabytes = size * size * 68 / (1024.0 * 1024.0);
+
+    PacketWriter wr;
+    const auto serialize = [&](size_t) {
+        wr.len = 4;
+        packet.serialize(wr);
+    };
+    const auto written = bench::run("serialization/world_serialize_" + name, 20, serialize);
+    if (written.iterations > 0) {
+        std::cout << "  " << megabytes / (written.seconds / written.iterations) << " MB/s\n";
+    } else {
+        // deserializing needs the bytes anyway
+        serialize(0);
+    }
+
+    // in the game the reader gets the buffer from the connection, so copying it in is a part of reading a packet
+    std::vector<char> bytes(wr.buf->begin() + 4, wr.buf->begin() + wr.len);
+    int tiles = 0;
+    const auto read = bench::run("serialization/world_deserialize_" + name, 20, [&](size_t) {
+        PacketReader reader(bytes);
+        tiles += WorldUpdatePacket::deserialize(reader).world.width;
+    });
+    if (read.iterations > 0) {
+        std::cout << "  " << megabytes / (read.seconds / read.iterations) << " MB/s\n";
+    }
+    bench::consume(tiles);
+}
+}
+
+void serialization_benchmarks() {
+    const auto world = bench::generate_map(SMALL_WORLD, SMALL_WORLD, 7);
+    const size_t tiles = world.data.size();
+
+    PacketWriter wr;
+    const auto serialize = [&](size_t i) {
+        if (i % tiles == 0) wr.len = 4;
+        world.data[i % tiles].serialize(wr);
+    };
+    // hexdata_deserialize reads what this wrote
+    if (bench::run("serialization/hexdata_serialize", tiles * 64, serialize).iterations == 0) {
+        for (size_t i = 0; i < tiles; i++) serialize(i);
+    }
+    std::vector<char> hexes(wr.buf->begin() + 4, wr.buf->begin() + wr.len);
+    PacketReader hex_reader(hexes);
+    long sum = 0;
+    bench::run("serialization/hexdata_deserialize", tiles * 64, [&](size_t i) {
+        if (i % tiles == 0) hex_reader.idx = 0;
+        sum += HexData::deserialize(hex_reader).tileid;
+    });
+
+    world_packet_benchmarks("64x64", SMALL_WORLD);
+    world_packet_benchmarks("128x128", LARGE_WORLD);
+
+    // the reader's primitives on their own
+    std::mt19937 rng(5);
+    wr.len = 4;
+    for (size_t i = 0; i < READS; i++) wr.writeInt(static_cast<int>(rng()));
+    std::vector<char> ints(wr.buf->begin() + 4, wr.buf->begin() + wr.len);
+    PacketReader int_reader(ints);
+    bench::run("serialization/reader_int", READS * 8, [&](size_t i) {
+        if (i % READS == 0) int_reader.idx = 0;
+        sum += int_reader.readInt();
+    });
+
+    wr.len = 4;
+    size_t strings = 0;
+    while (wr.len + 64 < BUFFER_SIZE && strings < READS) {
+        wr.writeString("unit_" + std::to_string(strings++));
+    }
+    std::vector<char> text(wr.buf->begin() + 4, wr.buf->begin() + wr.len);
+    PacketReader string_reader(text);
+    bench::run("serialization/reader_string", strings * 8, [&](size_t i) {
+        if (i % strings == 0) string_reader.idx = 0;
+        sum += static_cast<long>(string_reader.readString().size());
+    });
+    bench::run("serialization/reader_copy_1mb", 200, [&](size_t) {
+        PacketReader reader(ints);
+        sum += reader.buf[reader.buf.size() - 1];
+    });
+    bench::consume(sum);
+}
@@ -0,0 +1,107 @@
+#include <unordered_map>
+#include "bench.hpp"
+#include "units.hpp"
+
+namespace {
+constexpr int WORLD_SIZE = 1024;
+constexpr size_t UNIT_COUNT = 100000;
+
+// what the store used to be, for comparison
+struct MapUnits {
+    std::optional<MilitaryUnit> military;
+    std::optional<CivilianUnit> civilian;
+    std::optional<SpecialUnit> special;
+};
+}
+
+void units_benchmarks() {
+    if (!bench::selected_any("units/", {"store/place_100k", "store/move_100k", "unordered_map/move_100k", "store/query_1M", "unordered_map/query_1M",
+                                        "store/iterate_100k", "store/iterate_with_positions_100k", "unordered_map/iterate_100k"})) {
+        return;
+    }
+    std::mt19937 rng(77);
+    std::uniform_int_distribution<int> coord(0, WORLD_SIZE - 1);
+    std::uniform_int_distribution<int> direction(0, 5);
+    const auto random_hex = [&]() { return HexCoords::from_axial(coord(rng), coord(rng)); };
+
+    UnitStore store(WORLD_SIZE, WORLD_SIZE);
+    std::unordered_map<HexCoords, MapUnits> map_store;
+    std::vector<UnitHandle> handles;
+    std::vector<HexCoords> map_positions;
+    handles.reserve(UNIT_COUNT);
+    const auto place = [&](size_t) {
+        while (handles.size() < UNIT_COUNT) {
+            const auto hc = random_hex();
+            if (const auto handle = store.put_unit_on_hex(hc, MilitaryUnit{{.id = static_cast<int>(handles.size()), .fraction = 0, .health = 100}})) {
+                handles.push_back(*handle);
+                map_store[hc].military = MilitaryUnit{{.id = static_cast<int>(handles.size()), .fraction = 0, .health = 100}};
+                map_positions.push_back(hc);
+            }
+        }
+    };
+    // the rest need the units, filtered out or not
+    if (bench::run("units/store/place_100k", 1, place).iterations == 0) {
+        place(0);
+    }
+
+    // every unit takes a step, if the tile is free
+    bench::run("units/store/move_100k", 10, [&](size_t) {
+        for (const auto handle : handles) {
+            const auto [dq, dr] = axial_directions[direction(rng)];
+            const auto to = *store.position_of(handle) + HexCoords::from_axial(dq, dr);
+            if (!store.occupied(store.tile_index(to), UnitType::Millitary)) {
+                store.move_unit(handle, to);
+            }
+        }
+    });
+    bench::run("units/unordered_map/move_100k", 10, [&](size_t) {
+        for (auto& from : map_positions) {
+            const auto [dq, dr] = axial_directions[direction(rng)];
+            auto to = from + HexCoords::from_axial(dq, dr);
+            to.q = positive_modulo(to.q, WORLD_SIZE);
+            to.s = -to.q - to.r;
+            if (to.r < 0 || to.r >= WORLD_SIZE) continue;
+            auto it = map_store.find(to);
+            if (it != map_store.end() && it->second.military.has_value()) continue;
+            auto& source = map_store[from];
+            map_store[to].military = source.military;
+            source.military.reset();
+            from = to;
+        }
+    });
+
+    // random tiles, mostly empty, like the render loop looking at every visible tile
+    std::vector<HexCoords> queries(1000000);
+    for (auto& hc : queries) hc = random_hex();
+    size_t found = 0;
+    bench::run("units/store/query_1M", 1, [&](size_t) {
+        for (const auto hc : queries) {
+            found += store.get_all_on_hex(hc).has_any();
+        }
+    });
+    bench::consume(found);
+    bench::run("units/unordered_map/query_1M", 1, [&](size_t) {
+        for (const auto hc : queries) {
+            const auto it = map_store.find(hc);
+            found += it != map_store.end() && it->second.military.has_value();
+        }
+    });
+    bench::consume(found);
+
+    long health = 0;
+    bench::run("units/store/iterate_100k", 100, [&](size_t) {
+        for (const auto& unit : store.units_of<UnitType::Millitary>()) {
+            health += unit.health;
+        }
+    });
+    bench::run("units/store/iterate_with_positions_100k", 100, [&](size_t) {
+        store.for_each_unit([&](HexCoords hc, const BaseUnitData& unit) { health += hc.q + unit.health; });
+    });
+    bench::run("units/unordered_map/iterate_100k", 100, [&](size_t) {
+        for (const auto& [hc, on_tile] : map_store) {
+            if (on_tile.military.has_value()) health += on_tile.military->health;
+        }
+    });
+    bench::consume(health);
+    std::cout << "    unordered_map holds " << map_store.size() << " entries for " << UNIT_COUNT << " units\n";
+}
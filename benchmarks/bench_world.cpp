@@ -0,0 +1,75 @@
+#include <random>
+#include "bench.hpp"
+#include "bench_maps.hpp"
+
+namespace {
+constexpr int WIDTH = 1024;
+constexpr int HEIGHT = 512;
+constexpr size_t QUERIES = 1 << 16;
+}
+
+// The ways systems go over the world: all of it in order, chunk by chunk, random tiles, and around a tile
+void world_benchmarks() {
+    if (!bench::selected_any("world/", {"sweep_data", "sweep_at", "sweep_column_major", "sweep_chunks", "random_at",
+                                        "random_at_ref_normalized", "random_wrapped_index", "neighbours_at", "chunk_of", "write_random"})) {
+        return;
+    }
+    auto world = bench::generate_map(WIDTH, HEIGHT, 41);
+    long sum = 0;
+
+    bench::run("world/sweep_data", 20, [&](size_t) {
+        for (const auto& hx : world.data) sum += hx.tileid;
+    });
+    bench::run("world/sweep_at", 20, [&](size_t) {
+        for (int r = 0; r < HEIGHT; r++) {
+            for (int q = 0; q < WIDTH; q++) {
+                sum += world.at(HexCoords::from_axial(q, r)).tileid;
+            }
+        }
+    });
+    bench::run("world/sweep_column_major", 20, [&](size_t) {
+        for (int q = 0; q < WIDTH; q++) {
+            for (int r = 0; r < HEIGHT; r++) {
+                sum += world.data[r * WIDTH + q].tileid;
+            }
+        }
+    });
+    bench::run("world/sweep_chunks", 20, [&](size_t) {
+        for (int chunk = 0; chunk < world.chunk_count(); chunk++) {
+            const auto [origin, size] = world.chunk_bounds(chunk);
+            for (int r = origin.r; r < origin.r + size.second; r++) {
+                for (int q = origin.q; q < origin.q + size.first; q++) {
+                    sum += world.data[r * WIDTH + q].tileid;
+                }
+            }
+        }
+    });
+
+    // q goes past the seam of the cylinder now and then, like coordinates from the camera do
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> q_dist(-WIDTH / 4, WIDTH + WIDTH / 4);
+    std::uniform_int_distribution<int> r_dist(0, HEIGHT - 1);
+    std::vector<HexCoords> queries(QUERIES);
+    for (auto& hc : queries) hc = HexCoords::from_axial(q_dist(rng), r_dist(rng));
+
+    bench::run("world/random_at", QUERIES * 16, [&](size_t i) {
+        sum += world.at(queries[i % QUERIES]).tileid;
+    });
+    bench::run("world/random_at_ref_normalized", QUERIES * 16, [&](size_t i) {
+        sum += world.at_ref_normalized(queries[i % QUERIES]).tileid;
+    });
+    bench::run("world/random_wrapped_index", QUERIES * 16, [&](size_t i) {
+        const auto hc = queries[i % QUERIES];
+        sum += world.data[world.wrapped_index(hc.q, hc.r)].tileid;
+    });
+    bench::run("world/neighbours_at", QUERIES * 4, [&](size_t i) {
+        for (const auto n : queries[i % QUERIES].neighbours()) sum += world.at(n).tileid;
+    });
+    bench::run("world/chunk_of", QUERIES * 16, [&](size_t i) {
+        sum += world.chunk_of(world.normalized_coords(queries[i % QUERIES]));
+    });
+    bench::run("world/write_random", QUERIES * 16, [&](size_t i) {
+        world.at_ref_normalized(queries[i % QUERIES]).owner_faction = static_cast<int>(i & 7);
+    });
+    bench::consume(sum);
+}
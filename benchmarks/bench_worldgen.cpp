@@ -0,0 +1,212 @@
+#include <algorithm>
+#include "bench.hpp"
+#include "job_system.hpp"
+#include "noise_library.hpp"
+#include "worldgen.hpp"
+
+namespace {
+constexpr int SIZE = 512;
+
+// The same map, made in the ways a generator can give the tiles to the game
+const char* SET_TILE_GENERATOR = R"lua(
+    return function(Map, Options)
+        Map:setSize(SIZE, SIZE)
+        for y = 1, SIZE do
+            for x = 1, SIZE do
+                Map:setTileAt(x, y, (x + y) % 7)
+            end
+        end
+        return 0
+    end
+)lua";
+
+const char* FILL_ROW_GENERATOR = R"lua(
+    return function(Map, Options)
+        Map:setSize(SIZE, SIZE)
+        local row = {}
+        for y = 1, SIZE do
+            for x = 1, SIZE do
+                row[x] = (x + y) % 7
+            end
+            Map:fillRow(y, row)
+        end
+        return 0
+    end
+)lua";
+
+const char* FFI_GENERATOR = R"lua(
+    local ffi = require("ffi")
+    return function(Map, Options)
+        Map:setSize(SIZE, SIZE)
+        local tiles, stride = Map:rawTiles()
+        tiles = ffi.cast("int32_t*", tiles)
+        for r = 0, SIZE - 1 do
+            for q = 0, SIZE - 1 do
+                tiles[(r * SIZE + q) * stride] = (q + r + 2) % 7
+            end
+        end
+        return 0
+    end
+)lua";
+
+// A module with a chunked generator, like the "continents" one, without the definitions
+const char* CHUNKED_MODULE = R"lua(
+    return {
+        declarations = {
+            world_generators = {
+                {
+                    name = "chunked",
+                    chunked = { width = 2048, height = 1024 },
+                    generator = function(Chunk, Options)
+                        local terrain = Noise.new{ basis = "simplex", fractal = "fbm", seed = Chunk.worldSeed, octaves = 8, frequency = 4 }
+                        local elevation = terrain:fillRegion(Chunk.x, Chunk.y, Chunk.width, Chunk.height, Chunk.worldWidth)
+                        for j = 1, Chunk.height do
+                            local row = {}
+                            for i = 1, Chunk.width do
+                                local e = elevation[j][i]
+                                if e > 0.3 then row[i] = 4
+                                elseif e > 0.03 then row[i] = 1
+                                elseif e > 0 then row[i] = math.random() < 0.1 and 3 or 2
+                                else row[i] = 0 end
+                            end
+                            Chunk:fillRow(Chunk.y + j - 1, row)
+                        end
+                        return 0
+                    end
+                }
+            }
+        }
+    }
+)lua";
+
+uint64_t tile_hash(const CylinderHexWorld<HexData>& world) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const auto& hx : world.data) {
+        hash = (hash ^ static_cast<uint32_t>(hx.tileid)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// The chunked generator made by 1, 2, 4... VMs at once. The world has to come out the same every time
+void chunked_benchmarks() {
+    JobSystem jobs(JobSystem::workers_from_environment());
+    NoiseLibrary noise;
+    const WorldGenVMFactory make_vm = [&](const std::string&) -> std::optional<ModuleInstance> {
+        ModuleInstance instance;
+        instance.state.open_libraries(sol::lib::base, sol::lib::jit, sol::lib::math, sol::lib::table);
+        noise.InjectSymbols(instance.state);
+        instance.root = instance.state.script(CHUNKED_MODULE).get<sol::table>();
+        return instance;
+    };
+    WorldGen gen;
+    gen.name = "chunked";
+    gen.chunked = WorldGen::ChunkedSize{2048, 1024};
+
+    std::vector<int> vm_counts;
+    for (int vms = 1; vms < jobs.worker_count() + 1; vms *= 2) {
+        vm_counts.push_back(vms);
+    }
+    vm_counts.push_back(jobs.worker_count() + 1);
+    std::optional<uint64_t> expected;
+    bool identical = true;
+    for (const int vms : vm_counts) {
+        uint64_t hash = 0;
+        const auto name = "worldgen/chunked_2048x1024_vms_" + std::to_string(vms);
+        const auto result = bench::run(name, 3, [&](size_t) {
+            hash = tile_hash(GenerateWorldChunked(gen, {{"seed", 7.0}}, &jobs, make_vm, vms).value());
+        });
+        if (result.iterations == 0) {
+            continue;
+        }
+        if (expected.has_value() && hash != *expected) {
+            bench::fail(name + " made another world than the VM counts before it");
+            identical = false;
+        }
+        expected = hash;
+    }
+    if (expected.has_value() && identical) {
+        std::cout << "  chunked worlds identical for every VM count\n";
+    }
+}
+
+// what the Map used to be, for comparison: a table of rows, copied into the world afterwards
+CylinderHexWorld<HexData> table_map_generate(sol::state& lua, const sol::protected_function& generator) {
+    sol::table map_interface = lua.script(R"lua(
+        return {
+            AXIAL = 0,
+            OFFSET = 1,
+            _data = {{0}},
+            _mode = 0,
+            _width = 1,
+            _height = 1,
+            setSize = function(self, width, height)
+                self._width = width
+                self._height = height
+                self._data = {}
+                for y=1, height do
+                    self._data[y] = {}
+                    for x=1, width do
+                        self._data[y][x] = -1
+                    end
+                end
+            end,
+            setTileCoords = function(self, mode)
+                self._mode = mode
+            end,
+            setTileAt = function(self, x, y, tile)
+                self._data[y][x] = tile
+            end
+        }
+    )lua");
+    generator.call(map_interface, lua.create_table());
+
+    CylinderHexWorld<HexData> world(map_interface["_width"], map_interface["_height"], {}, {});
+    const int mode = map_interface["_mode"];
+    for (const auto& [key, value] : map_interface["_data"].get<sol::table>()) {
+        if (key.get_type() != sol::type::number) continue;
+        if (value.get_type() != sol::type::table) continue;
+        for (const auto& [kkey, vvalue] : value.as<sol::table>()) {
+            if (kkey.get_type() != sol::type::number) continue;
+            if (vvalue.get_type() != sol::type::number) continue;
+            const auto hc = mode == 0 ? HexCoords::from_axial(kkey.as<int>() - 1, key.as<int>() - 1)
+                                      : HexCoords::from_offset(kkey.as<int>() - 1, key.as<int>() - 1);
+            world.at_ref_normalized(hc).tileid = vvalue.as<int>();
+        }
+    }
+    return world;
+}
+}
+
+void worldgen_benchmarks() {
+    sol::state lua;
+    lua.open_libraries(sol::lib::base, sol::lib::jit, sol::lib::ffi, sol::lib::package, sol::lib::math, sol::lib::table);
+    lua["SIZE"] = SIZE;
+    long tiles = 0;
+
+    WorldGen set_tile;
+    set_tile.generator = lua.script(SET_TILE_GENERATOR).get<sol::protected_function>();
+    bench::run("worldgen/table_map_set_tile_512", 5, [&](size_t) {
+        tiles += table_map_generate(lua, set_tile.generator).data.size();
+    });
+    bench::run("worldgen/native_map_set_tile_512", 5, [&](size_t) {
+        tiles += GenerateWorld(set_tile, {}).value().data.size();
+    });
+
+    WorldGen fill_row;
+    fill_row.generator = lua.script(FILL_ROW_GENERATOR).get<sol::protected_function>();
+    bench::run("worldgen/native_map_fill_row_512", 5, [&](size_t) {
+        tiles += GenerateWorld(fill_row, {}).value().data.size();
+    });
+
+    // the FFI is LuaJIT only
+    if (lua["jit"].get_type() == sol::type::table) {
+        WorldGen ffi;
+        ffi.generator = lua.script(FFI_GENERATOR).get<sol::protected_function>();
+        bench::run("worldgen/native_map_ffi_512", 5, [&](size_t) {
+            tiles += GenerateWorld(ffi, {}).value().data.size();
+        });
+    }
+    bench::consume(tiles);
+
+    chunked_benchmarks();
+}
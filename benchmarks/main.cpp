@@ -0,0 +1,98 @@
+// Runs the benchmarks, all of them or the ones picked with --filter
+//
+//     benchmarks [--filter TEXT] [--samples N] [--json FILE]
+//
+// With --json the results are also written to FILE, to compare two builds of the game with each other.
+// Some benchmarks check their results as well (the SIMD kernels against the scalar code, for one), if any of them are
+// wrong the exit code is 1
+#include <iostream>
+#include <string>
+#include "bench.hpp"
+
+void hex_benchmarks();
+void hex_batch_benchmarks();
+void world_benchmarks();
+void pathfinding_benchmarks();
+void hierarchical_pathfinding_benchmarks();
+void flow_field_benchmarks();
+void units_benchmarks();
+void hash_benchmarks();
+void serialization_benchmarks();
+void noise_benchmarks();
+void worldgen_benchmarks();
+void jobs_benchmarks();
+
+namespace {
+void usage() {
+    std::cerr << "usage: benchmarks [--filter TEXT] [--samples N] [--json FILE]\n";
+}
+
+bool parse(int argc, char** argv, std::string& json) {
+    auto& settings = bench::settings();
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--filter") {
+            settings.filter = value;
+        } else if (arg == "--json") {
+            json = value;
+        } else if (arg == "--samples") {
+            try {
+                settings.max_samples = std::stoul(value);
+            } catch (const std::exception&) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string json;
+    if (!parse(argc, argv, json)) {
+        usage();
+        return 2;
+    }
+    std::cout << "=== hex coordinates ===\n";
+    hex_benchmarks();
+    hex_batch_benchmarks();
+    std::cout << "=== world ===\n";
+    world_benchmarks();
+    std::cout << "=== pathfinding ===\n";
+    pathfinding_benchmarks();
+    std::cout << "=== hierarchical pathfinding ===\n";
+    hierarchical_pathfinding_benchmarks();
+    std::cout << "=== flow fields ===\n";
+    flow_field_benchmarks();
+    std::cout << "=== units ===\n";
+    units_benchmarks();
+    std::cout << "=== hex hash maps ===\n";
+    hash_benchmarks();
+    std::cout << "=== serialization ===\n";
+    serialization_benchmarks();
+    std::cout << "=== noise ===\n";
+    noise_benchmarks();
+    std::cout << "=== world generation ===\n";
+    worldgen_benchmarks();
+    std::cout << "=== jobs ===\n";
+    jobs_benchmarks();
+
+    if (!json.empty()) {
+        if (!bench::write_json(json)) {
+            std::cerr << "Couldn't write the results to " << json << '\n';
+            return 1;
+        }
+        std::cout << bench::results().size() << " results written to " << json << '\n';
+    }
+    if (bench::failures() > 0) {
+        std::cerr << bench::failures() << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}
@@ -11,6 +11,7 @@
 #include <thread>
 #include <queue>
 #include "utils.hpp"
+#include "profiler.hpp"
 
 const std::string HOST;
 
@@ -145,6 +146,7 @@ struct Connection{
     }
 
     void handleTasks(){
+        PROFILE_ZONE("network");
         if(data.size() < 4){
             return;
         }
@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A small profiler. Code marks zones with PROFILE_ZONE("name"), which records when the zone started and ended
+// into a ring buffer of the thread it runs on. Every thread has its own ring, written only by that thread, so
+// recording takes no locks - whoever reads the rings (the trace dump) copies them, and throws away what got
+// overwritten in the meantime. The rings hold the last RING_SIZE zones of every thread.
+//
+// The zones compile out in release builds (NDEBUG), unless STRATGAME_PROFILER is defined.
+// Zone names are not copied, so they have to be string literals, or live for as long as the program does.
+#if !defined(NDEBUG) || defined(STRATGAME_PROFILER)
+#define STRATGAME_PROFILER_ENABLED 1
+#else
+#define STRATGAME_PROFILER_ENABLED 0
+#endif
+
+namespace profiler {
+    constexpr bool ENABLED = STRATGAME_PROFILER_ENABLED;
+    constexpr size_t RING_SIZE = 1 << 15;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Nanoseconds since the profiler started
+    int64_t to_ns(Clock::time_point t);
+    inline int64_t now_ns() { return to_ns(Clock::now()); }
+
+    // Records a zone that was measured some other way
+    void record(const char* name, Clock::time_point start, Clock::time_point end);
+    void record(const char* name, int64_t start_ns, int64_t end_ns);
+
+    // Shows up as the name of the thread in the trace, once per thread
+    void set_thread_name(const char* name);
+
+    // Writes the zones that ended in the last `seconds` as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+    // Returns false if the file couldn't be written
+    bool write_chrome_trace(const std::string& path, double seconds);
+
+    struct Zone {
+        explicit Zone(const char* name) : m_name(name), m_start(now_ns()) {}
+        ~Zone() { record(m_name, m_start, now_ns()); }
+
+        Zone(const Zone&) = delete;
+        Zone& operator= (const Zone&) = delete;
+
+    private:
+        const char* m_name;
+        int64_t m_start;
+    };
+
+    // How long the phases of the last FRAMES frames took, for the debug overlay. Kept apart from the zones,
+    // so that it works in release builds too
+    template <size_t PHASES>
+    struct FrameHistory {
+        static constexpr size_t FRAMES = 240;
+
+        std::array<const char*, PHASES> names;
+        // milliseconds, indexed by [phase][frame], frame going around
+        std::array<std::array<float, FRAMES>, PHASES> ms{};
+        size_t next = 0;
+        size_t count = 0;
+
+        void add(const std::array<float, PHASES>& phases) {
+            for (size_t p = 0; p < PHASES; p++) {
+                ms[p][next] = phases[p];
+            }
+            next = (next + 1) % FRAMES;
+            count = std::min(count + 1, FRAMES);
+        }
+
+        // the i-th frame, 0 being the oldest one kept
+        float at(size_t phase, size_t i) const {
+            return ms[phase][(next + FRAMES - count + i) % FRAMES];
+        }
+
+        float average(size_t phase) const {
+            float sum = 0.0f;
+            for (size_t i = 0; i < count; i++) {
+                sum += ms[phase][i];
+            }
+            return count > 0 ? sum / count : 0.0f;
+        }
+
+        float max(size_t phase) const {
+            float result = 0.0f;
+            for (size_t i = 0; i < count; i++) {
+                result = std::max(result, ms[phase][i]);
+            }
+            return result;
+        }
+    };
+};
+
+#define STRATGAME_PROFILER_CONCAT_INNER(a, b) a##b
+#define STRATGAME_PROFILER_CONCAT(a, b) STRATGAME_PROFILER_CONCAT_INNER(a, b)
+
+#if STRATGAME_PROFILER_ENABLED
+#define PROFILE_ZONE(name) ::profiler::Zone STRATGAME_PROFILER_CONCAT(profiler_zone_, __LINE__){name}
+#define PROFILE_THREAD(name) ::profiler::set_thread_name(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
@@ -2,6 +2,8 @@
 #include "input.hpp"
 #include "resources.hpp"
 #include "module.hpp"
+#include "noise_library.hpp"
+#include "job_system.hpp"
 
 // Since we need to have different elements of our state at different times, i decided to split them up into layers
 // Their creation should loosely follow the operation of the game by the user
@@ -14,8 +16,12 @@
 struct AppState {
     InputMgr inputMgr;
     bool debug = false;
+    GameDefinitions definitions;
     ResourceStore resourceStore;
+    NoiseLibrary noise{&jobs};
     ModuleLoader moduleLoader;
+    // last, so that it's gone (and its jobs finished) before what the jobs might use
+    JobSystem jobs{JobSystem::workers_from_environment()};
 
     AppState() = default;
     AppState(const AppState&) = delete;
@@ -5,8 +5,10 @@
 #include <stack>
 #include <memory>
 #include <variant>
+#include "frame_arena.hpp"
 
 class BehaviourStack;
+class JobSystem;
 
 template <typename T>
 concept ViableBehaviour = requires(T behaviour, BehaviourStack &bs) {
@@ -53,6 +55,11 @@ private:
 public:
 	BehaviourStack();
 
+	// for whatever a behaviour needs during a single loop, reset after every one
+	FrameArena frame_arena;
+	// its main thread callbacks are run between loops, when set
+	JobSystem* jobs = nullptr;
+
 	template <ViableBehaviour T>
 	void defer_push(T *b) {
 		actions_stack.emplace_back(PushAction{
@@ -1,6 +1,9 @@
 #pragma once
 #include <memory>
 #include "behaviour_stack.hpp"
+#include "raymath.h"
+#include "gui/simple_button.hpp"
+#include <algorithm>
 #include <functional>
 #include <optional>
 
@@ -13,6 +16,11 @@ struct LoadingScreen : public std::enable_shared_from_this<LoadingScreen<TNext>>
     float font_size = 32.0f;
     const char *text = "Loading...";
     float time = 0.0f;
+    // 0..1 when there's a way to tell how far along it is, a bar is drawn then
+    std::optional<float> progress;
+    // when there's something that can be cancelled, a button for it is shown. Called once
+    std::optional<std::function<void()>> on_cancel;
+    SimpleButton cancel_button{"CANCEL", 0, 0, 200, 60};
 
     void signal_done(TNext* _next) {
         next = _next;
@@ -32,16 +40,34 @@ struct LoadingScreen : public std::enable_shared_from_this<LoadingScreen<TNext>>
         if (during.has_value()) {
             during.value()(bs, *this);
         }
+
+        Vector2 screen_center = {(float)GetScreenWidth()/2, (float)GetScreenHeight()/2};
+        if (on_cancel.has_value()) {
+            cancel_button.set_position(screen_center.x, screen_center.y + 120.0f);
+            cancel_button.handle_events();
+            if (cancel_button.is_clicked()) {
+                auto cancel = std::move(on_cancel.value());
+                on_cancel.reset();
+                cancel();
+            }
+        }
         
         time += GetFrameTime();
         BeginDrawing();
         {
             ClearBackground(BLACK);
-            Vector2 screen_center = {(float)GetScreenWidth()/2, (float)GetScreenHeight()/2};
             auto text_size = MeasureTextEx(GetFontDefault(), text, font_size, 1.0f);
             auto top_left_corner = Vector2Subtract(screen_center, Vector2Scale(text_size, 0.5f));
             unsigned char bright = abs(sinf(time)) * 255;
             DrawTextEx(GetFontDefault(), text, top_left_corner, font_size, 1.0f, Color{255, 255, 255, bright});
+            if (progress.has_value()) {
+                const Rectangle bar{screen_center.x - 200.0f, screen_center.y + 40.0f, 400.0f, 16.0f};
+                DrawRectangleRec(Rectangle{bar.x, bar.y, bar.width * std::clamp(progress.value(), 0.0f, 1.0f), bar.height}, RAYWHITE);
+                DrawRectangleLinesEx(bar, 1.0f, GRAY);
+            }
+            if (on_cancel.has_value()) {
+                cancel_button.draw();
+            }
         }
         EndDrawing();
     };
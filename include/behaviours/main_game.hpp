@@ -1,13 +1,19 @@
 #pragma once
 #include "raylib.h"
+#include "raymath.h"
 #include "player_state.hpp"
 #include <memory>
+#include <chrono>
 #include "utils.hpp"
+#include "profiler.hpp"
 #include "behaviour_stack.hpp"
+#include "simulation.hpp"
 
 namespace behaviours {
 struct MainGame {
     std::shared_ptr<PlayerState> player_state;
+    // ticks the game state, declared after the player state, so that it stops before the state goes away
+    Simulation simulation;
 
     Camera3D camera;
     // for draging the map around
@@ -22,9 +28,15 @@ struct MainGame {
 
     float scale;
 
+    // how long drawing the terrain took, shown in the debug overlay
+    std::chrono::steady_clock::duration terrain_time{};
+    // how long the parts of the last frames took, drawn as graphs in the debug overlay
+    profiler::FrameHistory<4> frame_history{ { "logic", "visibility", "rendering", "frame" } };
+
     MainGame(std::shared_ptr<PlayerState> ps);
     void initialize();
     void loop (BehaviourStack& bs);
+    void draw_frame_history(int x, int y, const FrameArena::Stats& arena) const;
     ~MainGame();
 };
 }
\ No newline at end of file
@@ -19,6 +19,7 @@ struct MainMenu {
     Writebox connection_addr_writebox;
 	Writebox game_id_writebox;
 	Writebox nickname_writebox;
+	Writebox seed_writebox;
 
     MainMenu(std::shared_ptr<AppState> as):
         app_state(as),
@@ -28,7 +29,8 @@ struct MainMenu {
         exit_button("EXIT", 0, 0, 200, 60),
         connection_addr_writebox(0, 0, "Connection address (eg 127.0.0.1:4242):"),
         game_id_writebox(0, 0, "Game ID (eg 472948):"),
-        nickname_writebox(0, 0, "Nickname:")
+        nickname_writebox(0, 0, "Nickname:"),
+        seed_writebox(0, 0, "World seed (empty for the default one):")
     {}
     
     void initialize() {
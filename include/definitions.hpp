@@ -0,0 +1,71 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sol/sol.hpp>
+#include "module.hpp"
+#include "issues.hpp"
+#include "worldgen.hpp"
+
+struct ProductDefinition {
+    std::string name;
+    std::filesystem::path icon;
+};
+
+struct HexDefinition {
+    std::string name;
+    std::string description;
+    std::vector<std::pair<int, int>> produces;
+    int vision_cost = 1;
+    int movement_cost = 1; // below 1 means the hex cannot be entered
+    std::filesystem::path model;
+};
+
+// What the modules declare, as far as the game logic cares - names, costs, world generators. Nothing in here needs a window,
+// so a headless run loads it the same way as the game. ResourceStore loads the models and textures to go with it
+struct GameDefinitions {
+    GameDefinitions() = default;
+    ~GameDefinitions() = default;
+
+    // Definitions should be immobile, lua holds pointers to them
+    GameDefinitions(const GameDefinitions&) = delete;
+    GameDefinitions(GameDefinitions&&) = delete;
+    GameDefinitions& operator= (const GameDefinitions&) = delete;
+    GameDefinitions& operator= (GameDefinitions&&) = delete;
+
+    // Type tables, indexed by the ids used in the world
+    std::vector<ProductDefinition> m_products;
+    std::vector<HexDefinition> m_hexes;
+    std::vector<std::unique_ptr<WorldGen>> m_worldgens;
+
+    // Resource file utils
+    std::optional<std::filesystem::path> ResolveModuleFile(const Module& m, std::filesystem::path relpath) const;
+    std::filesystem::path ResolveModuleFileThrows(const Module& m, std::filesystem::path relpath) const;
+
+    // Goes through the declarations of the loaded modules
+    std::vector<issues::AnyIssue> LoadModuleDefinitions(ModuleLoader& modl);
+
+    void LoadProducts(ModuleLoader& modl, const Module& mod, std::vector<issues::AnyIssue>& issues);
+    void LoadHexes(ModuleLoader& modl, const Module& mod, std::vector<issues::AnyIssue>& issues);
+    void LoadWorldGen(ModuleLoader& modl, const Module& mod, std::vector<issues::AnyIssue>& issues);
+
+    int FindProductIndex (std::string name);
+    int FindHexIndex (std::string name);
+    int FindGeneratorIndex (std::string name);
+
+    const ProductDefinition& GetProduct(int idx);
+    const HexDefinition& GetHex(int idx);
+    const WorldGen& GetGenerator(int idx);
+    // nullptr if there's no generator of that name
+    const WorldGen* FindGenerator(std::string name);
+
+    // Flat per tileid tables, for code that only needs the numbers
+    std::vector<int> HexVisionCosts() const;
+    std::vector<int> HexMovementCosts() const;
+
+    // Inject things to get definitions
+    void InjectSymbols(sol::state& lua);
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "hex.hpp"
+#include "flat_hash_map.hpp"
+
+// Terrain aware field of view
+// Every hex has a vision cost (see HexKind::vision_cost). Looking through a hex uses up that much of
+// the viewers range, so a hex is visible when the cheapest ray from the viewer to it spends less than
+// the range on the hexes in between. With all costs being 1, this gives exactly spiral_around(range).
+//
+// The rays are not traced at runtime. Instead, there is a table of offsets in spiral order (up to MAX_RADIUS),
+// where every offset knows the two hexes that lead to it from the center (lines nudged to either side),
+// so computing the view is a single linear pass over the table.
+struct FovViewer {
+    HexCoords origin;
+    int range;
+};
+
+// Hexes whose visibility changed, collected between frames for whoever keeps a copy of it (the fog of war texture)
+struct VisibilityChanges {
+    std::vector<HexKey> hexes;
+    // set when the world was replaced, or when so much changed that it's cheaper to look at everything again
+    bool everything = true;
+
+    void add(HexKey key, size_t world_size) {
+        if (everything) return;
+        hexes.push_back(key);
+        if (hexes.size() > world_size / 4) {
+            reset();
+        }
+    }
+
+    void reset() {
+        hexes.clear();
+        everything = true;
+    }
+};
+
+struct FieldOfView {
+    static constexpr int MAX_RADIUS = 32;
+    // cost given to things that cannot be seen through - empty hexes and hexes outside of the map
+    static constexpr int BLOCKED = 1 << 20;
+
+    FieldOfView() = default;
+    // vision_costs is indexed by tileid
+    explicit FieldOfView(const std::vector<int>& vision_costs);
+
+    void set_vision_costs(const std::vector<int>& vision_costs);
+
+    // Returns indices into world.data of all hexes visible from origin. The result is valid until the next call
+    std::span<const int> compute(const CylinderHexWorld<HexData>& world, HexCoords origin, int range);
+
+    void reveal(CylinderHexWorld<HexData>& world, HexCoords origin, int range, int fraction, HexData::Visibility vis = HexData::Visibility::SUPERIOR);
+    void reveal_batch(CylinderHexWorld<HexData>& world, std::span<const FovViewer> viewers, int fraction, HexData::Visibility vis = HexData::Visibility::SUPERIOR);
+
+    // Hexes whose visibility flags were changed by reveal since the last clear_changed, for whoever
+    // has to follow visibility (the renderer, the network) without going over the whole world
+    const FlatHashSet<HexKey>& changed_tiles() const { return m_changed; }
+    void clear_changed() { m_changed.clear(); }
+
+private:
+    // indexed by tileid + 1, so that the empty hex (-1) is in slot 0
+    std::vector<int> m_costs = {BLOCKED};
+    // scratch space, reused between calls
+    std::vector<int> m_spent;
+    std::vector<int> m_visible;
+    FlatHashSet<HexKey> m_changed;
+};
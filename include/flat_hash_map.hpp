@@ -0,0 +1,216 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <algorithm>
+
+// Open addressing hash map, with everything in one array and linear probing, so a lookup is usually a single cache line.
+// The hash goes through a multiplicative mix before picking a slot, so weak hashes like std::hash<int> work fine.
+// Erasing shifts the following entries back instead of leaving tombstones, so lookups don't slow down over time.
+//
+// Keys and values have to be default constructible. Any insert or erase invalidates iterators and pointers.
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+struct FlatHashMap {
+    using value_type = std::pair<Key, Value>;
+
+    template <bool Const>
+    struct basic_iterator {
+        using map_type = std::conditional_t<Const, const FlatHashMap, FlatHashMap>;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+        map_type* map;
+        size_t at;
+
+        reference operator*() const { return map->m_slots[at]; }
+        auto* operator->() const { return &map->m_slots[at]; }
+        basic_iterator& operator++() {
+            at = map->next_used(at + 1);
+            return *this;
+        }
+        bool operator==(const basic_iterator& other) const { return at == other.at; }
+        bool operator!=(const basic_iterator& other) const { return at != other.at; }
+    };
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t capacity() const { return m_slots.size(); }
+
+    iterator begin() { return {this, next_used(0)}; }
+    iterator end() { return {this, m_slots.size()}; }
+    const_iterator begin() const { return {this, next_used(0)}; }
+    const_iterator end() const { return {this, m_slots.size()}; }
+
+    // Makes room for count entries without rehashing
+    void reserve(size_t count) {
+        size_t wanted = MIN_CAPACITY;
+        while (wanted * MAX_LOAD_NUMERATOR < count * MAX_LOAD_DENOMINATOR) {
+            wanted *= 2;
+        }
+        if (wanted > m_slots.size()) {
+            rehash(wanted);
+        }
+    }
+
+    // Keeps the memory
+    void clear() {
+        for (size_t i = 0; i < m_slots.size(); i++) {
+            if (m_used[i]) {
+                m_slots[i] = value_type{};
+                m_used[i] = 0;
+            }
+        }
+        m_size = 0;
+    }
+
+    Value* find(const Key& key) {
+        const size_t at = slot_of(key);
+        return at == NOT_FOUND ? nullptr : &m_slots[at].second;
+    }
+
+    const Value* find(const Key& key) const {
+        const size_t at = slot_of(key);
+        return at == NOT_FOUND ? nullptr : &m_slots[at].second;
+    }
+
+    bool contains(const Key& key) const { return slot_of(key) != NOT_FOUND; }
+
+    // Inserts value if the key is not there yet. Returns the value in the map, and whether it was inserted
+    std::pair<Value*, bool> try_emplace(const Key& key, Value value = {}) {
+        if ((m_size + 1) * MAX_LOAD_DENOMINATOR > m_slots.size() * MAX_LOAD_NUMERATOR) {
+            rehash(std::max(MIN_CAPACITY, m_slots.size() * 2));
+        }
+        const size_t mask = m_slots.size() - 1;
+        for (size_t i = home(key); ; i = (i + 1) & mask) {
+            if (!m_used[i]) {
+                m_slots[i] = value_type{key, std::move(value)};
+                m_used[i] = 1;
+                m_size++;
+                return {&m_slots[i].second, true};
+            }
+            if (KeyEqual{}(m_slots[i].first, key)) {
+                return {&m_slots[i].second, false};
+            }
+        }
+    }
+
+    Value& operator[](const Key& key) { return *try_emplace(key).first; }
+
+    void insert_or_assign(const Key& key, Value value) {
+        auto [at, inserted] = try_emplace(key);
+        *at = std::move(value);
+    }
+
+    // Returns whether there was anything to erase
+    bool erase(const Key& key) {
+        size_t hole = slot_of(key);
+        if (hole == NOT_FOUND) {
+            return false;
+        }
+        const size_t mask = m_slots.size() - 1;
+        // pull back every following entry that would still be found from the hole
+        for (size_t i = (hole + 1) & mask; m_used[i]; i = (i + 1) & mask) {
+            const size_t wanted = home(m_slots[i].first);
+            if (((i - wanted) & mask) >= ((i - hole) & mask)) {
+                m_slots[hole] = std::move(m_slots[i]);
+                hole = i;
+            }
+        }
+        m_slots[hole] = value_type{};
+        m_used[hole] = 0;
+        m_size--;
+        return true;
+    }
+
+private:
+    static constexpr size_t MIN_CAPACITY = 8;
+    static constexpr size_t MAX_LOAD_NUMERATOR = 3;
+    static constexpr size_t MAX_LOAD_DENOMINATOR = 4;
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    std::vector<value_type> m_slots;
+    std::vector<uint8_t> m_used;
+    size_t m_size = 0;
+    int m_shift = 64;
+
+    size_t home(const Key& key) const {
+        // fibonacci hashing - the top bits of the product depend on all bits of the hash
+        return static_cast<size_t>((static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull) >> m_shift);
+    }
+
+    size_t slot_of(const Key& key) const {
+        if (m_size == 0) {
+            return NOT_FOUND;
+        }
+        const size_t mask = m_slots.size() - 1;
+        for (size_t i = home(key); m_used[i]; i = (i + 1) & mask) {
+            if (KeyEqual{}(m_slots[i].first, key)) {
+                return i;
+            }
+        }
+        return NOT_FOUND;
+    }
+
+    size_t next_used(size_t from) const {
+        while (from < m_used.size() && !m_used[from]) {
+            from++;
+        }
+        return from;
+    }
+
+    void rehash(size_t new_capacity) {
+        auto old_slots = std::move(m_slots);
+        auto old_used = std::move(m_used);
+        m_slots.assign(new_capacity, value_type{});
+        m_used.assign(new_capacity, 0);
+        m_shift = 64;
+        for (size_t c = new_capacity; c > 1; c /= 2) {
+            m_shift--;
+        }
+        m_size = 0;
+        for (size_t i = 0; i < old_slots.size(); i++) {
+            if (old_used[i]) {
+                try_emplace(old_slots[i].first, std::move(old_slots[i].second));
+            }
+        }
+    }
+};
+
+// Set version of FlatHashMap, with the same rules
+template <typename Key, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+struct FlatHashSet {
+    struct Nothing {};
+    using map_type = FlatHashMap<Key, Nothing, Hash, KeyEqual>;
+
+    struct const_iterator {
+        typename map_type::const_iterator it;
+
+        const Key& operator*() const { return it->first; }
+        const Key* operator->() const { return &it->first; }
+        const_iterator& operator++() {
+            ++it;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const { return it == other.it; }
+        bool operator!=(const const_iterator& other) const { return it != other.it; }
+    };
+
+    size_t size() const { return m_map.size(); }
+    bool empty() const { return m_map.empty(); }
+    void reserve(size_t count) { m_map.reserve(count); }
+    void clear() { m_map.clear(); }
+
+    const_iterator begin() const { return {m_map.begin()}; }
+    const_iterator end() const { return {m_map.end()}; }
+
+    // Returns whether the key was not there before
+    bool insert(const Key& key) { return m_map.try_emplace(key).second; }
+    bool contains(const Key& key) const { return m_map.contains(key); }
+    bool erase(const Key& key) { return m_map.erase(key); }
+
+private:
+    map_type m_map;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include "pathfinding.hpp"
+#include "job_system.hpp"
+
+// Dijkstra map towards a set of targets. Every tile knows how much it costs to get to the closest target,
+// and which way to go for that, so any number of units going to the same place can walk it
+// with one lookup per step, instead of every one of them running its own A*.
+// Like the hierarchical abstraction, fields ignore units.
+struct FlowField {
+    // values of `directions` that are not an index into axial_directions
+    static constexpr uint8_t AT_TARGET = 6;
+    static constexpr uint8_t UNREACHABLE = 7;
+    static constexpr int NO_COST = std::numeric_limits<int>::max();
+
+    int width = 0;
+    int height = 0;
+    // world indices, sorted
+    std::vector<int> targets;
+    // tiles further away than this are left unreachable
+    int max_cost = NO_COST;
+    // per tile, index into axial_directions of the step to take, AT_TARGET or UNREACHABLE
+    std::vector<uint8_t> directions;
+    // per tile, cost of getting to the closest target, NO_COST if there's no way
+    std::vector<int> costs;
+
+    bool reachable(int idx) const { return directions[idx] != UNREACHABLE; }
+
+    // World index of the next tile on the way, idx itself on a target, -1 if there's no way
+    int next_index(const CylinderHexWorld<HexData>& world, int idx) const;
+
+    // The next hex on the way, continuous in q with `from`. `from` itself on a target, nothing if there's no way
+    std::optional<HexCoords> next_step(const CylinderHexWorld<HexData>& world, HexCoords from) const;
+
+    // Walks the field from `from`, filling path like Pathfinder::find_path does. False if it doesn't lead to a target
+    bool follow(const CylinderHexWorld<HexData>& world, HexCoords from, std::vector<HexCoords>& path) const;
+};
+
+// Makes flow fields with a multi-source Dijkstra, using the costs of the pathfinder.
+// Chunks are relaxed one at a time, each with a bucket queue, and whenever the costs on the edge of a chunk go down,
+// the chunks around it are queued again. Chunks are coloured so that no two chunks of the same colour touch,
+// which lets the chunks of one colour be relaxed by many jobs at once, without locks.
+// The result doesn't depend on the number of threads.
+struct FlowFieldGenerator {
+    // Without a job system, everything is done on the calling thread. The costs are taken from the pathfinder,
+    // which has to outlive this object, and so does the job system
+    explicit FlowFieldGenerator(const Pathfinder& costs, JobSystem* jobs = nullptr) : m_costs(costs), m_jobs(jobs) {}
+
+    void set_jobs(JobSystem* jobs) { m_jobs = jobs; }
+    JobSystem* jobs() const { return m_jobs; }
+
+    // Fills the field, reusing its memory. targets are world indices, targets that can't be entered are ignored
+    void generate(const CylinderHexWorld<HexData>& world, std::span<const int> targets, int max_cost, FlowField& field) const;
+
+private:
+    const Pathfinder& m_costs;
+    JobSystem* m_jobs = nullptr;
+};
+
+// Keeps recently used fields, keyed by their targets. A field goes stale when a tile it reaches, or one right next to it, changes,
+// and is regenerated the next time it's asked for - changes out of reach of a field leave it alone. Handed out fields are never modified,
+// so units can keep following one while the cache has moved on.
+struct FlowFieldCache {
+    static constexpr size_t DEFAULT_CAPACITY = 16;
+
+    explicit FlowFieldCache(const Pathfinder& costs, JobSystem* jobs = nullptr, size_t capacity = DEFAULT_CAPACITY) : m_generator(costs, jobs), m_capacity(capacity) {}
+
+    std::shared_ptr<const FlowField> get(const CylinderHexWorld<HexData>& world, std::span<const HexCoords> targets, int max_cost = FlowField::NO_COST);
+    std::shared_ptr<const FlowField> towards(const CylinderHexWorld<HexData>& world, HexCoords target, int max_cost = FlowField::NO_COST) {
+        return get(world, std::span<const HexCoords>(&target, 1), max_cost);
+    }
+
+    // To be called when a tile changes in a way that might change movement
+    void mark_changed(const CylinderHexWorld<HexData>& world, HexCoords hc);
+    void clear() { m_entries.clear(); }
+    size_t size() const { return m_entries.size(); }
+
+    FlowFieldGenerator& generator() { return m_generator; }
+
+private:
+    struct Entry {
+        std::shared_ptr<FlowField> field;
+        uint64_t last_used = 0;
+        bool stale = false;
+    };
+
+    FlowFieldGenerator m_generator;
+    size_t m_capacity;
+    std::vector<Entry> m_entries;
+    uint64_t m_clock = 0;
+};
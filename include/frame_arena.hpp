@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Memory for things that only live for a frame. Allocating just bumps a pointer, freeing does nothing,
+// and everything is given back at once by reset(), at the end of the frame (see BehaviourStack::update).
+// Used through std::pmr containers:
+//     std::pmr::vector<int> chunks(&arena);
+// Nothing allocated from it may be kept past the frame. When a frame needs more than there is, another block
+// is added, and on reset they're all merged into one, so after a few frames it's a single block that fits.
+class FrameArena : public std::pmr::memory_resource {
+public:
+    struct Stats {
+        // bytes handed out since the last reset
+        size_t used = 0;
+        // how much the last frame used, and the most any frame used
+        size_t last_frame = 0;
+        size_t peak = 0;
+        // bytes held in blocks
+        size_t capacity = 0;
+        int blocks = 0;
+    };
+
+    explicit FrameArena(size_t initial_size = 1 << 20);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator= (const FrameArena&) = delete;
+
+    // Everything allocated from it is gone after this
+    void reset();
+
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> m_blocks;
+    // how much of the last block is taken
+    size_t m_offset = 0;
+    Stats m_stats;
+
+    void add_block(size_t size);
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
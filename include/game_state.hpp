@@ -1,28 +1,70 @@
 #pragma once
-#include "app_state.hpp"
-#include "input.hpp"
 #include "hex.hpp"
-#include "resources.hpp"
+#include "field_of_view.hpp"
+#include "pathfinding.hpp"
+#include "hierarchical_pathfinding.hpp"
+#include "flow_field.hpp"
+#include "path_planner.hpp"
+#include "job_system.hpp"
+#include "worldgen.hpp"
 #include "units.hpp"
 #include "connection.hpp"
 #include "packets.hpp"
 #include "game_packets.hpp"
 #include <memory>
+#include "profiler.hpp"
 
+// A unit walking a path, a hex per tick (see GameState::Tick)
+struct MoveOrder {
+    UnitHandle handle;
+    std::vector<HexCoords> path;
+    // the hex of the path it goes to next
+    size_t next = 1;
+};
+
+// Doesn't need anything that draws, so it's a part of the headless core (see the stratgame_core target)
 struct GameState {
-    std::shared_ptr<AppState> app_state;
     std::shared_ptr<Connection> connection;
     CylinderHexWorld<HexData> world;
     UnitStore units;
+    FieldOfView fov;
+    Pathfinder pathfinder;
+    HierarchicalPathfinder hierarchical_pathfinder{pathfinder};
+    FlowFieldCache flow_fields;
+    PathPlanner path_planner{pathfinder};
+    PlannedPath planned_path;
+    // goes up whenever tiles change - for whatever is built from the tiles
+    uint32_t terrain_revision = 0;
+    // the same, per world chunk, for whatever is built per chunk
+    std::vector<uint32_t> chunk_revisions;
+    // what players can see changes separately, and much more often, so it's only followed per hex
+    VisibilityChanges visibility_changes;
     std::vector<std::string> players;
     bool is_host;
     std::string nickname;
     std::string game_id;
     int pretend_fraction = 0;
     bool init_done = false;
+    // simulation ticks since the start, and units that are on their way somewhere
+    uint64_t tick = 0;
+    std::vector<MoveOrder> move_orders;
+    // null if everything runs on the main thread
+    JobSystem* jobs = nullptr;
+    // the world being made on the workers, if it is (see RunWorldgenAsync)
+    std::shared_ptr<WorldGenTask> worldgen_task;
+
 
+    // The costs are per tileid (see GameDefinitions). Without a connection, nothing comes over the network
+    GameState(std::shared_ptr<Connection> conn, const std::vector<int>& vision_costs, const std::vector<int>& movement_costs, JobSystem* jobs = nullptr)
+        : connection(conn), fov(vision_costs), pathfinder(movement_costs), flow_fields(pathfinder, jobs), jobs(jobs) {}
 
-    GameState(std::shared_ptr<AppState> as, std::shared_ptr<Connection> conn) : app_state(as), connection(conn) {}
+    ~GameState() {
+        // the generator can go on without us, but it must not hand the world over to nobody
+        if (worldgen_task) {
+            worldgen_task->Cancel();
+            worldgen_task->on_finished = nullptr;
+        }
+    }
 
     GameState(const GameState&) = delete;
     GameState(GameState&&) = delete;
@@ -30,27 +72,196 @@ struct GameState {
     GameState& operator= (GameState&&) = delete;
 
     void UpdateVission(int fraction) {
+        std::vector<FovViewer> viewers;
+        units.for_each_unit([&](HexCoords hc, const BaseUnitData& unit) {
+            if (unit.fraction == fraction) {
+                viewers.push_back(FovViewer{.origin = hc, .range = unit.vission_range});
+            }
+        });
+        fov.reveal_batch(world, viewers, fraction);
+        OnVisionChanged();
+    }
 
+    // Takes the hexes revealed since the last call, for the fog of war to pick up
+    void OnVisionChanged() {
+        for (const auto key : fov.changed_tiles()) {
+            visibility_changes.add(key, world.data.size());
+        }
+        fov.clear_changed();
+    }
+
+    // Long orders go over the hierarchical abstraction, short ones straight to A*
+    PathResult FindPath(HexCoords from, HexCoords to, UnitType type, std::vector<HexCoords>& path) {
+        const auto options = PathOptions{.units = &units, .blocking_type = type};
+        if (world.wrapped_distance(from, to) > HierarchicalPathfinder::DIRECT_SEARCH_CHUNKS * WORLD_CHUNK_SIZE) {
+            return hierarchical_pathfinder.find_path(world, from, to, path, options);
+        }
+        return pathfinder.find_path(world, from, to, path, options);
+    }
+
+    // Path for the hovered path preview. The plan is kept between frames, so this only searches when
+    // something changed, and then only what's needed. MoveUnit takes the path from here when the order is confirmed
+    const PlannedPath& PlanPath(HexCoords from, HexCoords to, UnitType type) {
+        if (planned_path.matches(from, to, type)) {
+            return planned_path;
+        }
+        planned_path.from = from;
+        planned_path.to = to;
+        planned_path.type = type;
+        planned_path.valid = true;
+        const auto options = PathOptions{.units = &units, .blocking_type = type};
+        if (world.wrapped_distance(from, to) > HierarchicalPathfinder::DIRECT_SEARCH_CHUNKS * WORLD_CHUNK_SIZE) {
+            planned_path.result = hierarchical_pathfinder.find_path(world, from, to, planned_path.path, options);
+        } else {
+            planned_path.result = path_planner.plan(world, from, to, planned_path.path, options);
+        }
+        return planned_path;
+    }
+
+    // For many units going to the same place, or the AI judging how far things are.
+    // Units follow it with FlowField::next_step, and can hold on to it for as long as they like
+    std::shared_ptr<const FlowField> FlowFieldTowards(std::span<const HexCoords> targets, int max_cost = FlowField::NO_COST) {
+        return flow_fields.get(world, targets, max_cost);
+    }
+
+    // The way to change a tile: change gets its HexData&, and everything built from the tiles hears about it
+    template <typename F>
+    void ChangeTile(HexCoords hc, F&& change) {
+        change(world.at_ref_normalized(hc));
+        OnTileChanged(hc);
+    }
+
+    void SetTile(HexCoords hc, int tileid) {
+        ChangeTile(hc, [tileid](HexData& hex) { hex.tileid = tileid; });
+    }
+
+    // Has to be called after changing anything about a tile, so that cached data can be updated (ChangeTile does it)
+    void OnTileChanged(HexCoords hc) {
+        terrain_revision++;
+        chunk_revisions[world.chunk_of(world.normalized_coords(hc))]++;
+        hierarchical_pathfinder.mark_changed(world, hc);
+        flow_fields.mark_changed(world, hc);
+        path_planner.mark_changed(world, hc);
+        planned_path.valid = false;
+    }
+
+    // Has to be called after a unit gets on or off a tile
+    void OnUnitsChanged(HexCoords hc) {
+        path_planner.mark_changed(world, hc);
+        planned_path.valid = false;
+    }
+
+    // Has to be called after replacing the whole world
+    void OnWorldReplaced() {
+        terrain_revision++;
+        // everything built from the old world is out of date, even if the new one has the same size
+        chunk_revisions.resize(world.chunk_count());
+        for (auto& revision : chunk_revisions) {
+            revision++;
+        }
+        visibility_changes.reset();
+        if (units.width() != world.width || units.height() != world.height) {
+            units.reset(world.width, world.height);
+        }
+        hierarchical_pathfinder.rebuild(world);
+        flow_fields.clear();
+        path_planner.reset();
+        planned_path.valid = false;
     }
 
+    // Orders the unit to go there. It walks over the next ticks. Returns false if the unit could not get there
     template <UnitType UT>
-    void MoveUnit(HexCoords from, HexCoords to) {
-        auto munit = units.get_all_on_hex(from).get_opt_unit<UT>();
-        if (!munit.has_value()) {
-            return; // ! Maybe throw? Error is unhandled
-        }
-        auto unit = munit.value();
-        // TODO - reaveal along path
-        // TODO - allow this function to get the path
-        // TODO - does this function need to get the path? or is it good enough to just, pathfind in here?
-        units.teleport_unit<UT>(from, to);
-        for(const auto hc : to.spiral_around(unit.vission_range)) {
-            world.at_ref_normalized(hc).setFractionVisibility(unit.fraction, HexData::Visibility::SUPERIOR);
+    bool MoveUnit(HexCoords from, HexCoords to) {
+        const auto handle = units.get_all_on_hex(from).get_opt_unit<UT>();
+        if (!handle.has_value()) {
+            return false; // ! Maybe throw? Error is unhandled
         }
+        const auto& plan = PlanPath(from, to, UT);
+        if (!plan.result.found) {
+            return false;
+        }
+        // a new order replaces the old one
+        std::erase_if(move_orders, [&](const MoveOrder& order) { return order.handle == *handle; });
+        if (plan.path.size() > 1) {
+            move_orders.push_back(MoveOrder{.handle = *handle, .path = plan.path});
+        }
+        return true;
     };
 
-    void ConnectAndInitialize (auto on_done, std::optional<std::string> selected_world_gen = {}, std::optional<std::unordered_map<std::string, std::variant<double, std::string, bool>>> worldgen_options = {}) {
-        connection->registerPacketHandler(ProxyDataPacket::packetId, [&](PacketReader &reader) {
+    // Sends every unit of a type and fraction to the same place, over one flow field instead of a path per unit.
+    // They walk like with MoveUnit, the closest one takes the target and the others stop where they run into
+    // each other. Returns how many got an order
+    template <UnitType UT>
+    size_t MoveUnitsTo(int fraction, HexCoords to) {
+        const auto field = FlowFieldTowards(std::span<const HexCoords>(&to, 1));
+        const auto all = units.units_of<UT>();
+        const auto tiles = units.tiles_of<UT>();
+        std::vector<int> movers;
+        for (size_t i = 0; i < all.size(); i++) {
+            if (all[i].fraction == fraction && field->reachable(tiles[i])) {
+                movers.push_back(tiles[i]);
+            }
+        }
+        // closest first, so that they take the hexes closest to the target
+        std::sort(movers.begin(), movers.end(), [&](int a, int b) { return field->costs[a] < field->costs[b]; });
+        size_t ordered = 0;
+        std::vector<HexCoords> path;
+        for (const auto tile : movers) {
+            const auto from = world.coords_of_index(tile);
+            const auto handle = units.get_all_on_hex(from).get_opt_unit<UT>();
+            if (!handle.has_value() || !field->follow(world, from, path) || path.size() < 2) {
+                continue;
+            }
+            std::erase_if(move_orders, [&](const MoveOrder& order) { return order.handle == *handle; });
+            move_orders.push_back(MoveOrder{.handle = *handle, .path = path});
+            ordered++;
+        }
+        return ordered;
+    }
+
+    // One step of the simulation: what came over the network, and every unit with an order goes a hex further.
+    // The units that moved are added to steps
+    void Tick(std::vector<UnitStep>& steps) {
+        PROFILE_ZONE("tick");
+        tick++;
+        if (connection) {
+            connection->handleTasks();
+        }
+        bool moved = false;
+        for (auto& order : move_orders) {
+            const auto from = units.position_of(order.handle);
+            if (!from.has_value() || order.next >= order.path.size()) {
+                order.next = order.path.size();
+                continue;
+            }
+            const auto to = world.normalized_coords(order.path[order.next]);
+            // somebody of the same type got in the way since the order was given, the order is over
+            if (units.get_all_on_hex(to).get_opt_unit(order.handle.type).has_value()) {
+                order.next = order.path.size();
+                continue;
+            }
+            units.move_unit(order.handle, to);
+            order.next++;
+            // the unit looks around on every step of the way
+            if (const auto* unit = units.base_of(order.handle)) {
+                fov.reveal(world, to, unit->vission_range, unit->fraction);
+            }
+            OnUnitsChanged(*from);
+            OnUnitsChanged(to);
+            steps.push_back(UnitStep{.handle = order.handle, .from = *from, .to = to});
+            moved = true;
+        }
+        std::erase_if(move_orders, [](const MoveOrder& order) { return order.next >= order.path.size(); });
+        if (moved) {
+            OnVisionChanged();
+        }
+    }
+
+    // The host makes the world with the generator, the others get it from the host.
+    // With the jobs and make_vm, the generator runs on a worker (see RunWorldgenAsync), and on_done waits for it.
+    // If that fails or is cancelled, on_done isn't called, worldgen_task says what happened
+    void ConnectAndInitialize (auto on_done, const WorldGen* generator = nullptr, WorldGenOptions worldgen_options = {}, WorldGenVMFactory make_vm = {}) {
+        connection->registerPacketHandler(ProxyDataPacket::packetId, [&, on_done, generator, worldgen_options, make_vm](PacketReader &reader) {
         auto packet = ProxyDataPacket::deserialize(reader);
             std::cout << "Players:" << std::endl;
             for (const auto &item: packet.players){
@@ -61,22 +272,39 @@ struct GameState {
             nickname = this->nickname;
             game_id = packet.game_id;
             if(is_host){
-                RunWorldgen(app_state->resourceStore.GetGenerator(app_state->resourceStore.FindGeneratorIndex(selected_world_gen.value_or(std::string("default")))), worldgen_options.value_or(std::unordered_map<std::string, std::variant<double, std::string, bool>>{}));
-                // reveal a starting area
-                world.at_ref_normalized(HexCoords::from_axial(1, 1)).setFractionVisibility(pretend_fraction, HexData::Visibility::SUPERIOR);
-                for(auto c : HexCoords::from_axial(1, 1).neighbours()) {
-                    world.at_ref_normalized(c).setFractionVisibility(pretend_fraction, HexData::Visibility::SUPERIOR);
-                }
+                const auto world_ready = [this, on_done] {
+                    // reveal a starting area
+                    world.at_ref_normalized(HexCoords::from_axial(1, 1)).setFractionVisibility(pretend_fraction, HexData::Visibility::SUPERIOR);
+                    for(auto c : HexCoords::from_axial(1, 1).neighbours()) {
+                        world.at_ref_normalized(c).setFractionVisibility(pretend_fraction, HexData::Visibility::SUPERIOR);
+                    }
 
-                if (!init_done) {
-                    on_done();
-                    init_done = true;
+                    if (!init_done) {
+                        on_done();
+                        init_done = true;
+                    }
+                };
+                if (generator == nullptr) {
+                    logging::error("There's no world generator to make the world with");
+                    world_ready();
+                } else if (jobs != nullptr && make_vm) {
+                    if (!worldgen_task) {
+                        RunWorldgenAsync(*generator, worldgen_options, make_vm, [world_ready](bool made) {
+                            if (made) {
+                                world_ready();
+                            }
+                        });
+                    }
+                } else {
+                    RunWorldgen(*generator, worldgen_options);
+                    world_ready();
                 }
             }
         });
-        connection->registerPacketHandler(WorldUpdatePacket::packetId, [&](PacketReader &reader){
+        connection->registerPacketHandler(WorldUpdatePacket::packetId, [&, on_done](PacketReader &reader){
             auto packet = WorldUpdatePacket::deserialize(reader);
             this->world = std::move(packet.world);
+            OnWorldReplaced();
             if (!init_done) {
                 on_done();
                 init_done = true;
@@ -85,80 +313,28 @@ struct GameState {
         connection->writeToHost(LoginPacket{game_id, nickname});
     }
 
-    void RunWorldgen(const WorldGen& gen, std::unordered_map<std::string, std::variant<double, std::string, bool>> options) {
-        using sol::as_function;
-        (void)options;
-        
-        std::cout << __func__ << " 1 \n";
-        auto& mod = app_state->moduleLoader.m_loaded_modules.at(gen.generator.lua_state());
-        std::cout << __func__ << " 2 \n";
-        sol::table map_interface = mod.state.script(R"lua(
-            return {
-                AXIAL = 0,
-                OFFSET = 1,
-                _data = {{0}},
-                _mode = 0,
-                _width = 1,
-                _height = 1,              
-                setSize = function(self, width, height)
-                    self._width = width
-                    self._height = height
-                    self._data = {}
-                    for y=1, height do
-                        self._data[y] = {}
-                        for x=1, width do
-                            self._data[y][x] = -1
-                        end
-                    end
-                end,
-                setTileCoords = function(self, mode)
-                    self._mode = mode
-                end,
-                setTileAt = function(self, x, y, tile)
-                    self._data[y][x] = tile
-                end
-            }
-        )lua");
-        std::cout << __func__ << " 3 \n";
-        auto options_table = mod.state.create_table();
-        try {
-            std::cout << __func__ << " 4 \n";
-            auto res = gen.generator.call(map_interface, options_table);
-            std::cout << __func__ << " 5 \n";
-            if (res.status() != sol::call_status::ok) {
-                sol::error err = res;
-                std::cerr << "Failed to run the world gen. Status = " << static_cast<int>(res.status()) << '\n';
-                std::cerr << "Stack top: " << err.what() << '\n';
-                abort();
+    // Starts making a new world on the workers. It replaces the world on the main thread once it's made, and then
+    // on_finished(true) is called. If the generator failed or was cancelled (worldgen_task->Cancel()), the world stays as
+    // it was, and it's on_finished(false)
+    void RunWorldgenAsync(const WorldGen& gen, WorldGenOptions options, WorldGenVMFactory make_vm, std::function<void(bool)> on_finished) {
+        worldgen_task = GenerateWorldAsync(gen, std::move(options), *jobs, std::move(make_vm), [this, on_finished](WorldGenTask& task) {
+            if (task.succeeded) {
+                world = std::move(*task.result);
+                task.result.reset();
+                OnWorldReplaced();
             }
+            on_finished(task.succeeded);
+        });
+    }
 
-            std::cout << __func__ << " 6 \n";
-            int w = map_interface["_width"];
-            int h = map_interface["_height"];
-            int mode = map_interface["_mode"];
-
-            std::cout << __func__ << " 7 \n";
-            world = CylinderHexWorld<HexData>(w, h, {}, {});
-            for(const auto& [key, value] : map_interface["_data"].get<sol::table>()) {
-                if (key.get_type() != sol::type::number) continue;
-                if (value.get_type() != sol::type::table) continue;
-                for(const auto& [kkey, vvalue] : value.as<sol::table>()) {
-                    if (kkey.get_type() != sol::type::number) continue;
-                    if (vvalue.get_type() != sol::type::number) continue;
-                    HexCoords hc;
-                    if (mode == 0) {
-                        hc = HexCoords::from_axial(kkey.as<int>()-1, key.as<int>()-1);
-                    } else {
-                        hc = HexCoords::from_offset(kkey.as<int>()-1, key.as<int>()-1);
-                    }
-                    world.at_ref_normalized(hc).tileid = vvalue.as<int>();
-                }
-            }
-            std::cout << __func__ << " 8 \n";
-        } catch (std::exception& e) {
-            std::cerr << "World Gen failed: " << e.what() << '\n';
-        } catch (...) {
-            std::cerr << "World gen somehow failed\n";
+    // Replaces the world with a new one from the generator. Leaves the world as it was if the generator failed
+    bool RunWorldgen(const WorldGen& gen, const WorldGenOptions& options) {
+        auto generated = GenerateWorld(gen, options);
+        if (!generated.has_value()) {
+            return false;
         }
-    };
-};
\ No newline at end of file
+        world = std::move(*generated);
+        OnWorldReplaced();
+        return true;
+    }
+};
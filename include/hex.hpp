@@ -5,9 +5,10 @@
 #include <concepts>
 #include <utility>
 #include <optional>
-#include <raymath.h>
 #include <random>
 #include <algorithm>
+#include <cstdlib>
+#include <cstdint>
 #include "connection.hpp"
 
 /*
@@ -24,6 +25,9 @@ So, for example:
 struct HexCoords;
 struct EdgeCoords;
 struct HexData;
+struct HexRing;
+struct HexSpiral;
+struct HexLine;
 
 // Operators to get offsets from a cell. They are Left and Right combined with Up, Down, or just
 HexCoords operator "" _LU(unsigned long long x);
@@ -62,6 +66,11 @@ enum class Edge {
     LeftUp = 5, LU = 5
 };
 
+// Axial (q, r) offsets to the neighbours, in the same order as Edge and HexCoords::neighbours
+constexpr static std::array<std::array<int, 2>, 6> axial_directions = {{
+    {+1, -1}, {+1, 0}, {0, +1}, {-1, +1}, {-1, 0}, {0, -1}
+}};
+
 constexpr static float sqrt3 = 1.73205080757; // comes up in hex maths
 // because fucking modulo operator
 inline int positive_modulo(int i, int n) {
@@ -98,19 +107,199 @@ struct HexCoords {
     static HexCoords from_offset(int col, int row);
     std::vector<HexCoords> ring_around(int range) const;
     std::vector<HexCoords> spiral_around(int range) const;
+
+    // Same as the above, but computed while iterating, without allocating. Meant for range-for:
+    //     for (const auto hc : center.spiral(3)) { ... }
+    HexRing ring(int range) const;
+    HexSpiral spiral(int range) const;
+    static HexLine line(const HexCoords from, const HexCoords to);
+};
+
+// Offsets of a ring, by side: where the side starts at range 1, and the direction it goes in
+constexpr static std::array<std::array<int, 2>, 6> hex_ring_corners = {{
+    {-1, +1}, {0, +1}, {+1, 0}, {+1, -1}, {0, -1}, {-1, 0}
+}};
+constexpr static std::array<std::array<int, 2>, 6> hex_ring_steps = {{
+    {+1, 0}, {+1, -1}, {0, -1}, {-1, 0}, {-1, +1}, {0, +1}
+}};
+
+// Spirals up to this range are walked from a table of precomputed offsets
+constexpr static int HEX_OFFSET_TABLE_RANGE = 16;
+
+constexpr int hex_spiral_size(int range) {
+    return 1 + 3 * range * (range + 1);
+}
+
+// (q, r) offsets of spiral_around(HEX_OFFSET_TABLE_RANGE), in the same order
+constexpr static auto hex_spiral_offsets = [] {
+    std::array<std::array<int8_t, 2>, hex_spiral_size(HEX_OFFSET_TABLE_RANGE)> table{};
+    int at = 1;
+    for (int range = 1; range <= HEX_OFFSET_TABLE_RANGE; range++) {
+        for (int i = 0; i < range; i++) {
+            for (int side = 0; side < 6; side++) {
+                table[at][0] = static_cast<int8_t>(hex_ring_corners[side][0] * range + hex_ring_steps[side][0] * i);
+                table[at][1] = static_cast<int8_t>(hex_ring_corners[side][1] * range + hex_ring_steps[side][1] * i);
+                at++;
+            }
+        }
+    }
+    return table;
+}();
+
+struct HexRing {
+    struct iterator {
+        HexCoords center;
+        int range;
+        int step;
+        int side;
+
+        HexCoords operator*() const {
+            const auto [cq, cr] = hex_ring_corners[side];
+            const auto [sq, sr] = hex_ring_steps[side];
+            const int q = center.q + cq * range + sq * step;
+            const int r = center.r + cr * range + sr * step;
+            return HexCoords{q, r, -q - r};
+        }
+        iterator& operator++() {
+            if (++side == 6) {
+                side = 0;
+                step++;
+            }
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return step == other.step && side == other.side; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+    };
+
+    HexCoords center;
+    int range;
+
+    iterator begin() const { return {center, range, 0, 0}; }
+    iterator end() const { return {center, range, std::max(range, 0), 0}; }
+    size_t size() const { return range > 0 ? 6 * range : 0; }
+};
+
+// Center first, then ring after ring outwards
+struct HexSpiral {
+    struct iterator {
+        HexCoords center;
+        int index;
+        // ring and place on it, only used past the table
+        HexRing::iterator on_ring;
+
+        HexCoords operator*() const {
+            if (index < hex_spiral_size(HEX_OFFSET_TABLE_RANGE)) {
+                const auto [dq, dr] = hex_spiral_offsets[index];
+                return HexCoords{center.q + dq, center.r + dr, center.s - dq - dr};
+            }
+            return *on_ring;
+        }
+        iterator& operator++() {
+            index++;
+            if (index >= hex_spiral_size(HEX_OFFSET_TABLE_RANGE)) {
+                if (index == hex_spiral_size(HEX_OFFSET_TABLE_RANGE)) {
+                    on_ring = HexRing{center, HEX_OFFSET_TABLE_RANGE + 1}.begin();
+                } else if (++on_ring == HexRing{center, on_ring.range}.end()) {
+                    on_ring = HexRing{center, on_ring.range + 1}.begin();
+                }
+            }
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return index == other.index; }
+        bool operator!=(const iterator& other) const { return index != other.index; }
+    };
+
+    HexCoords center;
+    int range;
+
+    iterator begin() const { return {center, 0, {}}; }
+    iterator end() const { return {center, static_cast<int>(size()), {}}; }
+    size_t size() const { return range >= 0 ? hex_spiral_size(range) : 0; }
+};
+
+// Hexes on a straight line, see make_line
+struct HexLine {
+    struct iterator {
+        float x, y;
+        // how far one hex goes along the line
+        float step_x, step_y;
+        int index;
+
+        HexCoords operator*() const {
+            return HexCoords::from_world_unscaled(x + step_x * index, y + step_y * index);
+        }
+        iterator& operator++() {
+            index++;
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return index == other.index; }
+        bool operator!=(const iterator& other) const { return index != other.index; }
+    };
+
+    iterator first;
+    int steps;
+
+    iterator begin() const { return first; }
+    iterator end() const {
+        auto last = first;
+        last.index = steps;
+        return last;
+    }
+    size_t size() const { return steps; }
+};
+
+inline HexRing HexCoords::ring(int range) const {
+    return HexRing{*this, range};
+}
+
+inline HexSpiral HexCoords::spiral(int range) const {
+    return HexSpiral{*this, range};
+}
+
+inline HexLine HexCoords::line(const HexCoords from, const HexCoords to) {
+    const int steps = from.distance(to) + 1;
+    const auto inv_steps = 1.0f / steps;
+    const auto [sx, sy] = from.to_world_unscaled();
+    const auto [ex, ey] = to.to_world_unscaled();
+    return HexLine{{sx, sy, (ex - sx) * inv_steps, (ey - sy) * inv_steps, 0}, steps};
+}
+
+// Spreads the bits of a key over the whole hash, cheaply - a multiply moves low bits up, the shift brings them back down
+constexpr inline size_t mix_hash_bits(uint64_t x) {
+    x *= 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(x ^ (x >> 32));
+}
+
+// Axial coordinates packed into 32 bits, for hash maps and sets keyed by hexes.
+// q and r have to fit into 16 bits, which is plenty for any world we make.
+struct HexKey {
+    uint32_t packed = 0;
+
+    static constexpr HexKey from(int q, int r) {
+        return HexKey{(static_cast<uint32_t>(static_cast<uint16_t>(q)) << 16) | static_cast<uint16_t>(r)};
+    }
+    static constexpr HexKey from(const HexCoords hc) { return from(hc.q, hc.r); }
+
+    constexpr int q() const { return static_cast<int16_t>(packed >> 16); }
+    constexpr int r() const { return static_cast<int16_t>(packed & 0xFFFF); }
+    HexCoords coords() const { return HexCoords::from_axial(q(), r()); }
+
+    bool operator==(const HexKey&) const = default;
 };
 
 namespace std {
     template <>
     struct hash<HexCoords> {
         size_t operator()(const HexCoords& hc) const noexcept {
-            union {
-                size_t whole;
-                int parts[2];
-            } un;
-            un.parts[0] = hc.q;
-            un.parts[1] = hc.r;
-            return std::hash<size_t>()(un.whole);
+            // neighbouring hexes differ in the low bits of q and r only, so those have to reach the whole result
+            return mix_hash_bits(HexKey::from(hc).packed);
+        }
+    };
+
+    template <>
+    struct hash<HexKey> {
+        size_t operator()(const HexKey& key) const noexcept {
+            return mix_hash_bits(key.packed);
         }
     };
 }
@@ -131,7 +320,7 @@ struct HexData {
         SUPERIOR = 3
     };
 
-    Visibility getFractionVisibility(int fraction) {
+    Visibility getFractionVisibility(int fraction) const {
         return (Visibility) ((visibility_flags & (0b11 << (fraction * 2))) >> (fraction * 2));
     }
 
@@ -191,6 +380,10 @@ struct EdgeCoords {
     Edge edge;
 };
 
+// The world is split into chunks - squares in axial coordinates - so that systems can keep, rebuild
+// and stream their data per area. The last column and row of chunks can be narrower.
+constexpr static int WORLD_CHUNK_SIZE = 16;
+
 template<typename HexT>
 struct CylinderHexWorld {
     int width;
@@ -227,6 +420,70 @@ struct CylinderHexWorld {
         return compute_index(hc);
     }
 
+    HexCoords coords_of_index(int idx) const {
+        return HexCoords::from_axial(idx % width, idx / width);
+    }
+
+    // Index of an axial position, wrapping q around the cylinder. -1 if r is outside of the world
+    int wrapped_index(int q, int r) const {
+        if (r < 0 || r >= height) {
+            return -1;
+        }
+        return r * width + positive_modulo(q, width);
+    }
+
+    // Distance between two hexes, going around the cylinder if that is shorter
+    int wrapped_distance(const HexCoords a, const HexCoords b) const {
+        const int dq = positive_modulo(b.q - a.q, width);
+        const int dr = b.r - a.r;
+        const auto axial_distance = [&](int q) { return std::max({std::abs(q), std::abs(dr), std::abs(q + dr)}); };
+        return std::min(axial_distance(dq), axial_distance(dq - width));
+    }
+
+    int chunks_wide() const { return (width + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE; }
+    int chunks_high() const { return (height + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE; }
+    int chunk_count() const { return chunks_wide() * chunks_high(); }
+
+    // Chunk of a hex with normalized coordinates
+    int chunk_of(const HexCoords hc) const {
+        return (hc.r / WORLD_CHUNK_SIZE) * chunks_wide() + hc.q / WORLD_CHUNK_SIZE;
+    }
+
+    int chunk_of_index(int idx) const {
+        return chunk_of(coords_of_index(idx));
+    }
+
+    // Normalized coordinates of the first hex in the chunk, and the size of it (q, r)
+    std::pair<HexCoords, std::pair<int, int>> chunk_bounds(int chunk) const {
+        const int q = (chunk % chunks_wide()) * WORLD_CHUNK_SIZE;
+        const int r = (chunk / chunks_wide()) * WORLD_CHUNK_SIZE;
+        return {HexCoords::from_axial(q, r), {std::min(WORLD_CHUNK_SIZE, width - q), std::min(WORLD_CHUNK_SIZE, height - r)}};
+    }
+
+    // Chunks that hexes of the given chunk can step over to, without the chunk itself
+    std::vector<int> neighbour_chunks(int chunk) const {
+        // with square chunks in axial coordinates, hexes can only step over to these 6 chunks
+        constexpr std::array<std::array<int, 2>, 6> chunk_steps = {{
+            {+1, 0}, {-1, 0}, {0, +1}, {0, -1}, {+1, -1}, {-1, +1}
+        }};
+        const int cw = chunks_wide();
+        const int ch = chunks_high();
+        const int cx = chunk % cw;
+        const int cy = chunk / cw;
+        std::vector<int> result;
+        for (const auto [dx, dy] : chunk_steps) {
+            const int ny = cy + dy;
+            if (ny < 0 || ny >= ch) continue;
+            const int other = ny * cw + positive_modulo(cx + dx, cw);
+            if (other != chunk) {
+                result.push_back(other);
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
     HexT at(const HexCoords hc) {
         return at_ref_abnormal(hc).value_or(empty_hex);
     }
@@ -243,43 +500,4 @@ struct CylinderHexWorld {
     HexT &at_ref_normalized(const HexCoords hc) {
         return data.at(compute_index(normalized_coords(hc)));
     }
-
-    std::vector<HexCoords> all_within_unscaled_quad(
-            Vector2 top_left, Vector2 top_right, Vector2 bottom_left, Vector2 bottom_right
-    ) {
-        std::vector<HexCoords> line = ([&] {
-            std::vector<HexCoords> result;
-            // start from the top right
-            const auto bl = HexCoords::from_world_unscaled(bottom_left.x, bottom_left.y) + 1_LD;
-            const auto br = HexCoords::from_world_unscaled(bottom_right.x, bottom_right.y) + 1_RD;
-            const auto steps = bl.distance(br);
-            result.reserve(steps + 1);
-            result.push_back(bl);
-            for (int i = 0; i < steps; i++) {
-                result.push_back(result.back() + 1_R);
-            }
-            return result;
-        })();
-
-        std::vector<HexCoords> result;
-        result.insert(result.end(), line.begin(), line.end());
-
-        const auto limit_r = HexCoords::from_world_unscaled(top_left.x, top_left.y).r - 1;
-
-        while (line.front().r >= limit_r) {
-            std::vector<HexCoords> local_line;
-            local_line.reserve(line.size() + 2);
-            for (size_t i = 0; i < line.size(); i += 2) {
-                local_line.push_back(line.at(i) + 1_LU);
-                local_line.push_back(line.at(i) + 1_RU);
-            }
-            if (line.size() % 2 == 0) {
-                local_line.push_back(local_line.back() + 1_R);
-            }
-            result.insert(result.end(), local_line.begin(), local_line.end());
-            line = local_line;
-        }
-
-        return result;
-    }
 };
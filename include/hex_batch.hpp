@@ -0,0 +1,28 @@
+#pragma once
+#include <span>
+#include "hex.hpp"
+
+// Conversions between world positions and hexes for many points at once, for anything that maps whole
+// arrays of positions - unit interpolation, picking many things, minimap clicks.
+// The results are exactly the same as calling HexCoords::from_world_unscaled / to_world_unscaled for every point,
+// just computed 4 or 8 at a time with SSE2 or AVX2, whichever the CPU has. The choice is made once, at startup.
+
+enum class HexBatchKernel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// xs, ys and out have to be the same size
+void hexes_from_world_unscaled(std::span<const float> xs, std::span<const float> ys, std::span<HexCoords> out);
+
+// hexes, xs and ys have to be the same size
+void hexes_to_world_unscaled(std::span<const HexCoords> hexes, std::span<float> xs, std::span<float> ys);
+
+// The kernel the conversions use
+HexBatchKernel hex_batch_kernel();
+
+// Makes the conversions use a different kernel, for comparing them. Kernels the CPU can't run are ignored, returns the one in use
+HexBatchKernel set_hex_batch_kernel(HexBatchKernel kernel);
+
+const char* hex_batch_kernel_name(HexBatchKernel kernel);
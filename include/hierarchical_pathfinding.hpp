@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "pathfinding.hpp"
+#include "flat_hash_map.hpp"
+
+// Hierarchical A* (HPA*) for long range orders on big worlds
+// Every world chunk is a cluster. Where two clusters touch and both sides can be walked on, an entrance
+// (a pair of tiles, one on each side) is placed in the middle of every passable stretch of the border.
+// Costs between entrances of the same cluster are computed once and cached. Long queries are then
+// searched over the entrances only, which gives a list of waypoints, and the detailed path
+// between the waypoints is found with plain A* only when it's needed.
+//
+// The abstraction ignores units - they are taken into account when segments get refined.
+// Queries update the abstraction, so unlike Pathfinder, this is not meant to be used from many threads.
+struct HierarchicalPathfinder {
+    // queries closer than this many chunks are simply passed to the plain pathfinder
+    static constexpr int DIRECT_SEARCH_CHUNKS = 2;
+
+    // The costs are taken from the low level pathfinder, which has to outlive this object
+    explicit HierarchicalPathfinder(const Pathfinder& low_level) : m_low_level(low_level) {}
+
+    // Throws away everything and builds the abstraction of a new world
+    void rebuild(const CylinderHexWorld<HexData>& world);
+
+    // To be called when a tile changes in a way that might change movement (tileid, structures).
+    // The affected clusters are rebuilt before the next query.
+    void mark_changed(const CylinderHexWorld<HexData>& world, HexCoords hc);
+
+    // Rebuilds clusters marked as changed. Queries do this on their own
+    void update(const CylinderHexWorld<HexData>& world);
+
+    // Finds the route over the abstract graph. waypoints starts with `from` and ends with `to`, and like
+    // Pathfinder::find_path, is continuous in q. The refined path costs at most as much as the returned cost,
+    // unless the refinement has to go around units.
+    PathResult find_abstract_path(const CylinderHexWorld<HexData>& world, HexCoords from, HexCoords to, std::vector<HexCoords>& waypoints);
+
+    // Fills path with the detailed path from waypoints[segment] to waypoints[segment + 1]
+    PathResult refine_segment(
+        const CylinderHexWorld<HexData>& world, const std::vector<HexCoords>& waypoints, size_t segment,
+        std::vector<HexCoords>& path, const PathOptions& options = {}
+    ) const;
+
+    // Abstract search followed by refining every segment. Prefer refining lazily when only the next few steps are needed
+    PathResult find_path(
+        const CylinderHexWorld<HexData>& world, HexCoords from, HexCoords to,
+        std::vector<HexCoords>& path, const PathOptions& options = {}
+    );
+
+    size_t entrance_count() const;
+
+private:
+    struct Cluster {
+        // world indices of the entrance tiles in this cluster
+        std::vector<int> entrances;
+        // costs between the entrances, going only through the cluster. Row is the starting entrance, -1 if there's no way
+        std::vector<int> distances;
+        bool dirty = true;
+    };
+
+    const Pathfinder& m_low_level;
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<Cluster> m_clusters;
+    // index into Cluster::entrances for every tile of the world, -1 for tiles that are not entrances
+    std::vector<int> m_entrance_slot;
+    // pairs of tiles (the first one in the cluster with the lower index) chosen as entrances on every border
+    FlatHashMap<uint64_t, std::vector<std::pair<int, int>>> m_borders;
+
+    void rebuild_border(const CylinderHexWorld<HexData>& world, int a, int b);
+    void collect_entrances(const CylinderHexWorld<HexData>& world, int cluster);
+    // Dijkstra limited to one cluster, from `from` (forward), or towards it (reverse). Returns costs to every entrance
+    std::vector<int> costs_within_cluster(const CylinderHexWorld<HexData>& world, int cluster, int from, bool reverse) const;
+    void rebuild_distances(const CylinderHexWorld<HexData>& world, int cluster);
+};
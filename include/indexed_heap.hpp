@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Binary min-heap of integer items (0 .. capacity-1), that knows where every item is,
+// so priorities of items that are already queued can be changed, and items can be removed.
+// The position table is kept between uses - clear() only touches the items that are still queued,
+// so a heap sized for the whole world can be reused for many small searches without reallocating.
+template <typename Priority>
+struct IndexedMinHeap {
+    static constexpr int NOT_QUEUED = -1;
+
+    void reserve_items(size_t capacity) {
+        if (m_pos.size() < capacity) {
+            m_pos.resize(capacity, NOT_QUEUED);
+        }
+    }
+
+    bool empty() const { return m_heap.empty(); }
+    size_t size() const { return m_heap.size(); }
+    bool contains(int item) const { return m_pos[item] != NOT_QUEUED; }
+
+    int top() const { return m_heap.front().item; }
+    const Priority& top_priority() const { return m_heap.front().priority; }
+    const Priority& priority_of(int item) const { return m_heap[m_pos[item]].priority; }
+
+    // Inserts the item, or changes its priority if it's already queued
+    void push_or_update(int item, Priority priority) {
+        const int at = m_pos[item];
+        if (at == NOT_QUEUED) {
+            m_heap.push_back(Entry{priority, item});
+            m_pos[item] = static_cast<int>(m_heap.size()) - 1;
+            sift_up(m_heap.size() - 1);
+        } else if (priority < m_heap[at].priority) {
+            m_heap[at].priority = priority;
+            sift_up(at);
+        } else {
+            m_heap[at].priority = priority;
+            sift_down(at);
+        }
+    }
+
+    int pop() {
+        const int item = m_heap.front().item;
+        remove_at(0);
+        return item;
+    }
+
+    void remove(int item) {
+        const int at = m_pos[item];
+        if (at != NOT_QUEUED) {
+            remove_at(at);
+        }
+    }
+
+    void clear() {
+        for (const auto& entry : m_heap) {
+            m_pos[entry.item] = NOT_QUEUED;
+        }
+        m_heap.clear();
+    }
+
+private:
+    struct Entry {
+        Priority priority;
+        int item;
+    };
+
+    std::vector<Entry> m_heap;
+    std::vector<int> m_pos;
+
+    void place(size_t at, const Entry& entry) {
+        m_heap[at] = entry;
+        m_pos[entry.item] = static_cast<int>(at);
+    }
+
+    void remove_at(size_t at) {
+        m_pos[m_heap[at].item] = NOT_QUEUED;
+        const Entry last = m_heap.back();
+        m_heap.pop_back();
+        if (at == m_heap.size()) {
+            return;
+        }
+        place(at, last);
+        sift_up(at);
+        sift_down(m_pos[last.item]);
+    }
+
+    void sift_up(size_t at) {
+        const Entry entry = m_heap[at];
+        while (at > 0) {
+            const size_t parent = (at - 1) / 2;
+            if (!(entry.priority < m_heap[parent].priority)) break;
+            place(at, m_heap[parent]);
+            at = parent;
+        }
+        place(at, entry);
+    }
+
+    void sift_down(size_t at) {
+        const Entry entry = m_heap[at];
+        const size_t count = m_heap.size();
+        while (true) {
+            size_t child = at * 2 + 1;
+            if (child >= count) break;
+            if (child + 1 < count && m_heap[child + 1].priority < m_heap[child].priority) {
+                child++;
+            }
+            if (!(m_heap[child].priority < entry.priority)) break;
+            place(at, m_heap[child]);
+            at = child;
+        }
+        place(at, entry);
+    }
+};
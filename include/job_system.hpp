@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A pool of worker threads shared by everything that has work to spread out (flow fields, chunk baking, world generation).
+// Every worker has its own queue. New jobs go to the back of the queue of the thread that made them, workers take
+// from the back of their own queue, and when it's empty, steal from the front of the others'. Jobs made outside of
+// the workers (the main thread) go to a queue of their own, that the workers steal from.
+//
+// Jobs can wait for other jobs to finish first, which makes graphs of them:
+//     auto a = jobs.submit([] { ... });
+//     auto b = jobs.submit([] { ... });
+//     auto c = jobs.submit([] { ... }, {a, b});   // after both
+//     jobs.wait(c);
+// A thread waiting for a job runs other jobs meanwhile, so jobs can wait for jobs, and parallel_for can be nested.
+// Jobs that take long (making a whole world) are submitted with submit_long, and only the workers take those, so that
+// waiting for a short job never ends up running a long one.
+// Exceptions thrown by a job come out of wait().
+// Anything that has to happen on the main thread (raylib calls, touching the game state) goes through on_main_thread,
+// those run at a safe point between frames (see BehaviourStack::run).
+class JobSystem {
+public:
+    struct Job;
+    using Handle = std::shared_ptr<Job>;
+
+    struct Job {
+        std::function<void()> fn;
+        // jobs it still waits for, and one for submit() while it's setting the job up
+        std::atomic<int> waiting_for{1};
+        std::atomic<bool> finished{false};
+        // only the workers run it, see submit_long
+        bool long_running = false;
+        std::exception_ptr error;
+        // guards done and the continuations
+        std::mutex mutex;
+        bool done = false;
+        std::vector<Handle> continuations;
+    };
+
+    // 0 workers means one less than there are cores, at least one
+    explicit JobSystem(int workers = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator= (const JobSystem&) = delete;
+
+    // How many workers to use when nothing else says so: STRATGAME_THREADS from the environment, 0 (automatic) if it's not set
+    static int workers_from_environment();
+
+    int worker_count() const { return static_cast<int>(m_workers.size()); }
+
+    // Runs fn on a worker, once every job in `after` is finished
+    Handle submit(std::function<void()> fn, std::initializer_list<Handle> after = {});
+    Handle submit(std::function<void()> fn, const std::vector<Handle>& after);
+    // For a job that takes long, like generating a world. It isn't taken by threads waiting in wait(), they'd be stuck
+    // with it - a worker runs it, in its own loop
+    Handle submit_long(std::function<void()> fn, const std::vector<Handle>& after = {});
+
+    // Runs other jobs until this one is finished. Rethrows what the job threw
+    void wait(const Handle& job);
+    void wait(const std::vector<Handle>& jobs);
+
+    // Calls fn(i) for every i in [begin, end), spread over the workers in runs of at least `grain`, and returns when all are done.
+    // The calling thread takes the first run itself
+    template <typename F>
+    void parallel_for(int begin, int end, int grain, F&& fn) {
+        const int count = end - begin;
+        if (count <= 0) {
+            return;
+        }
+        // a few runs per thread, so that the faster ones can take over from the slower ones
+        const int max_runs = 4 * (worker_count() + 1);
+        const int runs = std::clamp((count + std::max(grain, 1) - 1) / std::max(grain, 1), 1, max_runs);
+        const auto run_bounds = [&](int run) {
+            return std::pair<int, int>{begin + static_cast<int>(static_cast<long long>(count) * run / runs),
+                                       begin + static_cast<int>(static_cast<long long>(count) * (run + 1) / runs)};
+        };
+        std::vector<Handle> jobs;
+        jobs.reserve(runs - 1);
+        for (int run = 1; run < runs; run++) {
+            jobs.push_back(submit([&fn, bounds = run_bounds(run)] {
+                for (int i = bounds.first; i < bounds.second; i++) {
+                    fn(i);
+                }
+            }));
+        }
+        std::exception_ptr error;
+        try {
+            const auto [from, to] = run_bounds(0);
+            for (int i = from; i < to; i++) {
+                fn(i);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // the other runs point at fn, so they're waited for even when this one threw
+        try {
+            wait(jobs);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // fn(chunk) for every chunk of the world
+    template <typename World, typename F>
+    void for_each_chunk(const World& world, F&& fn) {
+        parallel_for(0, world.chunk_count(), 1, std::forward<F>(fn));
+    }
+
+    // Runs fn on the main thread, the next time run_main_thread_callbacks is called
+    void on_main_thread(std::function<void()> fn);
+    // Runs fn on the main thread once the job is finished
+    Handle then_on_main_thread(const Handle& job, std::function<void()> fn);
+    // For the main thread only. Runs what was queued by on_main_thread until now
+    void run_main_thread_callbacks();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Handle> jobs;
+    };
+
+    std::vector<std::thread> m_workers;
+    // one per worker, and the last one for everyone else
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    // the long jobs, for the workers only
+    Queue m_long_queue;
+    // jobs sitting in the queues, and in the long one
+    std::atomic<int> m_queued{0};
+    std::atomic<int> m_long_queued{0};
+    // threads in wait(), they need to hear about every finished job
+    std::atomic<int> m_waiting{0};
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    std::mutex m_main_mutex;
+    std::vector<std::function<void()>> m_main_callbacks;
+
+    void work(int index);
+    // the queue of the calling thread
+    int queue_index() const;
+    Handle submit(std::function<void()> fn, const std::vector<Handle>& after, bool long_running);
+    void schedule(Handle job);
+    // long jobs are only taken by the workers' loops
+    bool run_one(bool take_long);
+    void run(Handle job);
+    void wake_waiters();
+};
@@ -4,12 +4,14 @@
 #include <sol/sol.hpp>
 #include <filesystem>
 #include <iostream>
+#include <optional>
 #include <concepts>
 #include <unordered_map>
 #include <unordered_set>
 #include <variant>
 #include <string>
 #include "utils.hpp"
+#include "profiler.hpp"
 #include "issues.hpp"
 
 struct Module;
@@ -27,6 +29,12 @@ struct Module {
     std::string name_unsafe () const;
 };
 
+// A module running in a VM that isn't the one the loader keeps, see ModuleLoader::Instantiate
+struct ModuleInstance {
+    sol::state state;
+    sol::table root;
+};
+
 template <typename T>
 concept ModuleExtention = requires(T ext, sol::state ss) {
     { ext.InjectSymbols(ss) };
@@ -69,6 +77,42 @@ struct ModuleLoader {
         LoadLuaTRec(lua, ms...);
     }
 
+    // Sets up a VM for the module in modpath - libraries, symbols of the extensions, imports - and runs the module code in it
+    template <ModuleExtention ...ExtentionTS>
+    sol::protected_function_result RunModule(sol::state& lua, const std::filesystem::path& modpath, ExtentionTS&... extentions) {
+        // load parts of standard lua library, and the FFI for the hot loops of world generators (see WorldGenMap)
+        lua.open_libraries(sol::lib::base, sol::lib::jit, sol::lib::ffi, sol::lib::string, sol::lib::package, sol::lib::math, sol::lib::table, sol::lib::os);
+        // load custom stuff
+        LoadLuaTRec(lua, *this, extentions...);
+
+        // allow lua to import from the module directory
+        std::string package_path = lua["package"]["path"];
+        lua["package"]["path"] = package_path + (!package_path.empty() ? ";" : "") + std::filesystem::absolute(modpath).string() + "/?.lua";
+
+        // run the module code
+        PROFILE_ZONE("lua: module");
+        return lua.safe_script_file((modpath / "mod.lua").string());
+    }
+
+    // A VM of its own for a module that's already loaded, for work that can't share the module's VM, like world generation
+    // on the workers. The module code runs again in it, with the extensions given - only give the ones that are fine to use
+    // from another thread. Nothing if the module failed to run. Doesn't touch the loader, so it can be called from any thread
+    template <ModuleExtention ...ExtentionTS>
+    std::optional<ModuleInstance> Instantiate(const std::string& entry_point, ExtentionTS&... extentions) {
+        ModuleInstance instance;
+        sol::protected_function_result res = RunModule(instance.state, std::filesystem::path(entry_point).parent_path(), extentions...);
+        if (!res.valid()) {
+            sol::error err = res;
+            logging::error("Couldn't make another VM for", entry_point, "-", err.what());
+            return {};
+        }
+        if (res.get_type() != sol::type::table) {
+            return {};
+        }
+        instance.root = res.get<sol::table>();
+        return instance;
+    }
+
     // Start running lua modules
     template <ModuleExtention ...ExtentionTS>
     std::vector<issues::AnyIssue> LoadModules(const std::vector<std::filesystem::path>& module_paths, ExtentionTS&... extentions) {
@@ -85,18 +129,7 @@ struct ModuleLoader {
                 }
 
                 sol::state lua;
-            
-                // load parts of standard lua library
-                lua.open_libraries(sol::lib::base, sol::lib::jit, sol::lib::string, sol::lib::package, sol::lib::math, sol::lib::table, sol::lib::os);
-                // load custom stuff
-                LoadLuaTRec(lua, *this, extentions...);
-                
-                // allow lua to import from the module directory
-                std::string package_path = lua["package"]["path"];
-                lua["package"]["path"] = package_path + (!package_path.empty() ? ";" : "") + std::filesystem::absolute(modpath).string() + "/?.lua";
-
-                // run the module code
-                auto res = lua.safe_script_file(entry_point.string());
+                sol::protected_function_result res = RunModule(lua, modpath, extentions...);
                 if (!res.valid()) {
                     sol::error err = res;
                     issues.push_back(issues::LuaError{.message = err.what() });
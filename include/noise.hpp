@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+class JobSystem;
+
+// Coherent noise for the world generators. The same seed gives the same numbers on every platform and compiler,
+// as the permutation tables are shuffled with our own generator, not with <random>.
+namespace noise {
+    enum class Basis {
+        Perlin,
+        Simplex,
+        Value
+    };
+
+    enum class Fractal {
+        // just the basis, at the frequency
+        None,
+        // octaves of the basis added up, about -1..1
+        FBm,
+        // octaves of 1 - |basis| squared, sharp ridges where the basis crosses 0, 0..1
+        Ridged
+    };
+
+    struct Settings {
+        Basis basis = Basis::Perlin;
+        Fractal fractal = Fractal::FBm;
+        uint32_t seed = 0;
+        int octaves = 1;
+        double frequency = 1.0;
+        // how much faster each octave goes than the one before
+        double lacunarity = 2.0;
+        // how much weaker each octave is than the one before
+        double persistence = 0.5;
+    };
+
+    // The lattice of one seed. Every basis hashes its lattice points with the same table
+    class Source {
+    public:
+        explicit Source(uint32_t seed);
+
+        // all about -1..1
+        double perlin(double x, double y, double z) const;
+        double simplex(double x, double y, double z) const;
+        double value(double x, double y, double z) const;
+        double basis(Basis b, double x, double y, double z) const;
+
+    private:
+        // twice over, so that hashing never has to wrap
+        std::array<uint8_t, 512> m_perm;
+
+        int hash(int x, int y, int z) const {
+            return m_perm[m_perm[m_perm[x & 255] + (y & 255)] + (z & 255)];
+        }
+    };
+
+    // The fractal of the settings at one point
+    double sample(const Source& source, const Settings& settings, double x, double y, double z = 0.0);
+
+    // x goes around a cylinder `period` long, so that the noise at x and at x + period is the same, without a seam
+    double sample_cylinder(const Source& source, const Settings& settings, double x, double y, double period);
+
+    // Fills out[y * width + x] for a whole grid in one go - what world generators want, one layer at a time.
+    // The grid is sampled at (x / width, y / width), so the frequency is in features across the width, and the features
+    // are as tall as they are wide. With cylinder, the left and the right edge meet, like the world does.
+    // Rows are spread over the jobs when there are any. Every cell is exactly what sample / sample_cylinder would give,
+    // however the rows got split
+    void fill(const Source& source, const Settings& settings, int width, int height, bool cylinder, std::span<float> out, JobSystem* jobs = nullptr);
+
+    // A part of that grid: the width x height cells from column x0 and row y0 (0 based) of a grid world_width wide, into
+    // out[y * width + x]. The cells are the same as in the whole grid, so the parts of a world can be made separately
+    void fill_region(const Source& source, const Settings& settings, int x0, int y0, int width, int height, int world_width, bool cylinder, std::span<float> out, JobSystem* jobs = nullptr);
+
+    std::optional<Basis> basis_from_name(std::string_view name);
+    std::optional<Fractal> fractal_from_name(std::string_view name);
+};
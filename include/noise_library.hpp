@@ -0,0 +1,17 @@
+#pragma once
+#include "module.hpp"
+#include "noise.hpp"
+
+// Gives the modules the Noise table, so that world generators don't have to make noise in Lua, one sample at a time:
+//     local terrain = Noise.new{ basis = "simplex", fractal = "fbm", seed = 13, octaves = 6, frequency = 4 }
+//     local grid = terrain:fill(width, height)         -- grid[y][x], seamless around the world unless a third `false` is given
+//     local one = terrain:sampleCylinder(x, y, width)  -- or terrain:sample(x, y [, z]) for flat noise
+//     local part = terrain:fillRegion(x, y, w, h, width) -- part[1][1] is grid[y][x], for chunk generators
+// basis is "perlin", "simplex" or "value", fractal is "none", "fbm" or "ridged". The rest of the settings are
+// lacunarity and persistence, see noise::Settings
+struct NoiseLibrary {
+    // the fills spread their rows over these, if there are any
+    JobSystem* m_jobs = nullptr;
+
+    void InjectSymbols(sol::state& lua);
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include "pathfinding.hpp"
+#include "flat_hash_map.hpp"
+
+// Incremental search for the path preview. The unit stays put while the goal follows the mouse around,
+// so the search is kept between queries instead of starting over every frame.
+// This is D* Lite with the roles turned around - costs are kept from the unit, and the moving end is the goal,
+// which D* Lite handles without touching the open set (the km offset). When a few tiles change, only they
+// are queued again, and the search repairs whatever depended on them.
+//
+// The unit store isn't watched, so changes to units have to be reported with mark_changed like terrain changes.
+// Works on the whole world, so keep it to goals at most a few chunks away, like the plain pathfinder.
+struct PathPlanner {
+    // The costs are taken from the pathfinder, which has to outlive this object
+    explicit PathPlanner(const Pathfinder& costs) : m_costs(costs) {}
+
+    // Same as Pathfinder::find_path, but continues the last search if it was from the same hex with the same options
+    PathResult plan(
+        const CylinderHexWorld<HexData>& world, HexCoords from, HexCoords to,
+        std::vector<HexCoords>& path, const PathOptions& options = {}
+    );
+
+    // To be called when a tile changes in a way that might change movement, or a unit steps on or off it
+    void mark_changed(const CylinderHexWorld<HexData>& world, HexCoords hc);
+
+    // Forgets the search, the next plan starts from scratch
+    void reset() { m_root = -1; }
+
+private:
+    using Key = std::pair<int, int>;
+    static constexpr int UNKNOWN = std::numeric_limits<int>::max() / 4;
+
+    const Pathfinder& m_costs;
+    // what the kept search is for
+    int m_root = -1;
+    int m_goal = -1;
+    int m_width = 0;
+    int m_height = 0;
+    PathOptions m_options;
+    // sum of heuristic distances between the goals so far, keeps old keys lower bounds of the new ones
+    int m_km = 0;
+
+    // per tile, valid only when stamped with the current generation
+    std::vector<uint32_t> m_stamp;
+    std::vector<int> m_g;
+    std::vector<int> m_rhs;
+    std::vector<int> m_step_cost;
+    uint32_t m_generation = 0;
+    IndexedMinHeap<Key> m_open;
+    // tiles reported since the last plan, once each however often they change
+    FlatHashSet<int> m_changed;
+
+    void restart(const CylinderHexWorld<HexData>& world, int root, int goal, const PathOptions& options);
+    bool touched(int idx) const { return m_stamp[idx] == m_generation; }
+    void touch(const CylinderHexWorld<HexData>& world, int idx);
+    int step_cost(const CylinderHexWorld<HexData>& world, int idx) const;
+    Key key(const CylinderHexWorld<HexData>& world, int idx) const;
+    void update_tile(const CylinderHexWorld<HexData>& world, int idx);
+    void update_around(const CylinderHexWorld<HexData>& world, int idx);
+    int search(const CylinderHexWorld<HexData>& world);
+};
+
+// A path that was planned for a unit, remembered so that the preview doesn't search every frame,
+// and confirming the order doesn't search again
+struct PlannedPath {
+    HexCoords from;
+    HexCoords to;
+    UnitType type = UnitType::Unspecified;
+    PathResult result;
+    std::vector<HexCoords> path;
+    bool valid = false;
+
+    bool matches(HexCoords f, HexCoords t, UnitType ut) const {
+        return valid && from == f && to == t && type == ut;
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include "hex.hpp"
+#include "units.hpp"
+#include "indexed_heap.hpp"
+
+// Memory for searches over the whole world, meant to be kept per thread and reused.
+// Instead of clearing the per-tile arrays before every search, tiles are stamped with the
+// generation of the search that touched them, and anything with an older stamp counts as untouched.
+struct SearchScratch {
+    std::vector<uint32_t> stamp;
+    std::vector<int> cost;
+    std::vector<int> came_from;
+    IndexedMinHeap<int> open;
+    uint32_t generation = 0;
+
+    // Starts a new search over a world with tile_count tiles
+    void begin(size_t tile_count);
+
+    bool touched(int idx) const { return stamp[idx] == generation; }
+
+    void touch(int idx, int new_cost, int from) {
+        stamp[idx] = generation;
+        cost[idx] = new_cost;
+        came_from[idx] = from;
+    }
+};
+
+struct PathOptions {
+    // When set, tiles holding a unit of blocking_type cannot be entered
+    const UnitStore* units = nullptr;
+    UnitType blocking_type = UnitType::Unspecified;
+    // Search gives up on anything more expensive than this
+    int max_cost = std::numeric_limits<int>::max();
+};
+
+struct PathResult {
+    bool found = false;
+    int cost = 0;
+    // how many tiles were taken out of the open set, for diagnostics
+    int expanded = 0;
+};
+
+// A* on the cylinder world. Moving onto a hex costs the HexKind::movement_cost of that hex.
+// Empty hexes and hexes with a movement cost below 1 cannot be entered.
+struct Pathfinder {
+    static constexpr int IMPASSABLE = -1;
+
+    Pathfinder() = default;
+    // movement_costs is indexed by tileid
+    explicit Pathfinder(const std::vector<int>& movement_costs);
+
+    void set_movement_costs(const std::vector<int>& movement_costs);
+
+    // Cost of moving onto the tile at the world index, or IMPASSABLE
+    int entering_cost(const CylinderHexWorld<HexData>& world, int idx) const {
+        const unsigned tileid = world.data[idx].tileid;
+        return tileid < m_costs.size() ? m_costs[tileid] : IMPASSABLE;
+    }
+
+    // The most a single step can cost
+    int max_step_cost() const { return m_max_cost; }
+
+    // Lower bound on the cost of getting from a to b, aware of the wrap in q
+    int heuristic(const CylinderHexWorld<HexData>& world, const HexCoords a, const HexCoords b) const {
+        return world.wrapped_distance(a, b) * m_min_cost;
+    }
+
+    // Fills path with the hexes from `from` to `to`, both included. The path is continuous in q and starts at
+    // `from` as given, so like the rendered coordinates, it may leave the 0..width range when it crosses the wrap.
+    // The search memory is thread local, so this can be called from many threads at once.
+    PathResult find_path(
+        const CylinderHexWorld<HexData>& world, HexCoords from, HexCoords to,
+        std::vector<HexCoords>& path, const PathOptions& options = {}
+    ) const;
+
+    // Rewrites a path of normalized coordinates, so that it starts at `from` and every step is to a neighbour
+    static void unwrap_path(const CylinderHexWorld<HexData>& world, HexCoords from, std::vector<HexCoords>& path);
+
+private:
+    std::vector<int> m_costs;
+    int m_min_cost = 1;
+    int m_max_cost = 1;
+};
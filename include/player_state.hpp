@@ -1,17 +1,23 @@
 #pragma once
+#include "app_state.hpp"
 #include "game_state.hpp"
 #include "rendering_controller.hpp"
+#include "terrain_renderer.hpp"
+#include "unit_renderer.hpp"
 #include "units.hpp"
 #include <optional>
 #include <memory>
 
 struct PlayerState {
     int fraction = 0;
+    std::shared_ptr<AppState> app_state;
     std::shared_ptr<GameState> gs;
     RenderingController rendering_controller;
+    TerrainRenderer terrain_renderer;
+    UnitRenderer unit_renderer;
     std::optional<std::pair<HexCoords, UnitType>> selected_unit;
 
-    PlayerState(std::shared_ptr<GameState> gs) : gs(gs) {}
+    PlayerState(std::shared_ptr<AppState> as, std::shared_ptr<GameState> gs) : app_state(as), gs(gs) {}
 
     PlayerState(const PlayerState&) = delete;
     PlayerState(PlayerState&&) = delete;
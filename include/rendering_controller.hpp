@@ -1,45 +1,81 @@
 #pragma once
 #include <vector>
+#include <span>
+#include <cstdint>
+#include <raylib.h>
 #include "hex.hpp"
 
+// Where a ray hits the horizontal plane at the given height
+Vector3 intersect_with_ground_plane(const Ray ray, float plane_height);
+
+// One row of visible hexes, from q_from to q_to, both included. q is not wrapped around the world,
+// so that the hexes can be drawn where the camera sees them
+struct HexRowSpan {
+    int r;
+    int q_from;
+    int q_to;
+};
+
+// A visible chunk, and how many times it is moved around the world (by world width) to be where the camera sees it.
+// For drawing whole chunks at once
+struct ChunkPlacement {
+    int chunk;
+    int wrap;
+
+    bool operator==(const ChunkPlacement&) const = default;
+    auto operator<=>(const ChunkPlacement&) const = default;
+};
+
+// Decides what the camera sees. The visible hexes are only recomputed when the camera (or the screen) changes,
+// and are kept as spans of rows, which is all that's needed to walk them.
+// Also keeps the chunks the spans touch, and which of them came into and out of the view with this update,
+// for anything that keeps data per visible chunk.
 struct RenderingController {
+    // To be called every frame, before the spans are used. Returns whether the view changed
+    bool update_visible(const Camera3D& camera, const CylinderHexWorld<HexData>& world);
+
+    std::span<const HexRowSpan> visible_rows() const { return m_rows; }
+    // Whether the hex, with q not wrapped (as in the spans), is one of the visible ones
+    bool is_visible(HexCoords hc) const;
+    size_t visible_hex_count() const { return m_hex_count; }
+    // Goes up every time the visible hexes change, for keeping things built from them
+    uint32_t view_revision() const { return m_revision; }
+
+    // Sorted chunk indices. The added and removed lists are empty when the view didn't change
+    std::span<const int> visible_chunks() const { return m_chunks; }
+    std::span<const int> added_chunks() const { return m_added_chunks; }
+    std::span<const int> removed_chunks() const { return m_removed_chunks; }
+    // Every visible chunk with where it is drawn. When zoomed out over the whole width, a chunk can be there more than once
+    std::span<const ChunkPlacement> visible_placements() const { return m_placements; }
+
+    // Makes the next update recompute everything, for when the world is replaced
+    void invalidate() { m_valid = false; }
+
+private:
+    struct ViewKey {
+        Matrix view;
+        float fovy;
+        int projection;
+        int screen_width;
+        int screen_height;
+        int world_width;
+        int world_height;
+
+        bool operator==(const ViewKey& other) const;
+    };
+
+    bool m_valid = false;
+    ViewKey m_key;
+    uint32_t m_revision = 0;
+    std::vector<HexRowSpan> m_rows;
+    size_t m_hex_count = 0;
+    std::vector<int> m_chunks;
+    std::vector<int> m_added_chunks;
+    std::vector<int> m_removed_chunks;
+    std::vector<ChunkPlacement> m_placements;
+    // scratch for the chunks of the new view
+    std::vector<int> m_new_chunks;
 
-    std::vector<HexCoords> all_within_unscaled_quad (
-        Vector2 top_left, Vector2 top_right, Vector2 bottom_left, Vector2 bottom_right
-    ) {
-        std::vector<HexCoords> line = ([&]{
-            std::vector<HexCoords> result;
-            // start from the top right
-            const auto bl = HexCoords::from_world_unscaled(bottom_left.x, bottom_left.y) + 1_LD; 
-            const auto br = HexCoords::from_world_unscaled(bottom_right.x, bottom_right.y) + 1_RD;
-            const auto steps = bl.distance(br);
-            result.reserve(steps+1);
-            result.push_back(bl);
-            for(int i = 0; i < steps; i++) {
-                result.push_back(result.back() + 1_R);
-            }
-            return result;
-        })();
-        
-        std::vector<HexCoords> result;
-        result.insert(result.end(), line.begin(), line.end());
-
-        const auto limit_r = HexCoords::from_world_unscaled(top_left.x, top_left.y).r - 1;
-
-        while(line.front().r >= limit_r) {
-            std::vector<HexCoords> local_line;
-            local_line.reserve(line.size() + 2);
-            for(size_t i = 0; i < line.size(); i += 2) {
-                local_line.push_back(line.at(i) + 1_LU);
-                local_line.push_back(line.at(i) + 1_RU);
-            }
-            if (line.size() % 2 == 0) {
-                local_line.push_back(local_line.back() + 1_R);
-            }
-            result.insert(result.end(), local_line.begin(), local_line.end());
-            line = local_line;
-        }
-
-        return result;
-    }
-};
\ No newline at end of file
+    void compute_rows(std::array<Vector2, 4> corners, const CylinderHexWorld<HexData>& world);
+    void compute_chunks(const CylinderHexWorld<HexData>& world);
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <vector>
+#include "game_state.hpp"
+
+// What the renderer needs from the last tick. Units are drawn somewhere between from and to of their step,
+// depending on how far the clock got towards the next tick
+struct SimulationSnapshot {
+    uint64_t tick = 0;
+    // when the tick was due
+    std::chrono::steady_clock::time_point time{};
+    // what moved in the last tick, and in all of the ticks since the snapshot before, for things that follow units around
+    std::vector<UnitStep> steps;
+    std::vector<UnitStep> steps_since_last;
+};
+
+struct SimulationSettings {
+    int ticks_per_second = 20;
+    // after a hitch, at most this many ticks are run to catch up, the rest is dropped
+    int max_catch_up_ticks = 5;
+};
+
+// Runs GameState::Tick at a fixed rate, no matter how fast frames are drawn: advance() runs the ticks that are due, once
+// per frame, on the main thread (like everything else that touches the game state, the network included). The latest
+// tick is kept as a snapshot (double buffered, the ticks write the back one), and the renderer draws units in between
+// ticks with interpolation_alpha
+class Simulation {
+public:
+    struct Stats {
+        uint64_t ticks = 0;
+        // ticks that were skipped, because there was no time to run them
+        uint64_t dropped = 0;
+        float last_tick_ms = 0.0f;
+        float max_tick_ms = 0.0f;
+        float average_tick_ms = 0.0f;
+    };
+
+    Simulation(GameState& gs, SimulationSettings settings = {});
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator= (const Simulation&) = delete;
+
+    // Once per frame. Runs the ticks that are due, and takes the latest snapshot.
+    // Returns false if no tick happened since the last call, the snapshot is the same then
+    bool advance();
+
+    // The last tick, as of the last advance()
+    const SimulationSnapshot& snapshot() const { return m_front; }
+    // 0 at the last tick, 1 when the next one is due
+    float interpolation_alpha() const;
+
+    std::chrono::steady_clock::duration tick_length() const { return m_tick_length; }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    GameState& m_gs;
+    SimulationSettings m_settings;
+    std::chrono::steady_clock::duration m_tick_length;
+    // when the next tick is due
+    std::chrono::steady_clock::time_point m_next_tick;
+
+    // the tick writes to the back, advance() swaps it to the front if there's something new
+    SimulationSnapshot m_back;
+    SimulationSnapshot m_front;
+    bool m_back_is_new = false;
+    Stats m_stats;
+    double m_total_tick_ms = 0.0;
+    std::vector<UnitStep> m_tick_steps;
+
+    void run_due_ticks();
+    void run_tick(std::chrono::steady_clock::time_point due);
+};
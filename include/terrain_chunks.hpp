@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory_resource>
+#include <span>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <raylib.h>
+#include "hex.hpp"
+#include "rendering_controller.hpp"
+#include "resources.hpp"
+#include "job_system.hpp"
+
+struct TerrainFrame;
+
+// Terrain baked per world chunk. All tiles of a chunk that use the same mesh (of the same tile kind) are merged
+// into one mesh, so a chunk is drawn with a few DrawMesh calls. The merging is done by jobs of the JobSystem, from
+// a copy of the chunk's tiles, and the result is uploaded on the main thread when it's ready.
+// A chunk is baked again when its revision (GameState::chunk_revisions) changes. Chunks that aren't drawn anymore are dropped.
+struct TerrainChunkBaker {
+    struct Stats {
+        // what's on the gpu now
+        int chunks = 0;
+        int meshes = 0;
+        size_t vertices = 0;
+        size_t gpu_bytes = 0;
+        // chunks waiting for a job, being baked, or waiting to be uploaded
+        int pending = 0;
+        // since the start
+        int bakes = 0;
+        double total_bake_ms = 0.0;
+        double max_bake_ms = 0.0;
+        // this frame
+        int draw_calls = 0;
+        size_t triangles = 0;
+    };
+
+    TerrainChunkBaker() = default;
+    ~TerrainChunkBaker();
+
+    TerrainChunkBaker(const TerrainChunkBaker&) = delete;
+    TerrainChunkBaker(TerrainChunkBaker&&) = delete;
+    TerrainChunkBaker& operator= (const TerrainChunkBaker&) = delete;
+    TerrainChunkBaker& operator= (TerrainChunkBaker&&) = delete;
+
+    // Where the chunks get baked. Without it, they're baked right away, on the calling thread
+    void load(JobSystem& jobs) { m_job_system = &jobs; }
+    // Once per frame, before drawing. Takes the chunks that are going to be drawn (sorted), uploads what the jobs
+    // finished, and asks for the ones that are out of date. The rest is dropped
+    void update(std::span<const int> chunks, const TerrainFrame& frame);
+    // False when the chunk isn't baked yet, then the caller has to draw it some other way
+    bool draw(ChunkPlacement placement, const TerrainFrame& frame, Shader shader);
+    // Frees the meshes, has to be called while the window is still open
+    void unload();
+
+    const Stats& stats() const { return m_stats; }
+
+private:
+    // tiles of a chunk, in the chunk's own space
+    struct Job {
+        int chunk;
+        uint32_t revision;
+        uint32_t generation;
+        int size_q;
+        int size_r;
+        // tileid for every hex of the chunk (q + r * WORLD_CHUNK_SIZE), -1 where nothing is drawn
+        std::vector<int> tiles;
+        float scale;
+        const std::vector<HexKind>* kinds;
+    };
+
+    // one merged mesh, still on the cpu
+    struct BakedMesh {
+        int kind;
+        int mesh;
+        std::vector<float> vertices;
+        std::vector<float> normals;
+        std::vector<float> texcoords;
+        std::vector<unsigned char> colors;
+        // first vertex and vertex count of every hex of the chunk, for tinting a single tile
+        std::vector<std::pair<int, int>> tile_vertices;
+    };
+
+    struct Result {
+        int chunk;
+        uint32_t revision;
+        uint32_t generation;
+        std::vector<BakedMesh> meshes;
+        double bake_ms;
+    };
+
+    struct ChunkMesh {
+        int kind;
+        int mesh;
+        Mesh gpu;
+        size_t bytes;
+        std::vector<std::pair<int, int>> tile_vertices;
+    };
+
+    struct Chunk {
+        // what the meshes were baked from
+        bool baked = false;
+        uint32_t revision = 0;
+        uint32_t generation = 0;
+        // what was last asked for
+        bool requested = false;
+        uint32_t requested_revision = 0;
+        uint32_t requested_generation = 0;
+        bool in_view = false;
+        std::vector<ChunkMesh> meshes;
+    };
+
+    std::vector<Chunk> m_chunks;
+    // what was drawn the last time, the baker isn't necessarily updated every frame
+    std::vector<int> m_in_view;
+    std::vector<int> m_left_view;
+    // changes whenever everything has to be baked again
+    uint32_t m_generation = 0;
+    int m_world_width = 0;
+    int m_world_height = 0;
+    float m_scale = 0.0f;
+    HexCoords m_hovered = HexCoords::from_axial(0, 0);
+
+    JobSystem* m_job_system = nullptr;
+    std::mutex m_mutex;
+    // told whenever a job is done
+    std::condition_variable m_idle;
+    // the chunks to bake, in order. Jobs take them from the front, so a chunk that's not wanted anymore can still be taken out
+    std::deque<Job> m_jobs;
+    std::vector<Result> m_results;
+    // jobs that were submitted and haven't finished, and how many of them are baking
+    int m_running = 0;
+    int m_baking = 0;
+
+    Stats m_stats;
+
+    // what every job does, bakes the first chunk waiting for it
+    void bake_next();
+    static Result bake(const Job& job);
+    void request(int chunk, const TerrainFrame& frame);
+    void upload(Result& result, std::pmr::memory_resource& scratch);
+    void free_meshes(Chunk& chunk);
+    void drop(int chunk);
+    void drop_all();
+    // chunk and index within the chunk of a hex, -1 for both when it's not on the map
+    std::pair<int, int> locate(HexCoords hc) const;
+    // the scratch memory is only used during the call (a FrameArena)
+    void set_tint(HexCoords hc, Color tint, std::pmr::memory_resource& scratch);
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <memory_resource>
+#include <raylib.h>
+#include "hex.hpp"
+#include "field_of_view.hpp"
+
+// The visibility of every tile to the current fraction, as a texture with a texel per tile (axial q, r).
+// The terrain shaders look the hex of every fragment up in it, and darken or hide it, so nothing on the cpu
+// has to care about what can be seen. Only the hexes that changed are uploaded, a row run at a time.
+struct TerrainFog {
+    // texture unit the fog is bound to while the terrain is drawn, above the ones raylib uses for materials
+    constexpr static int TEXTURE_SLOT = 15;
+
+    struct Stats {
+        // this frame
+        int uploads = 0;
+        int texels = 0;
+        // since the start
+        int full_uploads = 0;
+    };
+
+    // Brings the texture up to date, taking the changes. The scratch memory is only used during the call
+    void update(const CylinderHexWorld<HexData>& world, int fraction, VisibilityChanges& changes, std::pmr::memory_resource& scratch);
+    // Binds the texture to TEXTURE_SLOT, for the shaders that sample it
+    void bind() const;
+    void unbind() const;
+    // Has to be called while the window is still open
+    void unload();
+
+    const Stats& stats() const { return m_stats; }
+
+private:
+    Texture2D m_texture{};
+    int m_fraction = -1;
+    std::vector<unsigned char> m_scratch;
+    Stats m_stats;
+
+    void upload_all(const CylinderHexWorld<HexData>& world);
+    void upload_changes(const CylinderHexWorld<HexData>& world, std::vector<HexKey>& hexes, std::pmr::memory_resource& scratch);
+    unsigned char texel_of(const HexData& hx) const;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <raylib.h>
+#include "hex.hpp"
+#include "flat_hash_map.hpp"
+#include "rendering_controller.hpp"
+
+// How much detail a chunk of terrain is drawn with. Close to the camera tiles get their full models,
+// further away a hex prism in the colour of the tile, and far away the whole chunk is a single quad, with a pixel per tile
+enum class TerrainLod : uint8_t {
+    Full,
+    Prism,
+    Quad
+};
+constexpr static int TERRAIN_LOD_COUNT = 3;
+
+struct TerrainLodSettings {
+    bool enabled = true;
+    // distance from the camera to the middle of a chunk, where the level drops
+    float prism_distance = 45.0f;
+    float quad_distance = 110.0f;
+    // how far past a boundary (as a fraction of it) a chunk has to get before its level changes,
+    // so that chunks sitting at a boundary don't flicker between the two levels
+    float hysteresis = 0.1f;
+};
+
+// Picks the level of every visible chunk, remembering the last one for the hysteresis
+struct TerrainLodSelector {
+    TerrainLodSettings settings;
+
+    // To be called every frame, after the view is updated. Returns whether the level of any chunk changed
+    bool update(Vector3 camera_position, const RenderingController& view, const CylinderHexWorld<HexData>& world);
+
+    TerrainLod level_of(ChunkPlacement placement) const;
+    // Goes up every time the level of a chunk changes, for keeping things built from the levels
+    uint32_t revision() const { return m_revision; }
+
+private:
+    FlatHashMap<uint64_t, TerrainLod> m_levels;
+    // scratch for the next frame's levels
+    FlatHashMap<uint64_t, TerrainLod> m_next;
+    uint32_t m_revision = 0;
+
+    static uint64_t key_of(ChunkPlacement placement) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(placement.chunk)) << 32) | static_cast<uint32_t>(placement.wrap);
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <array>
+#include <optional>
+#include <cstdint>
+#include <memory_resource>
+#include <raylib.h>
+#include "hex.hpp"
+#include "flat_hash_map.hpp"
+#include "rendering_controller.hpp"
+#include "resources.hpp"
+#include "terrain_chunks.hpp"
+#include "terrain_lod.hpp"
+#include "terrain_fog.hpp"
+
+// the height tiles are put at
+constexpr static float TERRAIN_HEIGHT = -0.2f;
+
+// Everything the terrain looks like this frame
+struct TerrainFrame {
+    const CylinderHexWorld<HexData>& world;
+    const ResourceStore& resources;
+    // goes up whenever tiles change
+    uint32_t terrain_revision;
+    // the same per chunk
+    std::span<const uint32_t> chunk_revisions;
+    // debug view, hidden tiles are drawn too
+    bool show_hidden;
+    float scale;
+    HexCoords hovered;
+    Vector3 camera_position;
+    // for whatever is only needed while drawing this frame (a FrameArena)
+    std::pmr::memory_resource& scratch;
+
+    // What can be seen of it is up to the fog of war, in the shaders
+    bool shows(const HexData& hx) const {
+        return hx.tileid >= 0 && static_cast<size_t>(hx.tileid) < resources.m_hex_table.size();
+    }
+};
+
+// Draws the visible terrain. Every chunk gets a level of detail by its distance from the camera (see TerrainLodSelector).
+// Chunks at full detail are drawn in one of a few ways, that can be switched between to compare them:
+// - PerTile - DrawModelEx for every tile
+// - Instanced - tiles are grouped by kind, and every mesh of the kind's model is drawn once for all of them with
+//   DrawMeshInstanced. The instance transforms and tints are only rebuilt when the view, or the terrain changes.
+//   Moving the mouse around only patches the tints of the hex that stopped and the hex that started being hovered.
+// - Baked - chunks baked into merged meshes (see TerrainChunkBaker), tiles of chunks that aren't baked yet are drawn one by one
+// Prisms are instanced the same way, all of them in a single draw. Quads all go into one batch, textured with
+// a pixel per tile of the world.
+// Every way of drawing goes through the terrain shaders, which take care of the fog of war (see TerrainFog).
+struct TerrainRenderer {
+    enum class Mode {
+        PerTile,
+        Instanced,
+        Baked
+    };
+
+    struct LodCounters {
+        int chunks = 0;
+        int draw_calls = 0;
+        size_t triangles = 0;
+    };
+
+    struct Stats {
+        int draw_calls = 0;
+        int instances = 0;
+        int rebuilds = 0;
+        // indexed by TerrainLod
+        std::array<LodCounters, TERRAIN_LOD_COUNT> lods;
+    };
+
+    Mode mode = Mode::Instanced;
+    TerrainLodSelector lod;
+
+    // Loads the shaders and makes the prism, needs the window to be open. Without the instancing shader, tiles are drawn one by one.
+    // Chunks are baked by jobs of the given pool
+    void load(JobSystem& jobs);
+    // Has to be called while the window is still open
+    void unload();
+
+    // Before drawing, takes what the fraction can see, and what changed about it
+    void update_fog(const CylinderHexWorld<HexData>& world, int fraction, VisibilityChanges& changes, std::pmr::memory_resource& scratch);
+    void draw(const RenderingController& view, const TerrainFrame& frame);
+
+    bool instancing_available() const { return m_instance_tint_location != -1; }
+    const Stats& stats() const { return m_stats; }
+    const TerrainChunkBaker::Stats& chunk_stats() const { return m_chunks.stats(); }
+    const TerrainFog::Stats& fog_stats() const { return m_fog.stats(); }
+
+private:
+    // what a set of instances was built from
+    struct BuildKey {
+        uint32_t view_revision;
+        uint32_t terrain_revision;
+        uint32_t lod_revision;
+        float scale;
+
+        bool operator==(const BuildKey&) const = default;
+    };
+
+    struct KindBatch {
+        std::vector<Matrix> transforms;
+        std::vector<Color> tints;
+        // a tint buffer per mesh of the model, attached to the mesh's vertex array
+        std::vector<unsigned int> tint_buffers;
+        size_t buffer_capacity = 0;
+    };
+
+    // instances per tile kind, and where every hex ended up, for changing its tint
+    struct InstanceSet {
+        std::vector<KindBatch> batches;
+        FlatHashMap<HexKey, std::pair<int, int>> instance_of;
+        std::optional<BuildKey> built_from;
+        HexCoords hovered = HexCoords::from_axial(0, 0);
+    };
+
+    // a terrain shader, and where the fog uniforms are in it
+    struct FogShader {
+        Shader shader{};
+        int fog_texture = -1;
+        int world_size = -1;
+        int show_hidden = -1;
+        int model = -1;
+    };
+
+    // for DrawMeshInstanced
+    FogShader m_instanced;
+    // for DrawMesh, and raylib's batch
+    FogShader m_single;
+    bool m_loaded = false;
+    int m_instance_tint_location = -1;
+    TerrainFog m_fog;
+
+    // full models, when drawing instanced
+    InstanceSet m_tiles;
+
+    // a hex prism of the size of a tile, tinted with the kind's colour
+    Model m_prism{};
+    // all in the first batch, as they share the model
+    InstanceSet m_prisms;
+
+    // a pixel per tile of the world, and what each chunk of it was filled from
+    Texture2D m_world_texture{};
+    std::vector<std::optional<uint32_t>> m_texture_revisions;
+    std::vector<Color> m_texture_scratch;
+
+    TerrainChunkBaker m_chunks;
+    // chunks at full detail, for the baker
+    std::vector<int> m_full_chunks;
+
+    Stats m_stats;
+
+    BuildKey key_of(const RenderingController& view, const TerrainFrame& frame) const;
+    // Calls f(coords, hex) for every visible tile that's drawn at the level
+    template <typename F>
+    void for_each_tile_at(TerrainLod level, const RenderingController& view, const TerrainFrame& frame, F&& f) const;
+
+    void rebuild_tiles(const RenderingController& view, const TerrainFrame& frame);
+    void rebuild_prisms(const RenderingController& view, const TerrainFrame& frame);
+    void upload_tints(const Model& model, KindBatch& batch);
+    void set_tint(InstanceSet& set, HexCoords hc, Color tint);
+    void unload_instances(InstanceSet& set);
+    void set_fog_uniforms(const FogShader& fog_shader, const TerrainFrame& frame);
+    // DrawModelEx without the rotation, with the terrain shader
+    void draw_model(const Model& model, const Matrix& transform, Color tint, LodCounters& counters);
+    void draw_batch(const KindBatch& batch, const Model& model, LodCounters& counters);
+    void draw_tile(HexCoords coords, const HexData& hx, const TerrainFrame& frame);
+    void draw_per_tile(const RenderingController& view, const TerrainFrame& frame);
+    void draw_instanced(const RenderingController& view, const TerrainFrame& frame);
+    void draw_baked(const RenderingController& view, const TerrainFrame& frame);
+    void draw_prisms(const RenderingController& view, const TerrainFrame& frame);
+    void update_world_texture(const RenderingController& view, const TerrainFrame& frame);
+    void draw_quads(const RenderingController& view, const TerrainFrame& frame);
+};
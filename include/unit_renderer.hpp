@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <optional>
+#include <raylib.h>
+#include "hex.hpp"
+#include "units.hpp"
+#include "rendering_controller.hpp"
+
+// Draws the units on screen, and the selection ring, apart from the terrain.
+// Units are found through UnitStore's per chunk lists of occupied tiles, so the cost follows the units on screen,
+// not the tiles. They're grouped per type and fraction, and every group is a single DrawMeshInstanced call.
+// Without the instancing shader, every unit is a DrawMesh of its own.
+// Units that moved in the last simulation tick are drawn alpha of the way from where they were to where they are.
+struct UnitRenderer {
+    struct Stats {
+        int units = 0;
+        int batches = 0;
+        int draw_calls = 0;
+    };
+
+    // Needs the window to be open
+    void load();
+    // Has to be called while the window is still open
+    void unload();
+
+    void draw(const RenderingController& view, const CylinderHexWorld<HexData>& world, const UnitStore& units, std::optional<HexCoords> selected,
+              std::span<const UnitStep> steps = {}, float alpha = 1.0f);
+
+    bool instancing_available() const { return m_instancing; }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Batch {
+        UnitType type;
+        int fraction;
+        std::vector<Matrix> transforms;
+    };
+
+    Mesh m_body{};
+    Mesh m_ring{};
+    Material m_material{};
+    bool m_loaded = false;
+    bool m_instancing = false;
+
+    // kept between frames, so that the vectors keep their capacity
+    std::vector<Batch> m_batches;
+    std::vector<Matrix> m_rings;
+    Stats m_stats;
+
+    Batch& batch_of(UnitType type, int fraction);
+    template <UnitType Type>
+    void add_unit(const UnitStore& units, UnitHandle handle, Vector2 position);
+    // where on screen the unit on the (unwrapped) coords is, somewhere along its step if it made one
+    Vector2 position_of(UnitHandle handle, HexCoords coords, int world_width, std::span<const UnitStep> steps, float alpha) const;
+    void draw_instances(const Mesh& mesh, Color color, std::span<const Matrix> transforms);
+};
@@ -1,5 +1,10 @@
 #pragma once
-#include <unordered_map>
+#include <vector>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
 #include "hex.hpp"
 
 struct BaseUnitData {
@@ -25,116 +30,420 @@ enum class UnitType {
     Special
 };
 
+template <UnitType Type> struct UnitOfType;
+template <> struct UnitOfType<UnitType::Millitary> { using type = MilitaryUnit; };
+template <> struct UnitOfType<UnitType::Civilian> { using type = CivilianUnit; };
+template <> struct UnitOfType<UnitType::Special> { using type = SpecialUnit; };
+
+// Refers to a unit for as long as it exists. Once the unit is removed, the handle stops being valid,
+// even if its place in the store is taken by a new unit
+struct UnitHandle {
+    UnitType type = UnitType::Unspecified;
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+
+    bool operator==(const UnitHandle& other) const = default;
+};
+
+// A unit that went from one hex to the next in the last tick, for drawing it in between
+struct UnitStep {
+    UnitHandle handle;
+    HexCoords from;
+    HexCoords to;
+};
+
+// What stands on a tile. Made on the fly by UnitStore::get_all_on_hex, so it's only good until the units change
 struct UnitsOnTile {
-    std::optional<MilitaryUnit> military;
-    std::optional<CivilianUnit> civilian;
-    std::optional<SpecialUnit> special;
-    
+    std::optional<UnitHandle> military;
+    std::optional<UnitHandle> civilian;
+    std::optional<UnitHandle> special;
+
     bool has_any () const {
         return military.has_value() || civilian.has_value() || special.has_value();
     }
 
+    // if constexpr instead of specializations, because GCC does not take specializations at class scope
     template <UnitType Type>
-    auto& get_opt_unit() = delete;
+    const std::optional<UnitHandle>& get_opt_unit() const {
+        static_assert(Type != UnitType::Unspecified, "there is no slot for unspecified units");
+        if constexpr (Type == UnitType::Millitary) { return military; }
+        else if constexpr (Type == UnitType::Civilian) { return civilian; }
+        else { return special; }
+    }
+
+    // The same, for a type only known at runtime. There is no slot for unspecified units, so nothing is ever there
+    const std::optional<UnitHandle>& get_opt_unit(UnitType type) const {
+        static const std::optional<UnitHandle> nothing;
+        switch (type) {
+            case UnitType::Millitary: return military;
+            case UnitType::Civilian: return civilian;
+            case UnitType::Special: return special;
+            default: return nothing;
+        }
+    }
+};
+
+// All units of one type, packed together so that going over all of them is a walk over an array.
+// Removing a unit moves the last one into its place, so units move around in the array - handles
+// go through the slot table, which never moves.
+template <typename Unit>
+struct UnitPool {
+    static constexpr int32_t NO_UNIT = -1;
 
-    template <> auto& get_opt_unit<UnitType::Millitary> () { return military; };
-    template <> auto& get_opt_unit<UnitType::Civilian> () { return civilian; };
-    template <> auto& get_opt_unit<UnitType::Special> () { return special; };
+    struct Slot {
+        uint32_t generation = 0;
+        int32_t dense = NO_UNIT;
+    };
+
+    std::vector<Unit> units;
+    // world index of the tile every unit in `units` stands on
+    std::vector<int32_t> tiles;
+    // slot of every unit in `units`
+    std::vector<uint32_t> slot_of;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+
+    bool valid(uint32_t slot, uint32_t generation) const {
+        return slot < slots.size() && slots[slot].generation == generation && slots[slot].dense != NO_UNIT;
+    }
+
+    uint32_t add(const Unit& unit, int32_t tile) {
+        uint32_t slot;
+        if (free_slots.empty()) {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        slots[slot].dense = static_cast<int32_t>(units.size());
+        units.push_back(unit);
+        tiles.push_back(tile);
+        slot_of.push_back(slot);
+        return slot;
+    }
+
+    void remove(uint32_t slot) {
+        const int32_t dense = slots[slot].dense;
+        const int32_t last = static_cast<int32_t>(units.size()) - 1;
+        if (dense != last) {
+            units[dense] = units[last];
+            tiles[dense] = tiles[last];
+            slot_of[dense] = slot_of[last];
+            slots[slot_of[dense]].dense = dense;
+        }
+        units.pop_back();
+        tiles.pop_back();
+        slot_of.pop_back();
+        slots[slot].dense = NO_UNIT;
+        // old handles to this slot stop matching
+        slots[slot].generation++;
+        free_slots.push_back(slot);
+    }
+
+    void clear() {
+        for (const auto slot : slot_of) {
+            slots[slot].dense = NO_UNIT;
+            slots[slot].generation++;
+            free_slots.push_back(slot);
+        }
+        units.clear();
+        tiles.clear();
+        slot_of.clear();
+    }
 };
 
+// Units of the world. Every tile holds at most one unit of every type.
+// Besides the per type arrays, there's a grid the size of the world saying what stands where,
+// so looking up a tile is an index, and never allocates. Coordinates wrap around in q, like the world.
+// The occupied tiles are also kept per world chunk, for going over the units in some area (what's on screen)
+// without looking at every tile of it.
 struct UnitStore {
-    // NOTE: This may be a big performance hit, since we want reference stability, and fast iteration
-    // for now, it's done kinda lazyli
-    std::unordered_map<HexCoords, UnitsOnTile> m_store; // maybe we dont need arbitrarily many units in a single spot?
+    UnitStore() = default;
+    UnitStore(int width, int height) { reset(width, height); }
 
-    void call_this_when_unit_moves(decltype(m_store.begin()) moved_it, HexCoords new_location) {
-        auto node = m_store.extract(moved_it);
-        node.key() = new_location;
-        m_store.insert(std::move(node));
+    // Sizes the store for a world and drops all units
+    void reset(int width, int height) {
+        m_width = width;
+        m_height = height;
+        m_military.clear();
+        m_civilian.clear();
+        m_special.clear();
+        m_occupancy.assign(static_cast<size_t>(std::max(width, 0)) * std::max(height, 0), EMPTY_TILE);
+        m_chunks_wide = (std::max(width, 0) + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+        const int chunks_high = (std::max(height, 0) + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+        m_chunk_tiles.assign(static_cast<size_t>(m_chunks_wide) * chunks_high, {});
     }
 
-    auto& get_all_on_hex(HexCoords hc) {
-        return m_store[hc]; // maybe return optional instead of just constructing?
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t size() const { return m_military.units.size() + m_civilian.units.size() + m_special.units.size(); }
+
+    // Same as CylinderHexWorld::wrapped_index. -1 outside of the world
+    int tile_index(HexCoords hc) const {
+        if (hc.r < 0 || hc.r >= m_height || m_width <= 0) {
+            return -1;
+        }
+        return hc.r * m_width + positive_modulo(hc.q, m_width);
+    }
+
+    UnitsOnTile get_all_on_hex(HexCoords hc) const {
+        UnitsOnTile result;
+        const int tile = tile_index(hc);
+        if (tile == -1) {
+            return result;
+        }
+        result.military = handle_at<UnitType::Millitary>(tile);
+        result.civilian = handle_at<UnitType::Civilian>(tile);
+        result.special = handle_at<UnitType::Special>(tile);
+        return result;
+    }
+
+    // Whether there's a unit of the type on the tile with the world index
+    bool occupied(int tile, UnitType type) const {
+        if (type == UnitType::Unspecified || tile < 0 || static_cast<size_t>(tile) >= m_occupancy.size()) {
+            return false;
+        }
+        return m_occupancy[tile][type_slot(type)] != UnitPool<MilitaryUnit>::NO_UNIT;
+    }
+
+    // World indices of the tiles of a world chunk (as in CylinderHexWorld::chunk_of) with any unit on them, in no particular order
+    std::span<const int32_t> occupied_tiles_in_chunk(int chunk) const {
+        if (chunk < 0 || static_cast<size_t>(chunk) >= m_chunk_tiles.size()) {
+            return {};
+        }
+        return m_chunk_tiles[chunk];
     }
 
     bool is_selection_valid (std::pair<HexCoords, UnitType> selection) const {
         auto [coord, type] = selection;
-        if (auto it = m_store.find(coord); it != m_store.end()) {
-            switch (type) {
-                case UnitType::Millitary:return it->second.military.has_value();
-                case UnitType::Civilian: return it->second.civilian.has_value();
-                case UnitType::Special: return it->second.special.has_value();
-                default:
-                case UnitType::Unspecified: return false;
-            }
-        } else {
-            return false;
+        return occupied(tile_index(coord), type);
+    }
+
+    bool alive(UnitHandle handle) const {
+        switch (handle.type) {
+            case UnitType::Millitary: return m_military.valid(handle.slot, handle.generation);
+            case UnitType::Civilian: return m_civilian.valid(handle.slot, handle.generation);
+            case UnitType::Special: return m_special.valid(handle.slot, handle.generation);
+            default:
+            case UnitType::Unspecified: return false;
         }
     }
 
-    // Returns true if putting the unit on the hex was successful, false if there was something there already 
-    bool put_unit_on_hex(HexCoords hc, MilitaryUnit unit) {
-        // operator[] constructs if not present
-        if (m_store[hc].military.has_value()) {
-            return false;
-        } else {
-            m_store[hc].military = unit;
-            return true;
+    // nullptr if the handle is no longer valid
+    template <UnitType Type>
+    auto* get(UnitHandle handle) {
+        auto& p = pool<Type>();
+        return handle.type == Type && p.valid(handle.slot, handle.generation) ? &p.units[p.slots[handle.slot].dense] : nullptr;
+    }
+
+    template <UnitType Type>
+    const auto* get(UnitHandle handle) const {
+        const auto& p = pool<Type>();
+        return handle.type == Type && p.valid(handle.slot, handle.generation) ? &p.units[p.slots[handle.slot].dense] : nullptr;
+    }
+
+    // Normalized position of a unit, nothing if the handle is no longer valid
+    std::optional<HexCoords> position_of(UnitHandle handle) const {
+        const int tile = tile_of(handle);
+        if (tile == -1) {
+            return {};
         }
+        return HexCoords::from_axial(tile % m_width, tile / m_width);
     }
 
-    // Returns true if putting the unit on the hex was successful, false if there was something there already 
-    bool put_unit_on_hex(HexCoords hc, CivilianUnit unit) {
-        // operator[] constructs if not present
-        if (m_store[hc].civilian.has_value()) {
-            return false;
-        } else {
-            m_store[hc].civilian = unit;
-            return true;
+    // What all types of units have in common, nullptr if the handle is no longer valid
+    const BaseUnitData* base_of(UnitHandle handle) const;
+
+    // Returns the handle if putting the unit on the hex was successful, nothing if there was something there already
+    std::optional<UnitHandle> put_unit_on_hex(HexCoords hc, MilitaryUnit unit) { return put<UnitType::Millitary>(hc, unit, false); }
+    std::optional<UnitHandle> put_unit_on_hex(HexCoords hc, CivilianUnit unit) { return put<UnitType::Civilian>(hc, unit, false); }
+    std::optional<UnitHandle> put_unit_on_hex(HexCoords hc, SpecialUnit unit) { return put<UnitType::Special>(hc, unit, false); }
+
+    // Like put_unit_on_hex, but removes whatever of the same type was there
+    std::optional<UnitHandle> hard_override_unit_on_hex(HexCoords hc, MilitaryUnit unit) { return put<UnitType::Millitary>(hc, unit, true); }
+    std::optional<UnitHandle> hard_override_unit_on_hex(HexCoords hc, CivilianUnit unit) { return put<UnitType::Civilian>(hc, unit, true); }
+    std::optional<UnitHandle> hard_override_unit_on_hex(HexCoords hc, SpecialUnit unit) { return put<UnitType::Special>(hc, unit, true); }
+
+    // Moves the unit, removing whatever of the same type was at the destination. False if the handle is no longer valid
+    bool move_unit(UnitHandle handle, HexCoords to) {
+        switch (handle.type) {
+            case UnitType::Millitary: return move<UnitType::Millitary>(handle, to);
+            case UnitType::Civilian: return move<UnitType::Civilian>(handle, to);
+            case UnitType::Special: return move<UnitType::Special>(handle, to);
+            default:
+            case UnitType::Unspecified: return false;
         }
     }
-    
-    // Returns true if putting the unit on the hex was successful, false if there was something there already 
-    bool put_unit_on_hex(HexCoords hc, SpecialUnit unit) {
-        // operator[] constructs if not present
-        if (m_store[hc].special.has_value()) {
-            return false;
-        } else {
-            m_store[hc].special = unit;
-            return true;
+
+    template <UnitType Type>
+    void teleport_unit (HexCoords start, HexCoords end) {
+        if (const auto handle = get_all_on_hex(start).get_opt_unit<Type>(); handle.has_value()) {
+            move<Type>(*handle, end);
         }
     }
 
+    void remove_unit(UnitHandle handle) {
+        switch (handle.type) {
+            case UnitType::Millitary: remove<UnitType::Millitary>(handle); break;
+            case UnitType::Civilian: remove<UnitType::Civilian>(handle); break;
+            case UnitType::Special: remove<UnitType::Special>(handle); break;
+            default:
+            case UnitType::Unspecified: break;
+        }
+    }
+
+    // All units of a type, and the world indices of the tiles they stand on, in the same order.
+    // The order changes when units are removed
+    template <UnitType Type>
+    std::span<const typename UnitOfType<Type>::type> units_of() const { return pool<Type>().units; }
 
-    void hard_override_unit_on_hex(HexCoords hc, MilitaryUnit unit) {
-        m_store[hc].military = unit;
+    template <UnitType Type>
+    std::span<const int32_t> tiles_of() const { return pool<Type>().tiles; }
+
+    // Calls fn(normalized coords, unit) for every unit, unit being the actual type, type after type
+    template <typename F>
+    void for_each_unit(F&& fn) const {
+        const auto visit = [&](const auto& p) {
+            for (size_t i = 0; i < p.units.size(); i++) {
+                fn(HexCoords::from_axial(p.tiles[i] % m_width, p.tiles[i] / m_width), p.units[i]);
+            }
+        };
+        visit(m_military);
+        visit(m_civilian);
+        visit(m_special);
     }
 
-    void hard_override_unit_on_hex(HexCoords hc, CivilianUnit unit) {
-        m_store[hc].civilian = unit;
+private:
+    static constexpr std::array<int32_t, 3> EMPTY_TILE = {UnitPool<MilitaryUnit>::NO_UNIT, UnitPool<MilitaryUnit>::NO_UNIT, UnitPool<MilitaryUnit>::NO_UNIT};
+
+    int m_width = 0;
+    int m_height = 0;
+    UnitPool<MilitaryUnit> m_military;
+    UnitPool<CivilianUnit> m_civilian;
+    UnitPool<SpecialUnit> m_special;
+    // per world tile, the slot of the unit of every type standing there
+    std::vector<std::array<int32_t, 3>> m_occupancy;
+    // per world chunk, the tiles that have anything on them
+    std::vector<std::vector<int32_t>> m_chunk_tiles;
+    int m_chunks_wide = 0;
+
+    static size_t type_slot(UnitType type) { return static_cast<size_t>(type) - 1; }
+
+    // Every change to m_occupancy goes through here, so that the per chunk lists follow it
+    void set_occupant(int tile, UnitType type, int32_t slot) {
+        auto& occupants = m_occupancy[tile];
+        const bool was_empty = occupants == EMPTY_TILE;
+        occupants[type_slot(type)] = slot;
+        const bool is_empty = occupants == EMPTY_TILE;
+        if (was_empty == is_empty) {
+            return;
+        }
+        const int chunk = (tile / m_width / WORLD_CHUNK_SIZE) * m_chunks_wide + (tile % m_width) / WORLD_CHUNK_SIZE;
+        auto& tiles = m_chunk_tiles[chunk];
+        if (is_empty) {
+            const auto at = std::find(tiles.begin(), tiles.end(), tile);
+            *at = tiles.back();
+            tiles.pop_back();
+        } else {
+            tiles.push_back(tile);
+        }
     }
 
-    void hard_override_unit_on_hex(HexCoords hc, SpecialUnit unit) {
-        m_store[hc].special = unit;
+    template <UnitType Type>
+    auto& pool() {
+        static_assert(Type != UnitType::Unspecified, "there is no pool for unspecified units");
+        if constexpr (Type == UnitType::Millitary) { return m_military; }
+        else if constexpr (Type == UnitType::Civilian) { return m_civilian; }
+        else { return m_special; }
     }
 
-    void teleport_unit_militray (HexCoords start, HexCoords end) {
-        m_store[end].military = m_store[start].military;
-        m_store[start].military.reset();
+    template <UnitType Type>
+    const auto& pool() const {
+        static_assert(Type != UnitType::Unspecified, "there is no pool for unspecified units");
+        if constexpr (Type == UnitType::Millitary) { return m_military; }
+        else if constexpr (Type == UnitType::Civilian) { return m_civilian; }
+        else { return m_special; }
     }
-    void teleport_unit_civilian (HexCoords start, HexCoords end) {
-        m_store[end].civilian = m_store[start].civilian;
-        m_store[start].civilian.reset();
+
+    template <UnitType Type>
+    std::optional<UnitHandle> handle_at(int tile) const {
+        const int32_t slot = m_occupancy[tile][type_slot(Type)];
+        if (slot == UnitPool<MilitaryUnit>::NO_UNIT) {
+            return {};
+        }
+        return UnitHandle{Type, static_cast<uint32_t>(slot), pool<Type>().slots[slot].generation};
     }
-    void teleport_unit_special (HexCoords start, HexCoords end) {
-        m_store[end].special = m_store[start].special;
-        m_store[start].special.reset();
+
+    int tile_of(UnitHandle handle) const {
+        const auto find = [&](const auto& p) {
+            return p.valid(handle.slot, handle.generation) ? p.tiles[p.slots[handle.slot].dense] : -1;
+        };
+        switch (handle.type) {
+            case UnitType::Millitary: return find(m_military);
+            case UnitType::Civilian: return find(m_civilian);
+            case UnitType::Special: return find(m_special);
+            default:
+            case UnitType::Unspecified: return -1;
+        }
     }
 
     template <UnitType Type>
-    void teleport_unit (HexCoords start, HexCoords end) {
-        if (start == end) return;
-        m_store[end].get_opt_unit<Type>() = m_store[start].get_opt_unit<Type>();
-        m_store[start].get_opt_unit<Type>().reset();
+    std::optional<UnitHandle> put(HexCoords hc, const typename UnitOfType<Type>::type& unit, bool replace) {
+        const int tile = tile_index(hc);
+        if (tile == -1) {
+            return {};
+        }
+        if (const auto there = handle_at<Type>(tile); there.has_value()) {
+            if (!replace) {
+                return {};
+            }
+            remove<Type>(*there);
+        }
+        auto& p = pool<Type>();
+        const uint32_t slot = p.add(unit, tile);
+        set_occupant(tile, Type, static_cast<int32_t>(slot));
+        return UnitHandle{Type, slot, p.slots[slot].generation};
+    }
+
+    template <UnitType Type>
+    bool move(UnitHandle handle, HexCoords to) {
+        auto& p = pool<Type>();
+        const int tile = tile_index(to);
+        if (!p.valid(handle.slot, handle.generation) || tile == -1) {
+            return false;
+        }
+        const int from = p.tiles[p.slots[handle.slot].dense];
+        if (from == tile) {
+            return true;
+        }
+        if (const auto there = handle_at<Type>(tile); there.has_value()) {
+            remove<Type>(*there);
+        }
+        set_occupant(from, Type, UnitPool<MilitaryUnit>::NO_UNIT);
+        set_occupant(tile, Type, static_cast<int32_t>(handle.slot));
+        // removing the unit at the destination may have moved this one in the array
+        p.tiles[p.slots[handle.slot].dense] = tile;
+        return true;
+    }
+
+    template <UnitType Type>
+    void remove(UnitHandle handle) {
+        auto& p = pool<Type>();
+        if (!p.valid(handle.slot, handle.generation)) {
+            return;
+        }
+        set_occupant(p.tiles[p.slots[handle.slot].dense], Type, UnitPool<MilitaryUnit>::NO_UNIT);
+        p.remove(handle.slot);
     }
 };
+
+// out here, the pools' types are only known once the class is complete
+inline const BaseUnitData* UnitStore::base_of(UnitHandle handle) const {
+    switch (handle.type) {
+        case UnitType::Millitary: return get<UnitType::Millitary>(handle);
+        case UnitType::Civilian: return get<UnitType::Civilian>(handle);
+        case UnitType::Special: return get<UnitType::Special>(handle);
+        default: return nullptr;
+    }
+}
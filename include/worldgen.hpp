@@ -0,0 +1,173 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include <sol/sol.hpp>
+#include "hex.hpp"
+#include "module.hpp"
+#include "utils.hpp"
+
+class JobSystem;
+
+// A world generator declared by a module. The generator is a Lua function, that fills in the map it's given
+struct WorldGen {
+    struct SeedOption { bool provided; size_t value; };
+    struct RangeOption { double from; double to; double step; double default_value; std::string description; };
+    struct SelectionOption { std::vector<std::string> options; size_t default_selection; std::string description; };
+    struct ToggleOption { std::string description; bool default_value; };
+    struct Option {
+        std::string name;
+        std::variant<SeedOption, RangeOption, SelectionOption, ToggleOption> value;
+    };
+
+    std::string name;
+    std::vector<Option> options;
+    sol::protected_function generator;
+    // the module it came from, to make more VMs of it
+    std::string entry_point;
+    // Generators that declare `chunked = { width = ..., height = ... }` make the world a chunk at a time, in parallel (see
+    // WorldGenChunk) - the generator is called once per chunk, with the chunk instead of the Map
+    struct ChunkedSize { int width; int height; };
+    std::optional<ChunkedSize> chunked;
+
+    // World gens should not be movable, as they store VM references
+    WorldGen() = default;
+    WorldGen(const WorldGen&) = delete;
+    WorldGen(WorldGen&&) = delete;
+
+    ~WorldGen() {
+        generator.abandon(); // module loader might be already dead, so no luck trying to unregister from lua vms
+        logging::debug(__func__);
+    }
+};
+
+// The Map a generator is given. Tiles go straight into the world being made, there's nothing to copy out of Lua afterwards.
+// Coordinates are 1 based, like Lua tables, in the mode set with setTileCoords (axial unless said otherwise):
+//     Map:setSize(width, height)
+//     Map:setTileCoords(Map.OFFSET)
+//     Map:setTileAt(x, y, tile)           local tile = Map:getTileAt(x, y)
+//     Map:fillRow(y, tiles [, first_x])   -- tiles[1] goes to first_x (1 by default), tiles[2] next to it, and so on
+//     Map:fillRect(x, y, w, h, tile)
+//     Map:reportProgress(fraction)        -- 0..1, for the loading screen. Stops the generator if it was cancelled
+// x wraps around the world, a y outside of it is an error. Every method is a call into C++, which LuaJIT can't compile into
+// its traces - for whole maps, setTileAt per tile is slower than filling a Lua table was, fillRow and rawTiles are the fast ways.
+// With LuaJIT's FFI, rawTiles gives the tile ids themselves, and how many int32_ts apart they are. They're in rows of
+// 0 based axial coordinates, q wrapped into 0..width-1:
+//     local tiles, stride = Map:rawTiles()
+//     tiles = ffi.cast("int32_t*", tiles)
+//     tiles[(r * Map.width + q) * stride] = grass
+// The pointer is good until the next setSize, and the Map itself only while the generator runs
+struct WorldGenTask;
+
+struct WorldGenMap {
+    static constexpr int AXIAL = 0;
+    static constexpr int OFFSET = 1;
+
+    CylinderHexWorld<HexData> world{1, 1, {}, {}};
+    int mode = AXIAL;
+    // where the progress goes, when the generator runs on a worker
+    WorldGenTask* task = nullptr;
+
+    void SetSize(int width, int height);
+    void SetTileCoords(int new_mode);
+    void SetTileAt(int x, int y, int tile);
+    int GetTileAt(int x, int y) const;
+    void FillRow(int y, sol::table tiles, sol::optional<int> first_x);
+    void FillRect(int x, int y, int w, int h, int tile);
+    std::tuple<void*, int> RawTiles();
+    void ReportProgress(double fraction);
+    bool Cancelled() const;
+
+    // Index in world.data of 1 based coordinates in the current mode. Throws if y is outside of the world
+    int IndexOf(int x, int y) const;
+
+    // Makes the Lua side of it, for the VM the generator runs in
+    static void RegisterUsertype(sol::state_view lua);
+};
+
+// A part of the world, for chunked generators. The chunks are made in parallel, in as many VMs as there are threads, in no
+// particular order. So a chunk has to come out the same whichever VM makes it, and whenever:
+// - use the seeds; math.random is seeded with the chunk's seed before every chunk
+// - keep nothing from one chunk to the next
+// Then the world is the same whatever the number of VMs.
+// Coordinates are axial and 1 based, like the Map's, but only the chunk's own hexes can be touched:
+//     Chunk.x, Chunk.y                    -- the first hex of the chunk
+//     Chunk.width, Chunk.height           -- its size
+//     Chunk.worldWidth, Chunk.worldHeight -- the size of the whole world
+//     Chunk.seed                          -- for this chunk alone
+//     Chunk.worldSeed                     -- the same for all of them, for noise that goes across the chunks
+//     Chunk:setTileAt(x, y, tile)   Chunk:getTileAt(x, y)   Chunk:fillRow(y, tiles [, first_x])   Chunk:fillRect(x, y, w, h, tile)
+//     Chunk:rawTiles()                    -- like Map:rawTiles, the whole world - but only write to the chunk
+struct WorldGenChunk {
+    CylinderHexWorld<HexData>* world = nullptr;
+    int index = 0;
+    // the first hex, 0 based and normalized, and the size
+    int q0 = 0;
+    int r0 = 0;
+    int width = 0;
+    int height = 0;
+    uint32_t seed = 0;
+    uint32_t world_seed = 0;
+
+    void SetTileAt(int x, int y, int tile);
+    int GetTileAt(int x, int y) const;
+    void FillRow(int y, sol::table tiles, sol::optional<int> first_x);
+    void FillRect(int x, int y, int w, int h, int tile);
+    std::tuple<void*, int> RawTiles();
+
+    // Index in world->data of 1 based axial coordinates. Throws if they're outside of the chunk
+    int IndexOf(int x, int y) const;
+
+    static void RegisterUsertype(sol::state_view lua);
+};
+
+// The seed of the chunk, from the seed of the world. The same on every platform
+uint32_t ChunkSeed(uint32_t world_seed, int chunk);
+
+// The generator gets them as its second argument, a table of name = value. A numeric "seed" is the seed of the world
+// (Chunk.worldSeed for chunked generators), the generators pick their own if there's none
+using WorldGenOptions = std::unordered_map<std::string, std::variant<double, std::string, bool>>;
+
+// Makes another VM of the module the generator came from (see ModuleLoader::Instantiate)
+using WorldGenVMFactory = std::function<std::optional<ModuleInstance>(const std::string& entry_point)>;
+
+// Runs the generator in the VM of its module, and turns what it made into a world.
+// Nothing if the generator failed, the reason is logged. Chunked generators go through GenerateWorldChunked
+std::optional<CylinderHexWorld<HexData>> GenerateWorld(const WorldGen& gen, const WorldGenOptions& options);
+// Same, with any generator function. With a task, the generator reports its progress to it, and can be cancelled
+std::optional<CylinderHexWorld<HexData>> GenerateWorld(const sol::protected_function& generator, const WorldGenOptions& options, WorldGenTask* task = nullptr);
+
+// Makes the world of a chunked generator (see WorldGenChunk). With the jobs and make_vm, the chunks are made by vm_count VMs
+// from make_vm in parallel (0 means one per thread), otherwise one after another in the VM the generator came from.
+// The world seed comes from the "seed" option, if there is one. With a task, the progress goes to it, and it can be cancelled
+std::optional<CylinderHexWorld<HexData>> GenerateWorldChunked(const WorldGen& gen, const WorldGenOptions& options, JobSystem* jobs = nullptr, const WorldGenVMFactory& make_vm = {}, int vm_count = 0, WorldGenTask* task = nullptr);
+
+// The generator function called `name` that the module declares, if there's one
+sol::optional<sol::protected_function> FindGeneratorFunction(const sol::table& module_root, const std::string& name);
+
+// World generation going on on a worker, shared by the worker and the main thread
+struct WorldGenTask {
+    // 0..1, from Map:reportProgress
+    std::atomic<float> progress{0.0f};
+    std::atomic<bool> cancel_requested{false};
+    // the rest is for the main thread only, and set before on_finished is called
+    bool finished = false;
+    bool succeeded = false;
+    std::optional<CylinderHexWorld<HexData>> result;
+    // clear it if whatever it calls is gone
+    std::function<void(WorldGenTask&)> on_finished;
+
+    // The generator stops the next time it reports progress. The task still finishes, without a world
+    void Cancel() { cancel_requested = true; }
+};
+
+// Runs the generator on a worker, in a VM of its own from make_vm, so that the main thread goes on - frames get drawn,
+// the network is looked after. Once it's done, on_finished is called on the main thread (from run_main_thread_callbacks),
+// with the world in task.result if the generator made one. The generator has to outlive the task
+std::shared_ptr<WorldGenTask> GenerateWorldAsync(const WorldGen& gen, WorldGenOptions options, JobSystem& jobs, WorldGenVMFactory make_vm, std::function<void(WorldGenTask&)> on_finished);
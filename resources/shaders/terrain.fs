@@ -0,0 +1,63 @@
+#version 330
+
+// Terrain in the fog of war. fogTexture has a texel per tile (q, r), with the visibility to the current
+// fraction scaled to 0..1 - hidden, fog, normal, superior
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+in vec3 fragPosition;
+
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+uniform sampler2D fogTexture;
+// in tiles
+uniform ivec2 worldSize;
+// debug view, hidden tiles are shown dimmed instead of not at all
+uniform int showHidden;
+
+out vec4 finalColor;
+
+// The hex a point of the world is on, the same as HexCoords::from_world_unscaled
+ivec2 hexAt(vec2 position)
+{
+    float q = sqrt(3.0)/3.0*position.x - position.y/3.0;
+    float r = 2.0/3.0*position.y;
+    float s = -q - r;
+    vec3 rounded = round(vec3(q, r, s));
+    vec3 diff = abs(rounded - vec3(q, r, s));
+    if (diff.x > diff.y && diff.x > diff.z) rounded.x = -rounded.y - rounded.z;
+    else if (diff.y > diff.z) rounded.y = -rounded.x - rounded.z;
+    return ivec2(rounded.xy);
+}
+
+void main()
+{
+    vec4 color = texture(texture0, fragTexCoord)*colDiffuse*fragColor;
+    if (color.a <= 0.0) discard;
+
+    ivec2 hex = hexAt(fragPosition.xz);
+    int visibility = 0;
+    if (hex.y >= 0 && hex.y < worldSize.y)
+    {
+        // the world wraps around in q
+        int q = int(mod(float(hex.x), float(worldSize.x)));
+        visibility = int(round(texelFetch(fogTexture, ivec2(q, hex.y), 0).r*3.0));
+    }
+
+    if (visibility == 0)
+    {
+        if (showHidden == 0) discard;
+        color.rgb *= 0.3;
+    }
+    else if (visibility == 1)
+    {
+        // remembered, but not seen right now
+        float grey = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+        color.rgb = mix(color.rgb, vec3(grey), 0.6)*0.5;
+    }
+    else if (visibility == 2)
+    {
+        color.rgb *= 0.85;
+    }
+    finalColor = color;
+}
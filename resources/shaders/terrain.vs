@@ -0,0 +1,22 @@
+#version 330
+
+// Terrain drawn one mesh at a time (DrawMesh), or through raylib's batch, where matModel is the identity
+
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in vec4 vertexColor;
+
+uniform mat4 mvp;
+uniform mat4 matModel;
+
+out vec2 fragTexCoord;
+out vec4 fragColor;
+out vec3 fragPosition;
+
+void main()
+{
+    fragTexCoord = vertexTexCoord;
+    fragColor = vertexColor;
+    fragPosition = vec3(matModel*vec4(vertexPosition, 1.0));
+    gl_Position = mvp*vec4(vertexPosition, 1.0);
+}
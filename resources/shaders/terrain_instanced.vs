@@ -0,0 +1,23 @@
+#version 330
+
+// Terrain tiles drawn with DrawMeshInstanced. Every instance has its own transform and tint
+
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in vec4 vertexColor;
+in mat4 instanceTransform;
+in vec4 instanceTint;
+
+uniform mat4 mvp;
+
+out vec2 fragTexCoord;
+out vec4 fragColor;
+out vec3 fragPosition;
+
+void main()
+{
+    fragTexCoord = vertexTexCoord;
+    fragColor = vertexColor*instanceTint;
+    fragPosition = vec3(instanceTransform*vec4(vertexPosition, 1.0));
+    gl_Position = mvp*instanceTransform*vec4(vertexPosition, 1.0);
+}
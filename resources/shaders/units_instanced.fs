@@ -0,0 +1,14 @@
+#version 330
+
+in vec3 fragNormal;
+
+uniform vec4 colDiffuse;
+
+out vec4 finalColor;
+
+void main()
+{
+    // a bit of light from above, so that the shapes can be told apart
+    float light = 0.6 + 0.4*max(dot(normalize(fragNormal), normalize(vec3(0.3, 1.0, 0.2))), 0.0);
+    finalColor = vec4(colDiffuse.rgb*light, colDiffuse.a);
+}
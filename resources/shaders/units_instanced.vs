@@ -0,0 +1,17 @@
+#version 330
+
+// Units drawn with DrawMeshInstanced, a batch per unit type and fraction
+
+in vec3 vertexPosition;
+in vec3 vertexNormal;
+in mat4 instanceTransform;
+
+uniform mat4 mvp;
+
+out vec3 fragNormal;
+
+void main()
+{
+    fragNormal = normalize(mat3(instanceTransform)*vertexNormal);
+    gl_Position = mvp*instanceTransform*vec4(vertexPosition, 1.0);
+}
@@ -0,0 +1,225 @@
+// Plays the game without a window: units of a few fractions walk around the map, tick after tick. For profiling the
+// game logic, and for soak tests on machines without a display.
+//
+//     simulate [--ticks N] [--units N] [--size WxH] [--seed N] [--orders N] [--worldgen NAME] [--modules PATH] [--profile FILE]
+//
+// Without --worldgen, the map is made like the benchmarks' maps, so the Lua modules aren't needed at all.
+// With it, the modules are loaded from --modules (resources/modules by default), and the world comes from that generator,
+// with --seed as the seed of the world.
+// Modules that need what only the game has (like the key bindings) fail to load, and are skipped.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "game_state.hpp"
+#include "definitions.hpp"
+#include "module.hpp"
+#include "noise_library.hpp"
+#include "job_system.hpp"
+#include "profiler.hpp"
+#include "bench_maps.hpp"
+
+namespace {
+struct Options {
+    int ticks = 1000;
+    int units = 500;
+    int width = 256;
+    int height = 128;
+    uint32_t seed = 2137;
+    // new orders given per tick, at most, to units that have nowhere to go
+    int orders_per_tick = 32;
+    // how far away the units are sent
+    int order_range = 12;
+    int fractions = 4;
+    std::string worldgen;
+    std::string modules = "resources/modules";
+    std::string profile;
+};
+
+void usage() {
+    std::cerr << "usage: simulate [--ticks N] [--units N] [--size WxH] [--seed N] [--orders N] [--worldgen NAME] [--modules PATH] [--profile FILE]\n";
+}
+
+bool parse(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        try {
+            if (arg == "--ticks") {
+                options.ticks = std::stoi(value);
+            } else if (arg == "--units") {
+                options.units = std::stoi(value);
+            } else if (arg == "--size") {
+                const auto x = value.find('x');
+                if (x == std::string::npos) return false;
+                options.width = std::stoi(value.substr(0, x));
+                options.height = std::stoi(value.substr(x + 1));
+            } else if (arg == "--seed") {
+                options.seed = static_cast<uint32_t>(std::stoul(value));
+            } else if (arg == "--orders") {
+                options.orders_per_tick = std::stoi(value);
+            } else if (arg == "--worldgen") {
+                options.worldgen = value;
+            } else if (arg == "--modules") {
+                options.modules = value;
+            } else if (arg == "--profile") {
+                options.profile = value;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return options.ticks >= 0 && options.units >= 0 && options.width > 0 && options.height > 0;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    const auto nth = values.begin() + static_cast<std::ptrdiff_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+    PROFILE_THREAD("main");
+
+    JobSystem jobs(JobSystem::workers_from_environment());
+    // the loader and the definitions hold the Lua VMs the world generator runs in, so they outlive the game state
+    NoiseLibrary noise{&jobs};
+    ModuleLoader loader;
+    GameDefinitions definitions;
+    std::vector<int> vision_costs = bench::bench_vision_costs();
+    std::vector<int> movement_costs = bench::bench_movement_costs();
+    if (!options.worldgen.empty()) {
+        const auto candidates = loader.ListCandidateModules(options.modules);
+        const auto module_issues = loader.LoadModules(candidates, definitions, noise);
+        const auto definition_issues = definitions.LoadModuleDefinitions(loader);
+        if (!module_issues.empty() || !definition_issues.empty()) {
+            std::cerr << module_issues.size() + definition_issues.size() << " issues while loading the modules, going on without what failed\n";
+        }
+        vision_costs = definitions.HexVisionCosts();
+        movement_costs = definitions.HexMovementCosts();
+    }
+
+    GameState gs(nullptr, vision_costs, movement_costs, &jobs);
+    if (options.worldgen.empty()) {
+        gs.world = bench::generate_map(options.width, options.height, options.seed);
+        gs.OnWorldReplaced();
+    } else {
+        const auto* generator = definitions.FindGenerator(options.worldgen);
+        if (generator == nullptr) {
+            std::cerr << "There's no world generator called " << options.worldgen << '\n';
+            return 1;
+        }
+        if (!gs.RunWorldgen(*generator, {{"seed", static_cast<double>(options.seed)}})) {
+            return 1;
+        }
+    }
+    std::cout << "world: " << gs.world.width << "x" << gs.world.height << ", " << jobs.worker_count() << " job workers\n";
+
+    std::mt19937 rng(options.seed);
+    const auto passable = [&](HexCoords hc) {
+        const int tile = gs.world.at(hc).tileid;
+        return tile >= 0 && static_cast<size_t>(tile) < movement_costs.size() && movement_costs[tile] > 0;
+    };
+
+    // units go on random free tiles they can stand on
+    std::vector<UnitHandle> handles;
+    std::uniform_int_distribution<int> pick_tile(0, static_cast<int>(gs.world.data.size()) - 1);
+    for (int attempts = 0; static_cast<int>(handles.size()) < options.units && attempts < options.units * 20; attempts++) {
+        const auto hc = gs.world.coords_of_index(pick_tile(rng));
+        if (!passable(hc)) continue;
+        const int id = static_cast<int>(handles.size());
+        const auto handle = gs.units.put_unit_on_hex(hc, MilitaryUnit{ { .id = id, .fraction = id % options.fractions, .health = 100, .vission_range = 2 } });
+        if (handle.has_value()) {
+            handles.push_back(*handle);
+            gs.OnUnitsChanged(hc);
+        }
+    }
+    std::cout << "units: " << handles.size() << '\n';
+
+    std::uniform_int_distribution<int> pick_offset(-options.order_range, options.order_range);
+    std::vector<char> busy;
+    std::vector<UnitStep> steps;
+    std::vector<double> tick_ms;
+    tick_ms.reserve(options.ticks);
+    size_t orders = 0;
+    size_t failed_orders = 0;
+    size_t moves = 0;
+    size_t next_unit = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < options.ticks; tick++) {
+        const auto tick_start = std::chrono::steady_clock::now();
+        {
+            PROFILE_ZONE("orders");
+            busy.assign(handles.size(), 0);
+            for (const auto& order : gs.move_orders) {
+                if (order.handle.slot < busy.size()) {
+                    busy[order.handle.slot] = 1;
+                }
+            }
+            // the idle ones get somewhere new to go, a few per tick, going around all of them in turn
+            int given = 0;
+            for (size_t i = 0; i < handles.size() && given < options.orders_per_tick; i++) {
+                const auto handle = handles[(next_unit + i) % handles.size()];
+                if (busy[handle.slot]) continue;
+                const auto from = gs.units.position_of(handle);
+                if (!from.has_value()) continue;
+                const int dq = pick_offset(rng);
+                const int dr = pick_offset(rng);
+                const auto to = HexCoords::from_axial(from->q + dq, std::clamp(from->r + dr, 0, gs.world.height - 1));
+                if (!passable(to)) continue;
+                given++;
+                orders++;
+                if (!gs.MoveUnit<UnitType::Millitary>(*from, to)) {
+                    failed_orders++;
+                }
+            }
+            next_unit = handles.empty() ? 0 : (next_unit + options.orders_per_tick) % handles.size();
+        }
+        steps.clear();
+        gs.Tick(steps);
+        moves += steps.size();
+        tick_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tick_start).count());
+    }
+    const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+
+    double total_ms = 0.0;
+    for (const double ms : tick_ms) {
+        total_ms += ms;
+    }
+    std::cout << "ticks: " << options.ticks << " in " << took.count() << " s\n";
+    std::cout << "orders: " << orders << " (" << failed_orders << " without a path), " << moves << " hexes walked\n";
+    if (!tick_ms.empty()) {
+        std::cout << "tick: " << total_ms / tick_ms.size() << " ms average, "
+                  << percentile(tick_ms, 0.5) << " ms p50, "
+                  << percentile(tick_ms, 0.99) << " ms p99, "
+                  << *std::max_element(tick_ms.begin(), tick_ms.end()) << " ms max\n";
+    }
+
+    if (!options.profile.empty()) {
+        if (!profiler::ENABLED) {
+            std::cerr << "The profiler was compiled out, build with STRATGAME_PROFILER to use it\n";
+        } else if (!profiler::write_chrome_trace(options.profile, took.count() + 1.0)) {
+            std::cerr << "Couldn't write the profile to " << options.profile << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include "raylib.h"
 #include "behaviour_stack.hpp"
 #include "utils.hpp"
+#include "profiler.hpp"
+#include "job_system.hpp"
 
 BehaviourStack::BehaviourStack() {}
 
@@ -19,11 +21,13 @@ void BehaviourStack::perform_queued_actions()
 
 void BehaviourStack::update()
 {
+	PROFILE_ZONE("frame");
 	if (WindowShouldClose()) {
 		clear();
 		return;
 	}
 	states_stack.back().run_loop(*this);
+	frame_arena.reset();
 }
 
 
@@ -59,5 +63,9 @@ void BehaviourStack::run()
 	{
 		update();
 		perform_queued_actions();
+		// nothing is in the middle of a loop here, so the jobs can touch whatever they need
+		if (jobs != nullptr) {
+			jobs->run_main_thread_callbacks();
+		}
 	}
 }
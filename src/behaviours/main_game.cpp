@@ -1,18 +1,8 @@
 #include "behaviours/main_game.hpp"
 
-namespace {
-Vector3
-intersect_with_ground_plane(const Ray ray, float plane_height)
-{
-  const auto moveunit = (plane_height - ray.position.y) / ray.direction.y;
-  const auto intersection_point =
-    Vector3Add(ray.position, Vector3Scale(ray.direction, moveunit));
-  return intersection_point;
-}
-}; // namespace
-
 behaviours::MainGame::MainGame(std::shared_ptr<PlayerState> ps)
   : player_state(ps)
+  , simulation(*ps->gs)
 {
 }
 
@@ -20,7 +10,7 @@ void
 behaviours::MainGame::initialize()
 {
   GameState& gs = *player_state->gs;
-  AppState& as = *gs.app_state;
+  AppState& as = *player_state->app_state;
 
   logging::debug(__func__, "started");
   as.inputMgr.registerAction(
@@ -36,6 +26,52 @@ behaviours::MainGame::initialize()
       pretend_fraction, HexData::Visibility::SUPERIOR);
   }
 
+  player_state->terrain_renderer.load(as.jobs);
+  player_state->unit_renderer.load();
+  as.inputMgr.registerAction(
+    { "Switch Terrain Rendering",
+      [&] {
+        auto& terrain = player_state->terrain_renderer;
+        switch (terrain.mode) {
+          case TerrainRenderer::Mode::PerTile:
+            terrain.mode = terrain.instancing_available()
+                             ? TerrainRenderer::Mode::Instanced
+                             : TerrainRenderer::Mode::Baked;
+            break;
+          case TerrainRenderer::Mode::Instanced:
+            terrain.mode = TerrainRenderer::Mode::Baked;
+            break;
+          case TerrainRenderer::Mode::Baked:
+            terrain.mode = TerrainRenderer::Mode::PerTile;
+            break;
+        }
+      } },
+    { KEY_T, { KEY_LEFT_CONTROL } });
+
+  as.inputMgr.registerAction(
+    { "Toggle Terrain LOD",
+      [&] {
+        auto& settings = player_state->terrain_renderer.lod.settings;
+        settings.enabled = !settings.enabled;
+      } },
+    { KEY_L, { KEY_LEFT_CONTROL } });
+
+  as.inputMgr.registerAction(
+    { "Dump Profile",
+      [&] {
+        if (!profiler::ENABLED) {
+          logging::error("The profiler was compiled out, build with STRATGAME_PROFILER to use it");
+          return;
+        }
+        const std::string path = "profile.json";
+        if (profiler::write_chrome_trace(path, 10.0)) {
+          logging::info("Wrote the last 10 seconds to", path);
+        } else {
+          logging::error("Couldn't write the profile to", path);
+        }
+      } },
+    { KEY_P, { KEY_LEFT_CONTROL } });
+
   camera.fovy = 60.0;
   camera.projection = CameraProjection::CAMERA_PERSPECTIVE;
   camera.up = Vector3{ 0, 1, 0 };
@@ -73,12 +109,20 @@ behaviours::MainGame::initialize()
 void
 behaviours::MainGame::loop(BehaviourStack& bs)
 {
-  (void)bs;
   PlayerState& ps = *player_state;
   GameState& gs = *ps.gs;
-  AppState& as = *gs.app_state;
+  AppState& as = *ps.app_state;
 
   const auto frame_start = std::chrono::steady_clock::now();
+  if (simulation.advance() && ps.selected_unit.has_value()) {
+    // the selection follows the unit as it walks
+    for (const auto& step : simulation.snapshot().steps_since_last) {
+      auto& [location, type] = ps.selected_unit.value();
+      if (step.handle.type == type && gs.world.normalized_coords(location) == step.from) {
+        location = step.to;
+      }
+    }
+  }
   // for some reason, dragging around is unstable
   // i know, that the logical cursor is slightly delayed, but still, it should
   // be delayed equally for all of the frame. The exact pointthat is selected
@@ -104,19 +148,9 @@ behaviours::MainGame::loop(BehaviourStack& bs)
     camera.target = Vector3Add(camera.target, grab_offset);
   }
 
-  const auto top_left =
-    intersect_with_ground_plane(GetMouseRay(Vector2{ 0, 0 }, camera), 0.0f);
-  const auto top_right = intersect_with_ground_plane(
-    GetMouseRay(Vector2{ (float)GetScreenWidth(), 0 }, camera), 0.0f);
-  const auto bottom_left = intersect_with_ground_plane(
-    GetMouseRay(Vector2{ 0, (float)GetScreenHeight() }, camera), 0.0f);
-  const auto bottom_right = intersect_with_ground_plane(
-    GetMouseRay({ (float)GetScreenWidth(), (float)GetScreenHeight() }, camera),
-    0.0f);
-
   if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) &&
       Vector2DistanceSqr(click_start_screen_pos, mouse_position) < 250.0f) {
-    auto& units = gs.units.get_all_on_hex(hovered_coords);
+    const auto units = gs.units.get_all_on_hex(hovered_coords);
     if (units.has_any()) {
       if (ps.selected_unit.has_value() &&
           ps.selected_unit.value().first == hovered_coords) {
@@ -157,9 +191,25 @@ behaviours::MainGame::loop(BehaviourStack& bs)
   }
 
   if (ps.selected_unit.has_value() &&
-      IsMouseButtonReleased(MOUSE_RIGHT_BUTTON)) {
+      IsMouseButtonReleased(MOUSE_RIGHT_BUTTON) && IsKeyDown(KEY_LEFT_SHIFT)) {
+    // all units of the selected type walk there, and gather around it
+    switch (ps.selected_unit->second) {
+      case UnitType::Millitary:
+        gs.MoveUnitsTo<UnitType::Millitary>(ps.fraction, hovered_coords);
+        break;
+      case UnitType::Civilian:
+        gs.MoveUnitsTo<UnitType::Civilian>(ps.fraction, hovered_coords);
+        break;
+      case UnitType::Special:
+        gs.MoveUnitsTo<UnitType::Special>(ps.fraction, hovered_coords);
+        break;
+      default:;
+    }
+  } else if (ps.selected_unit.has_value() &&
+             IsMouseButtonReleased(MOUSE_RIGHT_BUTTON)) {
     // ps.selected_unit.value().first = hovered_coords;
     auto [location, type] = ps.selected_unit.value();
+    // the unit walks there over the next ticks, and reveals the map on the way
     switch (type) {
       case UnitType::Millitary:
         gs.MoveUnit<UnitType::Millitary>(location, hovered_coords);
@@ -172,17 +222,22 @@ behaviours::MainGame::loop(BehaviourStack& bs)
         break;
       default:;
     }
-    ps.selected_unit.value().first = hovered_coords;
-    gs.UpdateVission(ps.fraction);
   }
 
   if (IsKeyPressed(KEY_U)) {
     gs.units.put_unit_on_hex(hovered_coords,
                              MilitaryUnit{ { .id = 1, .health = 100 } });
+    gs.OnUnitsChanged(hovered_coords);
   }
 
-  // this is temporary and also terrible, and also shows the bad frustom in
-  // all_within_unscaled_quad
+  if (as.debug && IsKeyPressed(KEY_H)) {
+    // cycles the hovered tile through the kinds of tiles, paths go around it right away
+    const auto tileid = gs.world.at(hovered_coords).tileid;
+    gs.SetTile(hovered_coords,
+               (tileid + 1) % static_cast<int>(as.resourceStore.m_hex_table.size()));
+  }
+
+  // this is temporary and also terrible
   const auto scroll = GetMouseWheelMove();
   Vector3 direction =
     Vector3Normalize(Vector3Subtract(camera.target, camera.position));
@@ -193,18 +248,16 @@ behaviours::MainGame::loop(BehaviourStack& bs)
 
   const auto light_logic_end = std::chrono::steady_clock::now();
 
-  const auto to_render = ps.rendering_controller.all_within_unscaled_quad(
-    { top_left.x, top_left.z },
-    { top_right.x, top_right.z },
-    { bottom_left.x, bottom_left.z },
-    { bottom_right.x, bottom_right.z });
+  // only recomputed when the camera moved
+  ps.rendering_controller.update_visible(camera, gs.world);
 
   const auto rendering_start = std::chrono::steady_clock::now();
 
-  std::vector<HexCoords> movement_path;
+  // only searches when the hovered hex or the map changed since the last frame
+  std::span<const HexCoords> movement_path;
   if (ps.selected_unit.has_value()) {
-    movement_path =
-      HexCoords::make_line(ps.selected_unit.value().first, hovered_coords);
+    const auto [location, type] = ps.selected_unit.value();
+    movement_path = gs.PlanPath(location, hovered_coords, type).path;
   }
 
   BeginDrawing();
@@ -213,42 +266,34 @@ behaviours::MainGame::loop(BehaviourStack& bs)
     BeginMode3D(camera);
     {
       DrawGrid(10, 1.0f);
-      for (const auto coords : to_render) {
-        auto hx = gs.world.at(coords);
-        auto tint = WHITE;
-        if (coords == hovered_coords) {
-          tint = BLUE;
-        }
-        const auto [tx, ty] = coords.to_world_unscaled();
-        if (hx.tileid != -1 && (as.debug || hx.getFractionVisibility(ps.fraction) != HexData::Visibility::NONE)) {
-          DrawModelEx(as.resourceStore.m_hex_table.at(hx.tileid).model,
-                      Vector3{ tx, -0.2, ty },
-                      Vector3{ 0, 1, 0 },
-                      0.0,
-                      Vector3{ scale, scale, scale },
-                      tint);
-        }
-
-        if (ps.selected_unit && coords == ps.selected_unit.value().first) {
-          DrawCircle3D(
-            Vector3{ tx, 0.3, ty }, 0.8f, Vector3{ 1, 0, 0 }, 90.0f, RED);
-          DrawCircle3D(
-            Vector3{ tx, 0.3, ty }, 0.75f, Vector3{ 1, 0, 0 }, 90.0f, RED);
-        }
-
-        auto units = gs.units.get_all_on_hex(coords);
-        if (units.military.has_value()) {
-          DrawSphere(Vector3{ tx, 0.3, ty }, 0.4, RED);
-        } else if (units.special.has_value()) {
-          DrawSphere(Vector3{ tx, 0.3, ty }, 0.4, YELLOW);
-        } else if (units.civilian.has_value()) {
-          DrawSphere(Vector3{ tx, 0.3, ty }, 0.4, GREEN);
-        }
+      const auto terrain_start = std::chrono::steady_clock::now();
+      ps.terrain_renderer.update_fog(gs.world, ps.fraction, gs.visibility_changes, bs.frame_arena);
+      ps.terrain_renderer.draw(ps.rendering_controller,
+                               TerrainFrame{ .world = gs.world,
+                                             .resources = as.resourceStore,
+                                             .terrain_revision = gs.terrain_revision,
+                                             .chunk_revisions = gs.chunk_revisions,
+                                             .show_hidden = as.debug,
+                                             .scale = scale,
+                                             .hovered = hovered_coords,
+                                             .camera_position = camera.position,
+                                             .scratch = bs.frame_arena });
+      terrain_time = std::chrono::steady_clock::now() - terrain_start;
+
+      std::optional<HexCoords> selected;
+      if (ps.selected_unit.has_value()) {
+        selected = ps.selected_unit->first;
       }
+      ps.unit_renderer.draw(ps.rendering_controller,
+                            gs.world,
+                            gs.units,
+                            selected,
+                            simulation.snapshot().steps,
+                            simulation.interpolation_alpha());
 
       for (size_t i = 0; i + 1 < movement_path.size(); i++) {
-        const auto a = movement_path.at(i).to_world_unscaled();
-        const auto b = movement_path.at(i + 1).to_world_unscaled();
+        const auto a = movement_path[i].to_world_unscaled();
+        const auto b = movement_path[i + 1].to_world_unscaled();
 
         DrawLine3D(Vector3{ a.first, 0.5, a.second },
                    Vector3{ b.first, 0.5, b.second },
@@ -268,6 +313,78 @@ behaviours::MainGame::loop(BehaviourStack& bs)
                30,
                20,
                BLACK);
+      const auto& terrain = ps.terrain_renderer;
+      const auto& terrain_stats = terrain.stats();
+      const char* terrain_mode = "per tile";
+      if (terrain.mode == TerrainRenderer::Mode::Instanced) {
+        terrain_mode = "instanced";
+      } else if (terrain.mode == TerrainRenderer::Mode::Baked) {
+        terrain_mode = "baked";
+      }
+      DrawText(TextFormat("Terrain (%s): %i draw calls, %i tiles, %.2f ms",
+                          terrain_mode,
+                          terrain_stats.draw_calls,
+                          terrain_stats.instances,
+                          std::chrono::duration<double, std::milli>(terrain_time).count()),
+               10,
+               70,
+               20,
+               BLACK);
+      const auto& lods = terrain_stats.lods;
+      DrawText(TextFormat("LOD%s - full: %i chunks, %i draws, %i tris | prism: %i chunks, %i draws, %i tris | quad: %i chunks, %i draws, %i tris",
+                          terrain.lod.settings.enabled ? "" : " (off)",
+                          lods[0].chunks, lods[0].draw_calls, static_cast<int>(lods[0].triangles),
+                          lods[1].chunks, lods[1].draw_calls, static_cast<int>(lods[1].triangles),
+                          lods[2].chunks, lods[2].draw_calls, static_cast<int>(lods[2].triangles)),
+               10,
+               90,
+               20,
+               BLACK);
+      const auto& fog_stats = terrain.fog_stats();
+      DrawText(TextFormat("Fog: %i uploads, %i tiles, %i full uploads so far",
+                          fog_stats.uploads,
+                          fog_stats.texels,
+                          fog_stats.full_uploads),
+               10,
+               110,
+               20,
+               BLACK);
+      const auto& unit_stats = ps.unit_renderer.stats();
+      DrawText(TextFormat("Units%s: %i on screen, %i batches, %i draw calls",
+                          ps.unit_renderer.instancing_available() ? "" : " (not instanced)",
+                          unit_stats.units,
+                          unit_stats.batches,
+                          unit_stats.draw_calls),
+               10,
+               130,
+               20,
+               BLACK);
+      if (terrain.mode == TerrainRenderer::Mode::Baked) {
+        const auto& chunk_stats = terrain.chunk_stats();
+        DrawText(TextFormat("Chunks: %i baked, %i pending, %i meshes, %i vertices, %.1f MB, %.2f ms per bake (max %.2f)",
+                            chunk_stats.chunks,
+                            chunk_stats.pending,
+                            chunk_stats.meshes,
+                            static_cast<int>(chunk_stats.vertices),
+                            chunk_stats.gpu_bytes / (1024.0 * 1024.0),
+                            chunk_stats.bakes > 0 ? chunk_stats.total_bake_ms / chunk_stats.bakes : 0.0,
+                            chunk_stats.max_bake_ms),
+                 10,
+                 150,
+                 20,
+                 BLACK);
+      }
+      const auto& sim_stats = simulation.stats();
+      DrawText(TextFormat("Simulation: tick %i, %.2f ms per tick (max %.2f), %i dropped",
+                          static_cast<int>(simulation.snapshot().tick),
+                          sim_stats.average_tick_ms,
+                          sim_stats.max_tick_ms,
+                          static_cast<int>(sim_stats.dropped)),
+               10,
+               170,
+               20,
+               BLACK);
+      draw_frame_history(10, 200, bs.frame_arena.stats());
       const auto hovered_tile = gs.world.at(hovered_coords);
       if (hovered_tile.tileid != -1) {
         DrawText(
@@ -295,16 +412,69 @@ behaviours::MainGame::loop(BehaviourStack& bs)
 
   const auto rendering_end = std::chrono::steady_clock::now();
 
-  const auto total_time = (rendering_end - frame_start).count();
-  const auto rendering_time = (rendering_end - rendering_start).count();
-  const auto vis_test = (rendering_start - light_logic_end).count();
+  if constexpr (profiler::ENABLED) {
+    profiler::record("logic", frame_start, light_logic_end);
+    profiler::record("visibility", light_logic_end, rendering_start);
+    profiler::record("rendering", rendering_start, rendering_end);
+  }
 
-  (void)total_time;
-  (void)rendering_time;
-  (void)vis_test;
+  const auto ms = [](auto duration) {
+    return std::chrono::duration<float, std::milli>(duration).count();
+  };
+  frame_history.add({ ms(light_logic_end - frame_start),
+                      ms(rendering_start - light_logic_end),
+                      ms(rendering_end - rendering_start),
+                      ms(rendering_end - frame_start) });
+}
+
+void
+behaviours::MainGame::draw_frame_history(int x,
+                                         int y,
+                                         const FrameArena::Stats& arena) const
+{
+  // a bar per frame, the full height being two 60 fps frames
+  constexpr int graph_height = 40;
+  constexpr float graph_ms = 2.0f * 1000.0f / 60.0f;
+  constexpr int width = static_cast<int>(decltype(frame_history)::FRAMES);
+  for (size_t phase = 0; phase < frame_history.names.size(); phase++) {
+    const int top = y + static_cast<int>(phase) * (graph_height + 24);
+    DrawText(TextFormat("%s: %.2f ms, max %.2f ms",
+                        frame_history.names[phase],
+                        frame_history.average(phase),
+                        frame_history.max(phase)),
+             x,
+             top,
+             20,
+             BLACK);
+    DrawRectangle(x, top + 22, width, graph_height, Fade(WHITE, 0.5f));
+    for (size_t i = 0; i < frame_history.count; i++) {
+      const float value = frame_history.at(phase, i);
+      const int height =
+        std::min(graph_height, static_cast<int>(value / graph_ms * graph_height));
+      // going past a 60 fps frame turns the bar red
+      const Color color = value > graph_ms / 2.0f ? RED : DARKGREEN;
+      DrawRectangle(x + static_cast<int>(i),
+                    top + 22 + graph_height - height,
+                    1,
+                    height,
+                    color);
+    }
+  }
+  // the current frame isn't done with it yet, so the last one is shown
+  DrawText(TextFormat("Frame arena: %.1f KB last frame, %.1f KB peak, %.1f KB in %i blocks",
+                      arena.last_frame / 1024.0,
+                      arena.peak / 1024.0,
+                      arena.capacity / 1024.0,
+                      arena.blocks),
+           x,
+           y + static_cast<int>(frame_history.names.size()) * (graph_height + 24),
+           20,
+           BLACK);
 }
 
 behaviours::MainGame::~MainGame()
 {
+  player_state->terrain_renderer.unload();
+  player_state->unit_renderer.unload();
   UnloadTexture(ui_atlas_texture);
 }
\ No newline at end of file
@@ -31,20 +31,50 @@ void behaviours::MainMenu::loop(BehaviourStack &bs) {
         return;
       }
       
+      WorldGenOptions worldgen_options;
+      if (const auto seed_text = seed_writebox.getText(); !seed_text.empty()) {
+        uint32_t seed = 0;
+        const auto [end, error] = std::from_chars(seed_text.data(), seed_text.data() + seed_text.size(), seed);
+        if (error != std::errc{} || end != seed_text.data() + seed_text.size()) {
+          error_text.set_text("World seed must be a whole number");
+          return;
+        }
+        worldgen_options["seed"] = static_cast<double>(seed);
+      }
+
       auto connection = std::make_shared<Connection>(ip, port);
-      auto gs = std::make_shared<GameState>(app_state, connection);
+      auto& defs = app_state->definitions;
+      auto gs = std::make_shared<GameState>(connection, defs.HexVisionCosts(), defs.HexMovementCosts(), &app_state->jobs);
       gs->nickname = nickname_writebox.getText();
 
-      auto loader = std::make_shared<behaviours::LoadingScreen<behaviours::MainGame>>([connection, ran = false, gs](auto&, auto& loader) mutable {      
+      auto loader = std::make_shared<behaviours::LoadingScreen<behaviours::MainGame>>([connection, ran = false, gs, as = app_state, worldgen_options](auto& bs, auto& loader) mutable {      
         if (!ran) {
           ran = true;
-          gs->ConnectAndInitialize([gs, loader = loader.shared_from_this()]{
-            auto ps = std::make_shared<PlayerState>(gs);
+          // the generator gets a VM of its own on the worker, with what's fine to use from there - not the input
+          AppState* app = as.get();
+          const WorldGenVMFactory make_vm = [app](const std::string& entry_point) {
+            return app->moduleLoader.Instantiate(entry_point, app->definitions, app->noise);
+          };
+          gs->ConnectAndInitialize([as, gs, loader = loader.shared_from_this()]{
+            auto ps = std::make_shared<PlayerState>(as, gs);
             logging::debug("Ready to proceed");
             loader->signal_done(new behaviours::MainGame(ps));
-          });
+          }, as->definitions.FindGenerator("default"), worldgen_options, make_vm);
         }
         connection->handleTasks();
+
+        if (const auto task = gs->worldgen_task) {
+          if (task->finished && !task->succeeded) {
+            // cancelled, or the generator failed - back to the menu
+            bs.defer_pop();
+            return;
+          }
+          loader.text = "Generating the world...";
+          loader.progress = task->progress.load();
+          if (!task->finished && !task->cancel_requested && !loader.on_cancel.has_value()) {
+            loader.on_cancel = [task] { task->Cancel(); };
+          }
+        }
       });
 
       bs.defer_push(loader);
@@ -59,6 +89,7 @@ void behaviours::MainMenu::loop(BehaviourStack &bs) {
   connection_addr_writebox.handle_events(key_pressed);
   game_id_writebox.handle_events(key_pressed);
   nickname_writebox.handle_events(key_pressed);
+  seed_writebox.handle_events(key_pressed);
 
   BeginDrawing();
   {
@@ -70,13 +101,14 @@ void behaviours::MainMenu::loop(BehaviourStack &bs) {
     connection_addr_writebox.draw();
     game_id_writebox.draw();
     nickname_writebox.draw();
+    seed_writebox.draw();
     error_text.draw();
   }
   EndDrawing();
 }
 
 void behaviours::MainMenu::adjust_to_window() {
-  const int containerHeight = 380;
+  const int containerHeight = 410;
   //todo: auto layout
   float y = (GetScreenHeight() - containerHeight)/2;
   game_name.set_position(GetScreenWidth() * 0.5f, y);
@@ -87,7 +119,9 @@ void behaviours::MainMenu::adjust_to_window() {
   game_id_writebox.set_position(GetScreenWidth() * 0.5f, y);
   y += game_id_writebox.getHeight() + 10;
   nickname_writebox.set_position(GetScreenWidth() * 0.5f, y);
-  y += nickname_writebox.getHeight() + 50;
+  y += nickname_writebox.getHeight() + 10;
+  seed_writebox.set_position(GetScreenWidth() * 0.5f, y);
+  y += seed_writebox.getHeight() + 50;
 
   play_button.set_position(GetScreenWidth() * 0.5f, y);
   y += play_button.getHeight() + 10;
@@ -0,0 +1,325 @@
+#include "definitions.hpp"
+#include "utils.hpp"
+#include "profiler.hpp"
+
+std::vector<issues::AnyIssue> GameDefinitions::LoadModuleDefinitions(ModuleLoader& ml) {
+    PROFILE_ZONE("load definitions");
+    std::vector<issues::AnyIssue> issues;
+
+    for(const auto& [_, mod] : ml.m_loaded_modules) {
+        LoadProducts(ml, mod, issues);
+        LoadHexes(ml, mod, issues);
+        LoadWorldGen(ml, mod, issues);
+    }
+
+    return issues;
+}
+
+template <sol::type Wanted> [[noreturn]] static void DoThrowBadType (ModuleLoader& ml, auto obj, std::string_view field, std::string what_def = "???")  {
+    throw issues::AnyIssue(issues::InvalidType{
+        .what_module = ml.GetModule(obj.lua_state()).value().get().name_unsafe(),
+        .what_def = std::string(what_def),
+        .what_field = std::string(field),
+        .what_type_wanted = Wanted,
+        .what_type_provided = obj.get_type()
+    });
+}
+
+struct GetUtils {
+    ModuleLoader& ml;
+    std::string what_def;
+
+    GetUtils(ModuleLoader& ml, std::string what_def = "???") : ml(ml), what_def(what_def) {}
+
+    template <typename ConvertInto, sol::type stored_type> sol::optional<ConvertInto> GetOptional (sol::table& from, std::string_view field) {
+        auto v = from[field];
+        if (!v.valid()) {
+            return {};
+        }
+        if (v.get_type() != stored_type) {
+            DoThrowBadType<stored_type>(ml, v, field, what_def);
+        }
+        return v.get<ConvertInto>();
+    }
+
+    template <typename ConvertInto, sol::type stored_type> ConvertInto GetRequired (sol::table& from, std::string_view field) {
+        auto v = from[field];
+        if (!v.valid()) {
+            throw issues::AnyIssue(issues::MissingField{.what_module = ml.GetModule(from.lua_state()).value().get().name_unsafe(), .what_def = what_def, .fieldname = std::string(field)});
+        }
+        if (v.get_type() != stored_type) {
+            DoThrowBadType<stored_type>(ml, v, field, what_def);
+        }
+        return v.get<ConvertInto>();
+    }
+};
+
+void GameDefinitions::LoadProducts(ModuleLoader& ml, const Module &mod, std::vector<issues::AnyIssue> &issues) {
+    auto GetU = GetUtils(ml, "product");
+
+    sol::optional<sol::table> prods = mod.module_root_object["declarations"]["products"];
+    if (!prods.has_value()) return; // nothing to do, no products defined
+    m_products.reserve(prods.value().size());
+    for(const auto& [_, rtab] : prods.value()) {
+        try {
+            ProductDefinition def;
+            if (rtab.get_type() != sol::type::table) {
+                DoThrowBadType<sol::type::table>(ml, rtab, "(root)");
+            }
+            sol::table tab = rtab; 
+            def.name = GetU.GetRequired<sol::string_view, sol::type::string>(tab, "name");
+            const auto icon = GetU.GetRequired<sol::string_view, sol::type::string>(tab, "icon");
+            def.icon = ResolveModuleFileThrows(mod, std::filesystem::path(icon));
+            m_products.emplace_back(def);
+        } catch (issues::AnyIssue& issue) {
+            issues.push_back(issue);
+        } catch (...) {
+            issues.emplace_back(issues::UnknownError{.message = "???"});
+        }
+    }
+}
+
+void GameDefinitions::LoadHexes(ModuleLoader& modl, const Module &mod, std::vector<issues::AnyIssue> &issues) {
+    auto G = GetUtils(modl, "hex");
+
+    sol::optional<sol::table> hexes = mod.module_root_object["declarations"]["hexes"];
+    if (!hexes.has_value()) return; // nothing to do, no products defined
+    for(const auto& [_, rtab] : hexes.value()) {
+        try {
+            logging::debug("LoadHexes loop start");
+            HexDefinition def;
+            if (rtab.get_type() != sol::type::table) {
+                issues.push_back(issues::InvalidType{
+                    .what_module = mod.name_unsafe(),   
+                    .what_def = "Hexes",
+                    .what_field = "N/A (root table of the hex)",
+                    .what_type_wanted = sol::type::table,
+                    .what_type_provided = rtab.get_type()
+                });
+                continue;
+            }
+            sol::table tab = rtab; 
+            sol::string_view name = G.GetRequired<sol::string_view, sol::type::string>(tab, "name");
+            sol::string_view model = G.GetRequired<sol::string_view, sol::type::string>(tab, "model");
+            auto description = G.GetOptional<sol::string_view, sol::type::string>(tab, "description");
+            auto products = G.GetOptional<sol::table, sol::type::table>(tab, "products");
+            auto vis_cost = G.GetOptional<int, sol::type::number>(tab, "vision_cost");
+            auto mov_cost = G.GetOptional<int, sol::type::number>(tab, "movement_cost");
+
+            const auto model_path = ResolveModuleFile(mod, std::filesystem::path(model));
+            if (!model_path.has_value()) {
+                issues.push_back(issues::InvalidFile{.what_module = mod.name_unsafe(), .filepath = std::string(model)});
+                continue;
+            }
+            
+            def.name = name;
+            def.model = model_path.value();
+            if (description.has_value()) def.description = description.value();
+            if (products.has_value()) {
+                for(auto& [key, value] : products.value()) {
+                    if (key.get_type() != sol::type::string) {
+                        issues.push_back(issues::InvalidKey{.what_module = mod.name_unsafe(), .what_def = "hexes"});
+                        continue;
+                    }
+                    def.produces.push_back({FindProductIndex(std::string(key.as<sol::string_view>())), value.as<int>()});
+                }
+            }
+            if (vis_cost.has_value()) def.vision_cost = vis_cost.value();
+            if (mov_cost.has_value()) def.movement_cost = mov_cost.value();
+            m_hexes.push_back(def);
+        } catch (issues::AnyIssue& issue) {
+            issues.push_back(issue);
+        } catch (std::exception& e) {
+            issues.emplace_back(issues::UnknownError{.message = e.what()});
+        }
+    }
+}
+
+void GameDefinitions::LoadWorldGen(ModuleLoader& modl, const Module &mod, std::vector<issues::AnyIssue> &issues) {
+    using namespace sol;
+    
+    optional<table> wgens = mod.module_root_object["declarations"]["world_generators"];
+    if (!wgens.has_value()) return;
+    for(const auto& [_, rtab] : wgens.value()) {
+        auto def = std::make_unique<WorldGen>();
+        if (rtab.get_type() != type::table) {
+            issues.push_back(issues::InvalidType{
+                .what_module = mod.name_unsafe(),
+                .what_def = "WorldGenerator",
+                .what_field = "N/A (root table of the world gen)",
+                .what_type_wanted = type::table,
+                .what_type_provided = rtab.get_type()
+            });
+            continue;
+        }
+        table gen = rtab;
+        optional<string_view> name = gen["name"];
+        optional<table> options = gen["options"];
+        optional<protected_function> generator = gen["generator"];
+
+        if (!name.has_value()) {
+            issues.push_back(issues::MissingField{.what_module = mod.name_unsafe(), .what_def = "world generators", .fieldname = "name"});
+            continue;
+        }
+        // options are optional
+        if (!generator.has_value()) {
+            issues.push_back(issues::MissingField{.what_module = mod.name_unsafe(), .what_def = "world generators", .fieldname = "generator"});
+            continue;
+        }
+
+        def->name = std::string(name.value());
+        def->generator = generator.value();
+        def->entry_point = mod.entry_point;
+        if (gen["chunked"].valid()) {
+            if (gen["chunked"].get_type() != type::table) {
+                issues.push_back(issues::InvalidType{
+                    .what_module = mod.name_unsafe(),
+                    .what_def = "WorldGenerator",
+                    .what_field = "chunked",
+                    .what_type_wanted = type::table,
+                    .what_type_provided = gen["chunked"].get_type()
+                });
+                continue;
+            }
+            table chunked = gen["chunked"];
+            optional<int> width = chunked["width"];
+            optional<int> height = chunked["height"];
+            if (!width.has_value() || !height.has_value() || width.value() <= 0 || height.value() <= 0) {
+                issues.push_back(issues::MissingField{.what_module = mod.name_unsafe(), .what_def = "world generators", .fieldname = "chunked.width / chunked.height"});
+                continue;
+            }
+            def->chunked = WorldGen::ChunkedSize{width.value(), height.value()};
+        }
+        if (options.has_value()) {
+            // ! TODO: Finish this
+            for(const auto& [key, value] : options.value()) {
+                try {
+                    // this is rushed, but the whole system needs some good utils
+                    const string_view name = key.as<string_view>();
+                    table deets = value;
+                    const string_view typestring = deets["type"].get<string_view>();
+                    const string_view description = deets["description"].get<string_view>();
+                    if (typestring == "range") {
+                        std::string description;
+                        if (deets["description"].valid()) {
+                            description = std::string(deets["description"].get<string_view>());
+                        }
+
+                        def->options.emplace_back(WorldGen::Option{
+                            .name = std::string(name), 
+                            .value = WorldGen::RangeOption{
+                                .from = deets["from"].get<double>(),
+                                .to = deets["to"].get<double>(),
+                                .step = deets["to"].get_or(1.0),
+                                .default_value = deets["default_value"].get_or(deets["from"].get<double>()),
+                                .description = description
+                            }
+                        });
+                    } else if (typestring == "selection") {
+                        
+                    } else if (typestring == "toggle") {
+
+                    } else if (typestring == "seed") {
+
+                    }
+                } catch (std::exception& e) {
+                    continue;
+                }
+            }
+        }
+    
+        m_worldgens.emplace_back(std::move(def));
+    }
+}
+
+std::optional<std::filesystem::path> GameDefinitions::ResolveModuleFile(const Module &m, std::filesystem::path relpath) const {
+    auto entry = std::filesystem::path(m.entry_point);
+    // security here should not be an issue - lua modules should not get a read into our memory, so we can should be ok to load anything
+    const auto target = entry.remove_filename()/relpath;
+    if (std::filesystem::is_regular_file(target)) {
+        return target;
+    } else {
+        return {};
+    }
+}
+
+std::filesystem::path GameDefinitions::ResolveModuleFileThrows(const Module &m, std::filesystem::path relpath) const {
+    auto r = ResolveModuleFile(m, relpath);
+    if (r.has_value()) {
+        return r.value();
+    } else {
+        throw issues::InvalidFile{.what_module = m.name_unsafe(), .filepath = relpath.string()};
+    }
+}
+
+int GameDefinitions::FindProductIndex(std::string name) {
+    const auto it = std::find_if(m_products.begin(), m_products.end(), [&](const ProductDefinition& prod) {
+        return prod.name == name;
+    });
+
+    if (it == m_products.end()) return -1;
+    return std::distance(m_products.begin(), it)+1;    
+}
+
+int GameDefinitions::FindHexIndex(std::string name) {
+    const auto it = std::find_if(m_hexes.begin(), m_hexes.end(), [&](const HexDefinition& hex) {
+        return hex.name == name;
+    });
+
+    if (it == m_hexes.end()) return -1;
+    return std::distance(m_hexes.begin(), it);
+}
+
+int GameDefinitions::FindGeneratorIndex(std::string name) {
+    const auto it = std::find_if(m_worldgens.begin(), m_worldgens.end(), [&](const auto& gen) {
+        return gen->name == name;
+    });
+
+    if (it == m_worldgens.end()) return -1;
+    return std::distance(m_worldgens.begin(), it);
+}
+
+
+const ProductDefinition& GameDefinitions::GetProduct(int idx) {
+    return m_products.at(idx); 
+};
+
+const HexDefinition& GameDefinitions::GetHex(int idx) {
+    return m_hexes.at(idx);
+};
+
+const WorldGen& GameDefinitions::GetGenerator(int idx) {
+    return *m_worldgens.at(idx);
+};
+
+const WorldGen* GameDefinitions::FindGenerator(std::string name) {
+    const int idx = FindGeneratorIndex(std::move(name));
+    return idx >= 0 ? m_worldgens[idx].get() : nullptr;
+}
+
+std::vector<int> GameDefinitions::HexVisionCosts() const {
+    std::vector<int> costs;
+    costs.reserve(m_hexes.size());
+    for(const auto& hex : m_hexes) {
+        costs.push_back(hex.vision_cost);
+    }
+    return costs;
+}
+
+std::vector<int> GameDefinitions::HexMovementCosts() const {
+    std::vector<int> costs;
+    costs.reserve(m_hexes.size());
+    for(const auto& hex : m_hexes) {
+        costs.push_back(hex.movement_cost);
+    }
+    return costs;
+}
+
+void GameDefinitions::InjectSymbols(sol::state &lua) {
+    using sol::as_function;
+
+    lua.create_named_table("Defs",
+        "getHex", as_function(&GameDefinitions::FindHexIndex, this),
+        "getProduct", as_function(&GameDefinitions::FindProductIndex, this)
+    );
+}
\ No newline at end of file
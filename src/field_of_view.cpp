@@ -0,0 +1,126 @@
+#include "field_of_view.hpp"
+#include <cstdint>
+#include <algorithm>
+
+namespace {
+// Offsets are stored in spiral order (center, then ring 1, ring 2...), so both parents of an offset
+// are always earlier in the table than the offset itself
+struct FovTable {
+    std::vector<int> dq;
+    std::vector<int> dr;
+    std::vector<uint16_t> parent_a;
+    std::vector<uint16_t> parent_b;
+};
+
+FovTable build_fov_table() {
+    constexpr int R = FieldOfView::MAX_RADIUS;
+    constexpr int side = 2 * R + 1;
+    std::vector<int> index_of(side * side, -1);
+    const auto slot = [&](HexCoords hc) -> int& { return index_of.at((hc.r + R) * side + (hc.q + R)); };
+
+    FovTable table;
+    const auto center = HexCoords::from_axial(0, 0);
+    const auto push = [&](HexCoords hc) {
+        slot(hc) = static_cast<int>(table.dq.size());
+        table.dq.push_back(hc.q);
+        table.dr.push_back(hc.r);
+    };
+    push(center);
+    for (int k = 1; k <= R; k++) {
+        for (const auto hc : center.ring(k)) {
+            push(hc);
+        }
+    }
+
+    // the parent is the previous step on a line from the center, nudged to both sides
+    // so that rays going exactly along the edges between hexes can pass through either one
+    const auto step_back = [&](HexCoords to, float nudge) {
+        const float k = static_cast<float>(center.distance(to));
+        const float f = (k - 1.0f) / k;
+        return HexCoords::rounded_to_hex(to.q * f + nudge, to.r * f + 2.0f * nudge, to.s * f - 3.0f * nudge);
+    };
+    const auto n = table.dq.size();
+    table.parent_a.resize(n, 0);
+    table.parent_b.resize(n, 0);
+    for (size_t i = 1; i < n; i++) {
+        const auto to = HexCoords::from_axial(table.dq[i], table.dr[i]);
+        table.parent_a[i] = static_cast<uint16_t>(slot(step_back(to, +1e-4f)));
+        table.parent_b[i] = static_cast<uint16_t>(slot(step_back(to, -1e-4f)));
+    }
+    return table;
+}
+
+const FovTable& fov_table() {
+    static const FovTable table = build_fov_table();
+    return table;
+}
+} // namespace
+
+FieldOfView::FieldOfView(const std::vector<int>& vision_costs) {
+    set_vision_costs(vision_costs);
+}
+
+void FieldOfView::set_vision_costs(const std::vector<int>& vision_costs) {
+    m_costs.clear();
+    m_costs.reserve(vision_costs.size() + 1);
+    m_costs.push_back(BLOCKED);
+    for (const auto cost : vision_costs) {
+        m_costs.push_back(std::clamp(cost, 0, BLOCKED));
+    }
+}
+
+std::span<const int> FieldOfView::compute(const CylinderHexWorld<HexData>& world, HexCoords origin, int range) {
+    if (origin.r < 0 || origin.r >= world.height || world.width <= 0) {
+        return {};
+    }
+    const auto& table = fov_table();
+    // ranges wider than the world would wrap onto themselves
+    range = std::clamp(range, 0, std::min(MAX_RADIUS, world.width - 1));
+    const int n = 1 + 3 * range * (range + 1);
+    if (m_spent.size() < static_cast<size_t>(n)) {
+        m_spent.resize(n);
+        m_visible.resize(n);
+    }
+
+    const int width = world.width;
+    const unsigned height = world.height;
+    const unsigned cost_count = m_costs.size();
+    const int oq = positive_modulo(origin.q, width);
+    const int orr = origin.r;
+
+    m_spent[0] = 0;
+    m_visible[0] = orr * width + oq;
+    int visible_count = 1;
+    for (int i = 1; i < n; i++) {
+        const int uq = oq + table.dq[i];
+        const int q = uq + width * ((uq < 0) - (uq >= width));
+        const int r = orr + table.dr[i];
+        const bool on_map = static_cast<unsigned>(r) < height;
+        const int idx = on_map ? r * width + q : 0;
+        const unsigned cost_slot = world.data[idx].tileid + 1;
+        const int cost = (on_map && cost_slot < cost_count) ? m_costs[cost_slot] : BLOCKED;
+        const int through = std::min(m_spent[table.parent_a[i]], m_spent[table.parent_b[i]]);
+        m_spent[i] = std::min(through + cost, BLOCKED);
+        // written unconditionally, only counted when visible
+        m_visible[visible_count] = idx;
+        visible_count += on_map & (through < range);
+    }
+    return std::span<const int>(m_visible.data(), visible_count);
+}
+
+void FieldOfView::reveal(CylinderHexWorld<HexData>& world, HexCoords origin, int range, int fraction, HexData::Visibility vis) {
+    for (const auto idx : compute(world, origin, range)) {
+        auto& hex = world.data[idx];
+        const auto before = hex.visibility_flags;
+        hex.setFractionVisibility(fraction, vis);
+        if (hex.visibility_flags != before) {
+            m_changed.insert(HexKey::from(world.coords_of_index(idx)));
+        }
+    }
+}
+
+void FieldOfView::reveal_batch(CylinderHexWorld<HexData>& world, std::span<const FovViewer> viewers, int fraction, HexData::Visibility vis) {
+    for (const auto& viewer : viewers) {
+        reveal(world, viewer.origin, viewer.range, fraction, vis);
+    }
+}
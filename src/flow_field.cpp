@@ -0,0 +1,350 @@
+#include "flow_field.hpp"
+#include <algorithm>
+
+namespace {
+// with fewer chunks than this per job, making the job costs more than it saves
+constexpr int MIN_CHUNKS_PER_JOB = 2;
+// how far ahead of the lowest queued cost chunks are relaxed, in chunks crossed at the highest step cost
+constexpr int WAVE_WINDOW_CHUNKS = 1;
+
+// Chunks of the same colour never touch, so their tiles never look at each other.
+// With an odd number of chunk columns, the last column touches the first one over the wrap, so it gets its own colours.
+int chunk_colour(int cx, int cy, int chunks_wide) {
+    if (chunks_wide % 2 == 1 && chunks_wide > 1 && cx == chunks_wide - 1) {
+        return 4 + cy % 2;
+    }
+    return cx % 2 + 2 * (cy % 2);
+}
+
+struct Relaxation {
+    const CylinderHexWorld<HexData>& world;
+    const Pathfinder& costs;
+    int max_cost;
+    std::vector<int>& cost;
+    // tiles of the chunk whose cost was set from the outside - the targets, before the chunk is first relaxed
+    std::vector<std::vector<int>> pending;
+    // set by the chunk itself to the lowest new cost on its edge, so the chunks around know they need another look
+    std::vector<int> edge_changed;
+    // per chunk, the lowest cost the chunks around have offered since it was last relaxed, NO_COST if it's not queued
+    std::vector<int> offered;
+    // per chunk, whether any tile in it got a cost - the others are left as they are
+    std::vector<uint8_t> reached;
+};
+
+// Takes what the chunks around have to offer over the edge, then spreads it over the chunk.
+// Only writes tiles of the chunk, and only reads tiles of the chunk and the ones right around it.
+void relax_chunk(Relaxation& rx, int chunk) {
+    const auto& world = rx.world;
+    auto& cost = rx.cost;
+    const auto [origin, size] = world.chunk_bounds(chunk);
+    const int q0 = origin.q;
+    const int r0 = origin.r;
+    const int q1 = q0 + size.first;
+    const int r1 = r0 + size.second;
+    const auto wrap_q = [&](int q) { return q < 0 ? q + world.width : (q >= world.width ? q - world.width : q); };
+    const auto inside = [&](int q, int r) { return q >= q0 && q < q1 && r >= r0 && r < r1; };
+    const auto on_edge = [&](int q, int r) { return q == q0 || q == q1 - 1 || r == r0 || r == r1 - 1; };
+
+    // (cost when queued, world index)
+    thread_local std::vector<std::pair<int, int>> seeds;
+    seeds.clear();
+    for (const int idx : rx.pending[chunk]) {
+        seeds.emplace_back(cost[idx], idx);
+    }
+    rx.pending[chunk].clear();
+
+    for (int r = r0; r < r1; r++) {
+        for (int q = q0; q < q1; q++) {
+            if (!on_edge(q, r)) continue;
+            const int idx = r * world.width + q;
+            if (rx.costs.entering_cost(world, idx) == Pathfinder::IMPASSABLE) continue;
+            int best = cost[idx];
+            for (const auto [dq, dr] : axial_directions) {
+                const int nq = wrap_q(q + dq);
+                const int nr = r + dr;
+                if (nr < 0 || nr >= world.height || inside(nq, nr)) continue;
+                const int other = nr * world.width + nq;
+                if (cost[other] == FlowField::NO_COST) continue;
+                const int step = rx.costs.entering_cost(world, other);
+                if (step == Pathfinder::IMPASSABLE) continue;
+                best = std::min(best, cost[other] + step);
+            }
+            if (best < cost[idx] && best <= rx.max_cost) {
+                cost[idx] = best;
+                seeds.emplace_back(best, idx);
+            }
+        }
+    }
+    if (seeds.empty()) {
+        return;
+    }
+    std::sort(seeds.begin(), seeds.end());
+    rx.reached[chunk] = 1;
+
+    // Dial's algorithm - steps cost 1 to max_step_cost, so everything queued fits in that many buckets past the current cost
+    const int bucket_count = rx.costs.max_step_cost() + 1;
+    thread_local std::vector<std::vector<int>> buckets;
+    if (static_cast<int>(buckets.size()) < bucket_count) {
+        buckets.resize(bucket_count);
+    }
+    size_t queued = 0;
+    size_t next_seed = 0;
+    int current = seeds.front().first;
+    int edge_changed = FlowField::NO_COST;
+    while (true) {
+        if (queued == 0) {
+            if (next_seed == seeds.size()) break;
+            current = std::max(current, seeds[next_seed].first);
+        }
+        for (; next_seed < seeds.size() && seeds[next_seed].first <= current; next_seed++) {
+            const int idx = seeds[next_seed].second;
+            if (cost[idx] != seeds[next_seed].first) continue; // found a better way since
+            buckets[cost[idx] % bucket_count].push_back(idx);
+            queued++;
+        }
+        auto& bucket = buckets[current % bucket_count];
+        if (bucket.empty()) {
+            current++;
+            continue;
+        }
+        const int idx = bucket.back();
+        bucket.pop_back();
+        queued--;
+        if (cost[idx] != current) continue; // queued again with a lower cost
+
+        const int q = idx % world.width;
+        const int r = idx / world.width;
+        if (on_edge(q, r)) {
+            edge_changed = std::min(edge_changed, current);
+        }
+        // the tiles around get here by stepping onto this one
+        const int next_cost = current + rx.costs.entering_cost(world, idx);
+        if (next_cost > rx.max_cost) continue;
+        for (const auto [dq, dr] : axial_directions) {
+            const int nq = wrap_q(q + dq);
+            const int nr = r + dr;
+            if (!inside(nq, nr)) continue;
+            const int other = nr * world.width + nq;
+            if (next_cost >= cost[other]) continue;
+            if (rx.costs.entering_cost(world, other) == Pathfinder::IMPASSABLE) continue;
+            cost[other] = next_cost;
+            buckets[next_cost % bucket_count].push_back(other);
+            queued++;
+        }
+    }
+    rx.edge_changed[chunk] = edge_changed;
+}
+
+// Once the costs are final, every tile points at the first neighbour it gets its cost from,
+// which keeps the field the same no matter in what order the chunks were relaxed
+void write_directions(const Relaxation& rx, int chunk, FlowField& field) {
+    const auto& world = rx.world;
+    const auto [origin, size] = world.chunk_bounds(chunk);
+    for (int r = origin.r; r < origin.r + size.second; r++) {
+        for (int q = origin.q; q < origin.q + size.first; q++) {
+            const int idx = r * world.width + q;
+            const int here = rx.cost[idx];
+            if (here == FlowField::NO_COST) {
+                field.directions[idx] = FlowField::UNREACHABLE;
+                continue;
+            }
+            if (here == 0) {
+                field.directions[idx] = FlowField::AT_TARGET;
+                continue;
+            }
+            for (uint8_t d = 0; d < axial_directions.size(); d++) {
+                const int other = world.wrapped_index(q + axial_directions[d][0], r + axial_directions[d][1]);
+                if (other == -1 || rx.cost[other] == FlowField::NO_COST) continue;
+                const int step = rx.costs.entering_cost(world, other);
+                if (step != Pathfinder::IMPASSABLE && rx.cost[other] + step == here) {
+                    field.directions[idx] = d;
+                    break;
+                }
+            }
+        }
+    }
+}
+} // namespace
+
+int FlowField::next_index(const CylinderHexWorld<HexData>& world, int idx) const {
+    const auto d = directions[idx];
+    if (d == UNREACHABLE) return -1;
+    if (d == AT_TARGET) return idx;
+    return world.wrapped_index(idx % world.width + axial_directions[d][0], idx / world.width + axial_directions[d][1]);
+}
+
+std::optional<HexCoords> FlowField::next_step(const CylinderHexWorld<HexData>& world, HexCoords from) const {
+    const int idx = world.wrapped_index(from.q, from.r);
+    if (idx == -1 || directions[idx] == UNREACHABLE) return {};
+    if (directions[idx] == AT_TARGET) return from;
+    const auto [dq, dr] = axial_directions[directions[idx]];
+    return from + HexCoords::from_axial(dq, dr);
+}
+
+bool FlowField::follow(const CylinderHexWorld<HexData>& world, HexCoords from, std::vector<HexCoords>& path) const {
+    path.clear();
+    auto at = next_step(world, from);
+    if (!at.has_value()) {
+        return false;
+    }
+    path.push_back(from);
+    // costs go down with every step, so this always gets somewhere
+    while (!(*at == path.back())) {
+        path.push_back(*at);
+        at = next_step(world, *at);
+    }
+    return true;
+}
+
+void FlowFieldGenerator::generate(const CylinderHexWorld<HexData>& world, std::span<const int> targets, int max_cost, FlowField& field) const {
+    const size_t tile_count = world.data.size();
+    field.width = world.width;
+    field.height = world.height;
+    field.max_cost = max_cost;
+    field.targets.assign(targets.begin(), targets.end());
+    std::sort(field.targets.begin(), field.targets.end());
+    field.targets.erase(std::unique(field.targets.begin(), field.targets.end()), field.targets.end());
+    field.costs.assign(tile_count, FlowField::NO_COST);
+    field.directions.assign(tile_count, FlowField::UNREACHABLE);
+    if (world.width <= 0 || world.height <= 0) {
+        return;
+    }
+
+    const int chunk_count = world.chunk_count();
+    Relaxation rx{
+        .world = world,
+        .costs = m_costs,
+        .max_cost = max_cost,
+        .cost = field.costs,
+        .pending = std::vector<std::vector<int>>(chunk_count),
+        .edge_changed = std::vector<int>(chunk_count, FlowField::NO_COST),
+        .offered = std::vector<int>(chunk_count, FlowField::NO_COST),
+        .reached = std::vector<uint8_t>(chunk_count, 0),
+    };
+    for (const int target : field.targets) {
+        if (target < 0 || static_cast<size_t>(target) >= tile_count) continue;
+        if (m_costs.entering_cost(world, target) == Pathfinder::IMPASSABLE) continue;
+        const int chunk = world.chunk_of_index(target);
+        field.costs[target] = 0;
+        rx.pending[chunk].push_back(target);
+        rx.offered[chunk] = 0;
+    }
+
+    std::vector<int> colours(chunk_count);
+    for (int c = 0; c < chunk_count; c++) {
+        colours[c] = chunk_colour(c % world.chunks_wide(), c / world.chunks_wide(), world.chunks_wide());
+    }
+    const int colour_count = *std::max_element(colours.begin(), colours.end()) + 1;
+
+    // The chunks of one colour are relaxed at once, then the chunks around the ones that changed are queued,
+    // and it's the next colour's turn, until nothing is queued. Only chunks that were offered costs close to
+    // the lowest one are taken, so that the wave spreads out mostly in the order of cost, like Dijkstra would,
+    // instead of chunks being relaxed over and over with costs that are not final yet
+    const int window = WORLD_CHUNK_SIZE * m_costs.max_step_cost() * WAVE_WINDOW_CHUNKS;
+    std::vector<int> work;
+    int colour = -1;
+    bool done = false;
+    const auto next_phase = [&]() {
+        for (const int chunk : work) {
+            const int edge_cost = rx.edge_changed[chunk];
+            if (edge_cost == FlowField::NO_COST) continue;
+            rx.edge_changed[chunk] = FlowField::NO_COST;
+            for (const int other : world.neighbour_chunks(chunk)) {
+                rx.offered[other] = std::min(rx.offered[other], edge_cost);
+            }
+        }
+        work.clear();
+        const int lowest = *std::min_element(rx.offered.begin(), rx.offered.end());
+        if (lowest == FlowField::NO_COST) {
+            done = true;
+            return;
+        }
+        const int limit = lowest > FlowField::NO_COST - window ? FlowField::NO_COST - 1 : lowest + window;
+        for (int tries = 0; tries < colour_count && work.empty(); tries++) {
+            colour = (colour + 1) % colour_count;
+            for (int c = 0; c < chunk_count; c++) {
+                if (rx.offered[c] <= limit && colours[c] == colour) {
+                    rx.offered[c] = FlowField::NO_COST;
+                    work.push_back(c);
+                }
+            }
+        }
+    };
+    const auto for_each = [&](int count, const auto& fn) {
+        if (m_jobs != nullptr && count >= 2 * MIN_CHUNKS_PER_JOB) {
+            m_jobs->parallel_for(0, count, MIN_CHUNKS_PER_JOB, fn);
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            fn(i);
+        }
+    };
+
+    next_phase();
+    while (!done) {
+        for_each(static_cast<int>(work.size()), [&](int i) { relax_chunk(rx, work[i]); });
+        next_phase();
+    }
+    for_each(chunk_count, [&](int chunk) {
+        if (rx.reached[chunk]) {
+            write_directions(rx, chunk, field);
+        }
+    });
+}
+
+std::shared_ptr<const FlowField> FlowFieldCache::get(const CylinderHexWorld<HexData>& world, std::span<const HexCoords> targets, int max_cost) {
+    std::vector<int> key;
+    for (const auto hc : targets) {
+        const int idx = world.wrapped_index(hc.q, hc.r);
+        if (idx != -1) {
+            key.push_back(idx);
+        }
+    }
+    std::sort(key.begin(), key.end());
+    key.erase(std::unique(key.begin(), key.end()), key.end());
+    m_clock++;
+
+    for (auto& entry : m_entries) {
+        auto& field = *entry.field;
+        if (field.targets != key || field.max_cost != max_cost) continue;
+        entry.last_used = m_clock;
+        if (entry.stale || field.width != world.width || field.height != world.height) {
+            // somebody may still be walking the old one
+            if (entry.field.use_count() > 1) {
+                entry.field = std::make_shared<FlowField>();
+            }
+            m_generator.generate(world, key, max_cost, *entry.field);
+            entry.stale = false;
+        }
+        return entry.field;
+    }
+
+    auto field = std::make_shared<FlowField>();
+    m_generator.generate(world, key, max_cost, *field);
+    if (m_entries.size() < m_capacity) {
+        m_entries.push_back(Entry{.field = field, .last_used = m_clock});
+    } else if (!m_entries.empty()) {
+        auto oldest = std::min_element(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+        *oldest = Entry{.field = field, .last_used = m_clock};
+    }
+    return field;
+}
+
+void FlowFieldCache::mark_changed(const CylinderHexWorld<HexData>& world, HexCoords hc) {
+    const int idx = world.wrapped_index(hc.q, hc.r);
+    if (idx == -1) {
+        return;
+    }
+    const auto hex = world.coords_of_index(idx);
+    for (auto& entry : m_entries) {
+        const auto& field = *entry.field;
+        if (entry.stale || field.width != world.width || field.height != world.height) continue;
+        // a tile that neither the field nor its neighbours reach can't change anything, unless it's a target
+        bool affected = field.reachable(idx) || std::binary_search(field.targets.begin(), field.targets.end(), idx);
+        for (const auto [dq, dr] : axial_directions) {
+            const int other = world.wrapped_index(hex.q + dq, hex.r + dr);
+            affected = affected || (other != -1 && field.reachable(other));
+        }
+        entry.stale = affected;
+    }
+}
@@ -0,0 +1,42 @@
+#include "frame_arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t initial_size) {
+    add_block(initial_size);
+}
+
+void FrameArena::add_block(size_t size) {
+    m_blocks.push_back(Block{std::make_unique_for_overwrite<std::byte[]>(size), size});
+    m_offset = 0;
+    m_stats.capacity += size;
+    m_stats.blocks = static_cast<int>(m_blocks.size());
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    auto& block = m_blocks.back();
+    const auto base = reinterpret_cast<uintptr_t>(block.data.get());
+    size_t start = ((base + m_offset + alignment - 1) & ~(alignment - 1)) - base;
+    if (start + bytes > block.size) {
+        // at least doubling, so that a frame that needs a lot doesn't end up with many small blocks
+        add_block(std::max(m_blocks.back().size * 2, bytes + alignment));
+        const auto new_base = reinterpret_cast<uintptr_t>(m_blocks.back().data.get());
+        start = ((new_base + alignment - 1) & ~(alignment - 1)) - new_base;
+    }
+    m_stats.used += bytes + (start - std::min(start, m_offset));
+    m_offset = start + bytes;
+    return m_blocks.back().data.get() + start;
+}
+
+void FrameArena::reset() {
+    m_stats.last_frame = m_stats.used;
+    m_stats.peak = std::max(m_stats.peak, m_stats.used);
+    m_stats.used = 0;
+    m_offset = 0;
+    if (m_blocks.size() > 1) {
+        const size_t total = m_stats.capacity;
+        m_blocks.clear();
+        m_stats.capacity = 0;
+        add_block(total);
+    }
+}
@@ -1,5 +1,6 @@
 #include "hex.hpp"
 #include <algorithm>
+#include <cmath>
 
 HexCoords operator "" _LU (unsigned long long x) { int v = x; return HexCoords{0, -v, +v}; };
 HexCoords operator "" _RU (unsigned long long x) { int v = x; return HexCoords{+v, -v, 0}; };
@@ -56,35 +57,22 @@ std::array<HexCoords, 6> HexCoords::neighbours() const {
 }
 
 std::vector<HexCoords> HexCoords::ring_around(int range) const {
-    if (range == 0) return {};    
+    const auto hexes = ring(range);
     std::vector<HexCoords> result;
-    result.reserve(range * 6);
-    for(int i = 0; i < range; i++) {
-        result.push_back(*this + hexLD(range) + hexR(i));
-        result.push_back(*this + hexRD(range) + hexRU(i));
-        result.push_back(*this + hexR(range) + hexLU(i));
-        result.push_back(*this + hexRU(range) + hexL(i));
-        result.push_back(*this + hexLU(range) + hexLD(i));
-        result.push_back(*this + hexL(range) + hexRD(i));
+    result.reserve(hexes.size());
+    for (const auto hc : hexes) {
+        result.push_back(hc);
     }
     return result;
 }
 
 std::vector<HexCoords> HexCoords::spiral_around(int range) const {
-    if (range == 0) return {};    
+    const auto hexes = spiral(range);
     std::vector<HexCoords> result;
-    result.reserve(1 + 3 * range * (range-1));
-    result.push_back(*this);
-    for(int r = 1; r <= range; r++) {
-        for(int i = 0; i < range; i++) {
-            result.push_back(*this + hexLD(r) + hexR(i));
-            result.push_back(*this + hexRD(r) + hexRU(i));
-            result.push_back(*this + hexR(r) + hexLU(i));
-            result.push_back(*this + hexRU(r) + hexL(i));
-            result.push_back(*this + hexLU(r) + hexLD(i));
-            result.push_back(*this + hexL(r) + hexRD(i));
-        }
-    } 
+    result.reserve(hexes.size());
+    for (const auto hc : hexes) {
+        result.push_back(hc);
+    }
     return result;
 }
 
@@ -101,15 +89,16 @@ std::pair<float, float> HexCoords::to_world_unscaled () const {
 }
 
 HexCoords HexCoords::rounded_to_hex(float q, float r, float s) {
-    auto rq = round(q);
-    auto rr = round(r);
-    auto rs = round(s);
-    const auto dq = abs(q - rq);
-    const auto dr = abs(r - rr);
-    const auto ds = abs(s - rs);
+    // std:: ones, the plain abs here is the int overload, which truncates the errors to 0
+    auto rq = std::round(q);
+    auto rr = std::round(r);
+    auto rs = std::round(s);
+    const auto dq = std::fabs(q - rq);
+    const auto dr = std::fabs(r - rr);
+    const auto ds = std::fabs(s - rs);
     if (dq > dr && dq > ds) {
         rq = -rr-rs;
-    } else if (dr > rs) {
+    } else if (dr > ds) {
         rr = -rq-rs;
     } else {
         rs = -rq-rr;
@@ -125,16 +114,11 @@ HexCoords HexCoords::from_world_unscaled(float x, float y) {
 }
 
 std::vector<HexCoords> HexCoords::make_line(const HexCoords from, const HexCoords to) {
-    const float steps = from.distance(to) + 1;
-    const auto isteps = 1.0f/steps;
-    const auto [sx, sy] = from.to_world_unscaled();
-    const auto [ex, ey] = to.to_world_unscaled();
-    const auto dx = ex-sx;
-    const auto dy = ey-sy;
+    const auto hexes = line(from, to);
     std::vector<HexCoords> result;
-    result.reserve(steps);
-    for(int i = 0; i < steps; i++) {
-        result.push_back(HexCoords::from_world_unscaled(sx + dx*isteps*i, sy+dy*isteps*i));
+    result.reserve(hexes.size());
+    for (const auto hc : hexes) {
+        result.push_back(hc);
     }
     return result;
-}
\ No newline at end of file
+}
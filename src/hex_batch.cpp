@@ -0,0 +1,236 @@
+#include "hex_batch.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define HEX_BATCH_SSE2 1
+#include <emmintrin.h>
+#endif
+// the AVX2 kernel is compiled with a target attribute, so that the rest of the program doesn't need AVX2
+#if HEX_BATCH_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#define HEX_BATCH_AVX2 1
+#include <immintrin.h>
+#endif
+
+// None of the kernels may fuse multiplies and adds - the scalar code doesn't, and the results have to match it.
+// So the AVX2 kernel is built for "avx2" alone, not "avx2,fma".
+
+namespace {
+// same constants, in the same order of operations, as HexCoords::from_world_unscaled and to_world_unscaled
+constexpr float Q_FROM_X = sqrt3 / 3.0f;
+constexpr float R_FROM_Y = 2.0f / 3.0f;
+constexpr float X_FROM_R = sqrt3 / 2.0f;
+constexpr float Y_FROM_R = 1.5f;
+
+void from_world_scalar(const float* xs, const float* ys, HexCoords* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = HexCoords::from_world_unscaled(xs[i], ys[i]);
+    }
+}
+
+void to_world_scalar(const HexCoords* hexes, float* xs, float* ys, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const auto [x, y] = hexes[i].to_world_unscaled();
+        xs[i] = x;
+        ys[i] = y;
+    }
+}
+
+#if HEX_BATCH_SSE2
+// round() rounds halves away from zero, which SSE has no instruction for - truncate, and step away
+// from zero when at least half was cut off. x - trunc(x) is exact, so this is the same as round()
+inline __m128 round_half_away_sse2(__m128 v) {
+    const __m128 sign_bit = _mm_set1_ps(-0.0f);
+    const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    const __m128 cut_off = _mm_andnot_ps(sign_bit, _mm_sub_ps(v, truncated));
+    const __m128 away = _mm_or_ps(_mm_and_ps(v, sign_bit), _mm_set1_ps(1.0f));
+    return _mm_add_ps(truncated, _mm_and_ps(_mm_cmpge_ps(cut_off, _mm_set1_ps(0.5f)), away));
+}
+
+inline __m128 select_sse2(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+void from_world_sse2(const float* xs, const float* ys, HexCoords* out, size_t count) {
+    const __m128 sign_bit = _mm_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(xs + i);
+        const __m128 y = _mm_loadu_ps(ys + i);
+        const __m128 q = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(Q_FROM_X), x), _mm_div_ps(y, _mm_set1_ps(3.0f)));
+        const __m128 r = _mm_mul_ps(_mm_set1_ps(R_FROM_Y), y);
+        const __m128 s = _mm_sub_ps(_mm_xor_ps(q, sign_bit), r);
+
+        // the same as rounded_to_hex - the component that was rounded the most is recomputed from the other two
+        const __m128 rq = round_half_away_sse2(q);
+        const __m128 rr = round_half_away_sse2(r);
+        const __m128 rs = round_half_away_sse2(s);
+        const __m128 dq = _mm_andnot_ps(sign_bit, _mm_sub_ps(q, rq));
+        const __m128 dr = _mm_andnot_ps(sign_bit, _mm_sub_ps(r, rr));
+        const __m128 ds = _mm_andnot_ps(sign_bit, _mm_sub_ps(s, rs));
+        const __m128 fix_q = _mm_and_ps(_mm_cmpgt_ps(dq, dr), _mm_cmpgt_ps(dq, ds));
+        const __m128 fix_r = _mm_andnot_ps(fix_q, _mm_cmpgt_ps(dr, ds));
+        const __m128 fix_s = _mm_andnot_ps(_mm_or_ps(fix_q, fix_r), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+        alignas(16) int qs[4], rs_[4], ss[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(qs), _mm_cvttps_epi32(select_sse2(fix_q, _mm_sub_ps(_mm_xor_ps(rr, sign_bit), rs), rq)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(rs_), _mm_cvttps_epi32(select_sse2(fix_r, _mm_sub_ps(_mm_xor_ps(rq, sign_bit), rs), rr)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(ss), _mm_cvttps_epi32(select_sse2(fix_s, _mm_sub_ps(_mm_xor_ps(rq, sign_bit), rr), rs)));
+        for (int k = 0; k < 4; k++) {
+            out[i + k] = HexCoords{qs[k], rs_[k], ss[k]};
+        }
+    }
+    from_world_scalar(xs + i, ys + i, out + i, count - i);
+}
+
+void to_world_sse2(const HexCoords* hexes, float* xs, float* ys, size_t count) {
+    // written out plainly, the compiler turns this into better SSE2 than building the q and r vectors by hand
+    for (size_t i = 0; i < count; i++) {
+        const float q = static_cast<float>(hexes[i].q);
+        const float r = static_cast<float>(hexes[i].r);
+        xs[i] = sqrt3 * q + X_FROM_R * r;
+        ys[i] = Y_FROM_R * r;
+    }
+}
+#endif
+
+#if HEX_BATCH_AVX2
+#define HEX_BATCH_TARGET_AVX2 __attribute__((target("avx2")))
+
+HEX_BATCH_TARGET_AVX2 inline __m256 round_half_away_avx2(__m256 v) {
+    const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+    const __m256 truncated = _mm256_round_ps(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256 cut_off = _mm256_andnot_ps(sign_bit, _mm256_sub_ps(v, truncated));
+    const __m256 away = _mm256_or_ps(_mm256_and_ps(v, sign_bit), _mm256_set1_ps(1.0f));
+    return _mm256_add_ps(truncated, _mm256_and_ps(_mm256_cmp_ps(cut_off, _mm256_set1_ps(0.5f), _CMP_GE_OQ), away));
+}
+
+HEX_BATCH_TARGET_AVX2 void from_world_avx2(const float* xs, const float* ys, HexCoords* out, size_t count) {
+    const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(xs + i);
+        const __m256 y = _mm256_loadu_ps(ys + i);
+        const __m256 q = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(Q_FROM_X), x), _mm256_div_ps(y, _mm256_set1_ps(3.0f)));
+        const __m256 r = _mm256_mul_ps(_mm256_set1_ps(R_FROM_Y), y);
+        const __m256 s = _mm256_sub_ps(_mm256_xor_ps(q, sign_bit), r);
+
+        const __m256 rq = round_half_away_avx2(q);
+        const __m256 rr = round_half_away_avx2(r);
+        const __m256 rs = round_half_away_avx2(s);
+        const __m256 dq = _mm256_andnot_ps(sign_bit, _mm256_sub_ps(q, rq));
+        const __m256 dr = _mm256_andnot_ps(sign_bit, _mm256_sub_ps(r, rr));
+        const __m256 ds = _mm256_andnot_ps(sign_bit, _mm256_sub_ps(s, rs));
+        const __m256 fix_q = _mm256_and_ps(_mm256_cmp_ps(dq, dr, _CMP_GT_OQ), _mm256_cmp_ps(dq, ds, _CMP_GT_OQ));
+        const __m256 fix_r = _mm256_andnot_ps(fix_q, _mm256_cmp_ps(dr, ds, _CMP_GT_OQ));
+        const __m256 fix_s = _mm256_andnot_ps(_mm256_or_ps(fix_q, fix_r), _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+
+        alignas(32) int qs[8], rs_[8], ss[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(qs), _mm256_cvttps_epi32(_mm256_blendv_ps(rq, _mm256_sub_ps(_mm256_xor_ps(rr, sign_bit), rs), fix_q)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(rs_), _mm256_cvttps_epi32(_mm256_blendv_ps(rr, _mm256_sub_ps(_mm256_xor_ps(rq, sign_bit), rs), fix_r)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(ss), _mm256_cvttps_epi32(_mm256_blendv_ps(rs, _mm256_sub_ps(_mm256_xor_ps(rq, sign_bit), rr), fix_s)));
+        for (int k = 0; k < 8; k++) {
+            out[i + k] = HexCoords{qs[k], rs_[k], ss[k]};
+        }
+    }
+    from_world_sse2(xs + i, ys + i, out + i, count - i);
+}
+
+HEX_BATCH_TARGET_AVX2 void to_world_avx2(const HexCoords* hexes, float* xs, float* ys, size_t count) {
+    // the hexes are 3 ints apart, gather the q and r columns
+    const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const int* base = &hexes[i].q;
+        const __m256 q = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(base, stride, 4));
+        const __m256 r = _mm256_cvtepi32_ps(_mm256_i32gather_epi32(base + 1, stride, 4));
+        _mm256_storeu_ps(xs + i, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(sqrt3), q), _mm256_mul_ps(_mm256_set1_ps(X_FROM_R), r)));
+        _mm256_storeu_ps(ys + i, _mm256_mul_ps(_mm256_set1_ps(Y_FROM_R), r));
+    }
+    to_world_sse2(hexes + i, xs + i, ys + i, count - i);
+}
+#endif
+
+bool supported(HexBatchKernel kernel) {
+    switch (kernel) {
+        case HexBatchKernel::Scalar:
+            return true;
+        case HexBatchKernel::SSE2:
+#if HEX_BATCH_SSE2
+            return true;
+#else
+            return false;
+#endif
+        case HexBatchKernel::AVX2:
+#if HEX_BATCH_AVX2
+            // this runs before main, when the cpu info might not be filled in yet
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+HexBatchKernel best_kernel() {
+    for (const auto kernel : {HexBatchKernel::AVX2, HexBatchKernel::SSE2}) {
+        if (supported(kernel)) {
+            return kernel;
+        }
+    }
+    return HexBatchKernel::Scalar;
+}
+
+HexBatchKernel current_kernel = best_kernel();
+} // namespace
+
+void hexes_from_world_unscaled(std::span<const float> xs, std::span<const float> ys, std::span<HexCoords> out) {
+    const size_t count = std::min({xs.size(), ys.size(), out.size()});
+    switch (current_kernel) {
+#if HEX_BATCH_AVX2
+        case HexBatchKernel::AVX2:
+            return from_world_avx2(xs.data(), ys.data(), out.data(), count);
+#endif
+#if HEX_BATCH_SSE2
+        case HexBatchKernel::SSE2:
+            return from_world_sse2(xs.data(), ys.data(), out.data(), count);
+#endif
+        default:
+            return from_world_scalar(xs.data(), ys.data(), out.data(), count);
+    }
+}
+
+void hexes_to_world_unscaled(std::span<const HexCoords> hexes, std::span<float> xs, std::span<float> ys) {
+    const size_t count = std::min({hexes.size(), xs.size(), ys.size()});
+    switch (current_kernel) {
+#if HEX_BATCH_AVX2
+        case HexBatchKernel::AVX2:
+            return to_world_avx2(hexes.data(), xs.data(), ys.data(), count);
+#endif
+#if HEX_BATCH_SSE2
+        case HexBatchKernel::SSE2:
+            return to_world_sse2(hexes.data(), xs.data(), ys.data(), count);
+#endif
+        default:
+            return to_world_scalar(hexes.data(), xs.data(), ys.data(), count);
+    }
+}
+
+HexBatchKernel hex_batch_kernel() {
+    return current_kernel;
+}
+
+HexBatchKernel set_hex_batch_kernel(HexBatchKernel kernel) {
+    if (supported(kernel)) {
+        current_kernel = kernel;
+    }
+    return current_kernel;
+}
+
+const char* hex_batch_kernel_name(HexBatchKernel kernel) {
+    switch (kernel) {
+        case HexBatchKernel::Scalar: return "scalar";
+        case HexBatchKernel::SSE2: return "sse2";
+        case HexBatchKernel::AVX2: return "avx2";
+    }
+    return "unknown";
+}
@@ -0,0 +1,343 @@
+#include "hierarchical_pathfinding.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace {
+SearchScratch& abstract_scratch() {
+    thread_local SearchScratch scratch;
+    return scratch;
+}
+
+uint64_t border_key(int a, int b) {
+    const auto lo = static_cast<uint64_t>(std::min(a, b));
+    const auto hi = static_cast<uint64_t>(std::max(a, b));
+    return (lo << 32) | hi;
+}
+
+// runs of border transitions longer than this get entrances at both ends, not only in the middle
+constexpr size_t LONG_ENTRANCE = 8;
+} // namespace
+
+void HierarchicalPathfinder::rebuild(const CylinderHexWorld<HexData>& world) {
+    m_width = world.width;
+    m_height = world.height;
+    m_clusters.assign(world.chunk_count(), Cluster{});
+    m_entrance_slot.assign(world.data.size(), -1);
+    m_borders.clear();
+    update(world);
+}
+
+void HierarchicalPathfinder::mark_changed(const CylinderHexWorld<HexData>& world, HexCoords hc) {
+    if (world.width != m_width || world.height != m_height) {
+        return; // the next update rebuilds everything anyway
+    }
+    const int idx = world.wrapped_index(hc.q, hc.r);
+    if (idx == -1) {
+        return;
+    }
+    m_clusters[world.chunk_of_index(idx)].dirty = true;
+}
+
+void HierarchicalPathfinder::update(const CylinderHexWorld<HexData>& world) {
+    if (world.width != m_width || world.height != m_height || m_clusters.size() != static_cast<size_t>(world.chunk_count())) {
+        m_width = world.width;
+        m_height = world.height;
+        m_clusters.assign(world.chunk_count(), Cluster{});
+        m_entrance_slot.assign(world.data.size(), -1);
+        m_borders.clear();
+    }
+
+    // a changed cluster changes the entrances on all of its borders,
+    // so the clusters on the other side need their distances redone as well
+    std::vector<char> affected(m_clusters.size(), 0);
+    bool any = false;
+    for (size_t c = 0; c < m_clusters.size(); c++) {
+        if (!m_clusters[c].dirty) continue;
+        any = true;
+        affected[c] = 1;
+        for (const auto other : world.neighbour_chunks(c)) {
+            rebuild_border(world, c, other);
+            affected[other] = 1;
+        }
+    }
+    if (!any) {
+        return;
+    }
+    for (size_t c = 0; c < m_clusters.size(); c++) {
+        if (!affected[c]) continue;
+        collect_entrances(world, c);
+        rebuild_distances(world, c);
+        m_clusters[c].dirty = false;
+    }
+}
+
+void HierarchicalPathfinder::rebuild_border(const CylinderHexWorld<HexData>& world, int a, int b) {
+    const int lo = std::min(a, b);
+    const int hi = std::max(a, b);
+    const auto passable = [&](int idx) { return m_low_level.entering_cost(world, idx) != Pathfinder::IMPASSABLE; };
+
+    // every walkable step from lo to hi, in the scan order of lo, so neighbouring steps end up next to each other
+    std::vector<std::pair<int, int>> transitions;
+    const auto [origin, size] = world.chunk_bounds(lo);
+    const auto [chunk_width, chunk_height] = size;
+    for (int r = origin.r; r < origin.r + chunk_height; r++) {
+        for (int q = origin.q; q < origin.q + chunk_width; q++) {
+            const bool on_edge = q == origin.q || q == origin.q + chunk_width - 1 || r == origin.r || r == origin.r + chunk_height - 1;
+            if (!on_edge) continue;
+            const int from = r * world.width + q;
+            if (!passable(from)) continue;
+            for (const auto [dq, dr] : axial_directions) {
+                const int to = world.wrapped_index(q + dq, r + dr);
+                if (to == -1 || world.chunk_of_index(to) != hi || !passable(to)) continue;
+                transitions.emplace_back(from, to);
+            }
+        }
+    }
+
+    auto& entrances = m_borders[border_key(lo, hi)];
+    entrances.clear();
+    // one tile can step over in two directions, so only the side in lo decides where a stretch ends
+    const auto close = [&](int x, int y) { return world.wrapped_distance(world.coords_of_index(x), world.coords_of_index(y)) <= 1; };
+    size_t run_start = 0;
+    for (size_t i = 1; i <= transitions.size(); i++) {
+        const bool run_continues = i < transitions.size() && close(transitions[i].first, transitions[i - 1].first);
+        if (run_continues) continue;
+        const size_t length = i - run_start;
+        if (length > 0) {
+            if (length >= LONG_ENTRANCE) {
+                entrances.push_back(transitions[run_start]);
+                entrances.push_back(transitions[i - 1]);
+            } else {
+                entrances.push_back(transitions[run_start + length / 2]);
+            }
+        }
+        run_start = i;
+    }
+}
+
+void HierarchicalPathfinder::collect_entrances(const CylinderHexWorld<HexData>& world, int cluster) {
+    auto& cl = m_clusters[cluster];
+    for (const auto idx : cl.entrances) {
+        m_entrance_slot[idx] = -1;
+    }
+    cl.entrances.clear();
+    for (const auto other : world.neighbour_chunks(cluster)) {
+        const auto* border = m_borders.find(border_key(cluster, other));
+        if (border == nullptr) continue;
+        for (const auto& [lo_tile, hi_tile] : *border) {
+            const int mine = cluster < other ? lo_tile : hi_tile;
+            if (m_entrance_slot[mine] == -1) {
+                m_entrance_slot[mine] = static_cast<int>(cl.entrances.size());
+                cl.entrances.push_back(mine);
+            }
+        }
+    }
+}
+
+std::vector<int> HierarchicalPathfinder::costs_within_cluster(const CylinderHexWorld<HexData>& world, int cluster, int from, bool reverse) const {
+    // chunks never wrap inside, so the search can stay in local coordinates of the chunk
+    const auto bounds = world.chunk_bounds(cluster);
+    const HexCoords origin = bounds.first;
+    const int cw = bounds.second.first;
+    const int ch = bounds.second.second;
+    const auto local_of = [&](int idx) {
+        const auto hc = world.coords_of_index(idx);
+        return (hc.r - origin.r) * cw + (hc.q - origin.q);
+    };
+    const auto world_of = [&](int lq, int lr) { return (origin.r + lr) * world.width + origin.q + lq; };
+
+    thread_local std::vector<int> dist;
+    dist.assign(cw * ch, -1);
+    // a heap on a vector of our own rather than a priority_queue, so that the vector keeps its capacity between searches
+    using Item = std::pair<int, int>;
+    thread_local std::vector<Item> open;
+    open.clear();
+    const auto push = [&](Item item) {
+        open.push_back(item);
+        std::push_heap(open.begin(), open.end(), std::greater<Item>{});
+    };
+    dist[local_of(from)] = 0;
+    push({0, local_of(from)});
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), std::greater<Item>{});
+        const auto [d, local] = open.back();
+        open.pop_back();
+        if (d > dist[local]) continue;
+        const int lq = local % cw;
+        const int lr = local / cw;
+        const int here_cost = m_low_level.entering_cost(world, world_of(lq, lr));
+        for (const auto [dq, dr] : axial_directions) {
+            const int nq = lq + dq;
+            const int nr = lr + dr;
+            if (nq < 0 || nq >= cw || nr < 0 || nr >= ch) continue;
+            const int next_cost = m_low_level.entering_cost(world, world_of(nq, nr));
+            if (next_cost == Pathfinder::IMPASSABLE) continue;
+            // going backwards, the step from next onto this tile is the one that's paid for
+            const int step = reverse ? here_cost : next_cost;
+            const int next_local = nr * cw + nq;
+            if (dist[next_local] == -1 || d + step < dist[next_local]) {
+                dist[next_local] = d + step;
+                push({d + step, next_local});
+            }
+        }
+    }
+
+    const auto& entrances = m_clusters[cluster].entrances;
+    std::vector<int> result(entrances.size());
+    for (size_t i = 0; i < entrances.size(); i++) {
+        result[i] = dist[local_of(entrances[i])];
+    }
+    return result;
+}
+
+void HierarchicalPathfinder::rebuild_distances(const CylinderHexWorld<HexData>& world, int cluster) {
+    auto& cl = m_clusters[cluster];
+    const size_t k = cl.entrances.size();
+    cl.distances.assign(k * k, -1);
+    for (size_t i = 0; i < k; i++) {
+        const auto row = costs_within_cluster(world, cluster, cl.entrances[i], false);
+        std::copy(row.begin(), row.end(), cl.distances.begin() + i * k);
+    }
+}
+
+size_t HierarchicalPathfinder::entrance_count() const {
+    size_t count = 0;
+    for (const auto& cl : m_clusters) {
+        count += cl.entrances.size();
+    }
+    return count;
+}
+
+PathResult HierarchicalPathfinder::find_abstract_path(const CylinderHexWorld<HexData>& world, HexCoords from, HexCoords to, std::vector<HexCoords>& waypoints) {
+    PathResult result;
+    waypoints.clear();
+    if (world.width <= 0) {
+        return result;
+    }
+    update(world);
+    const int start = world.wrapped_index(from.q, from.r);
+    const int goal = world.wrapped_index(to.q, to.r);
+    if (start == -1 || goal == -1) {
+        return result;
+    }
+
+    if (world.wrapped_distance(from, to) <= DIRECT_SEARCH_CHUNKS * WORLD_CHUNK_SIZE) {
+        // close enough that the abstraction would not help
+        thread_local std::vector<HexCoords> direct;
+        result = m_low_level.find_path(world, from, to, direct);
+        if (result.found) {
+            waypoints.push_back(direct.front());
+            waypoints.push_back(direct.back());
+        }
+        return result;
+    }
+    if (m_low_level.entering_cost(world, goal) == Pathfinder::IMPASSABLE) {
+        return result;
+    }
+
+    const int start_cluster = world.chunk_of_index(start);
+    const int goal_cluster = world.chunk_of_index(goal);
+    const auto start_costs = costs_within_cluster(world, start_cluster, start, false);
+    const auto goal_costs = costs_within_cluster(world, goal_cluster, goal, true);
+    const auto goal_coords = world.coords_of_index(goal);
+
+    auto& scratch = abstract_scratch();
+    scratch.begin(world.data.size());
+    const auto relax = [&](int node, int cost, int via) {
+        if (scratch.touched(node) && scratch.cost[node] <= cost) return;
+        scratch.touch(node, cost, via);
+        scratch.open.push_or_update(node, cost + m_low_level.heuristic(world, world.coords_of_index(node), goal_coords));
+    };
+    relax(start, 0, -1);
+
+    while (!scratch.open.empty()) {
+        const int current = scratch.open.pop();
+        result.expanded++;
+        if (current == goal) {
+            result.found = true;
+            break;
+        }
+        const int cost = scratch.cost[current];
+        if (current == start) {
+            const auto& entrances = m_clusters[start_cluster].entrances;
+            for (size_t i = 0; i < entrances.size(); i++) {
+                if (start_costs[i] >= 0) relax(entrances[i], cost + start_costs[i], current);
+            }
+        }
+        const int slot = m_entrance_slot[current];
+        if (slot == -1) continue;
+
+        const int cluster = world.chunk_of_index(current);
+        const auto& cl = m_clusters[cluster];
+        const size_t k = cl.entrances.size();
+        for (size_t j = 0; j < k; j++) {
+            const int d = cl.distances[slot * k + j];
+            if (d > 0) relax(cl.entrances[j], cost + d, current);
+        }
+        const auto hc = world.coords_of_index(current);
+        for (const auto [dq, dr] : axial_directions) {
+            const int next = world.wrapped_index(hc.q + dq, hc.r + dr);
+            if (next == -1 || m_entrance_slot[next] == -1 || world.chunk_of_index(next) == cluster) continue;
+            relax(next, cost + m_low_level.entering_cost(world, next), current);
+        }
+        if (cluster == goal_cluster && goal_costs[slot] >= 0) {
+            relax(goal, cost + goal_costs[slot], current);
+        }
+    }
+
+    if (!result.found) {
+        return result;
+    }
+    result.cost = scratch.cost[goal];
+    for (int at = goal; at != -1; at = scratch.came_from[at]) {
+        waypoints.push_back(world.coords_of_index(at));
+    }
+    std::reverse(waypoints.begin(), waypoints.end());
+    // waypoints are far apart, so take whichever copy in q is closer to the previous one
+    auto previous = waypoints.front();
+    waypoints.front() = from;
+    for (size_t i = 1; i < waypoints.size(); i++) {
+        const auto current = waypoints[i];
+        int dq = positive_modulo(current.q - previous.q, world.width);
+        if (dq > world.width / 2) dq -= world.width;
+        waypoints[i] = waypoints[i - 1] + HexCoords::from_axial(dq, current.r - previous.r);
+        previous = current;
+    }
+    return result;
+}
+
+PathResult HierarchicalPathfinder::refine_segment(
+    const CylinderHexWorld<HexData>& world, const std::vector<HexCoords>& waypoints, size_t segment,
+    std::vector<HexCoords>& path, const PathOptions& options
+) const {
+    return m_low_level.find_path(world, waypoints.at(segment), waypoints.at(segment + 1), path, options);
+}
+
+PathResult HierarchicalPathfinder::find_path(
+    const CylinderHexWorld<HexData>& world, HexCoords from, HexCoords to,
+    std::vector<HexCoords>& path, const PathOptions& options
+) {
+    thread_local std::vector<HexCoords> waypoints;
+    thread_local std::vector<HexCoords> segment;
+    path.clear();
+    auto result = find_abstract_path(world, from, to, waypoints);
+    if (!result.found) {
+        return result;
+    }
+    result.cost = 0;
+    for (size_t i = 0; i + 1 < waypoints.size(); i++) {
+        const auto part = refine_segment(world, waypoints, i, segment, options);
+        result.expanded += part.expanded;
+        if (!part.found) {
+            path.clear();
+            result.found = false;
+            return result;
+        }
+        result.cost += part.cost;
+        path.insert(path.end(), segment.begin() + (path.empty() ? 0 : 1), segment.end());
+    }
+    if (path.empty()) {
+        path.push_back(from); // from and to are the same hex
+    }
+    return result;
+}
@@ -0,0 +1,236 @@
+#include "job_system.hpp"
+#include <cstdlib>
+#include <string>
+#include "profiler.hpp"
+
+namespace {
+// which pool the current thread works for, and which queue is its own
+thread_local const JobSystem* t_system = nullptr;
+thread_local int t_queue = -1;
+} // namespace
+
+JobSystem::JobSystem(int workers) {
+    if (workers <= 0) {
+        workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    }
+    for (int i = 0; i <= workers; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < workers; i++) {
+        m_workers.emplace_back([this, i] { work(i); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock(m_sleep_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+int JobSystem::workers_from_environment() {
+    const char* value = std::getenv("STRATGAME_THREADS");
+    if (value == nullptr) {
+        return 0;
+    }
+    try {
+        return std::max(0, std::stoi(value));
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+int JobSystem::queue_index() const {
+    return t_system == this ? t_queue : static_cast<int>(m_workers.size());
+}
+
+JobSystem::Handle JobSystem::submit(std::function<void()> fn, std::initializer_list<Handle> after) {
+    return submit(std::move(fn), std::vector<Handle>(after));
+}
+
+JobSystem::Handle JobSystem::submit(std::function<void()> fn, const std::vector<Handle>& after) {
+    return submit(std::move(fn), after, false);
+}
+
+JobSystem::Handle JobSystem::submit_long(std::function<void()> fn, const std::vector<Handle>& after) {
+    return submit(std::move(fn), after, true);
+}
+
+JobSystem::Handle JobSystem::submit(std::function<void()> fn, const std::vector<Handle>& after, bool long_running) {
+    auto job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+    job->long_running = long_running;
+    for (const auto& dependency : after) {
+        if (!dependency) continue;
+        std::lock_guard lock(dependency->mutex);
+        if (!dependency->done) {
+            job->waiting_for++;
+            dependency->continuations.push_back(job);
+        }
+    }
+    // the dependencies may have finished meanwhile, then this is the last one
+    if (--job->waiting_for == 0) {
+        schedule(job);
+    }
+    return job;
+}
+
+void JobSystem::schedule(Handle job) {
+    auto& queue = job->long_running ? m_long_queue : *m_queues[queue_index()];
+    // counted before it's there, so that the count never goes below zero
+    (job->long_running ? m_long_queued : m_queued)++;
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    // taking the lock makes sure a worker that just found nothing is either asleep already, or sees the job
+    { std::lock_guard lock(m_sleep_mutex); }
+    m_wake.notify_one();
+}
+
+bool JobSystem::run_one(bool take_long) {
+    const int own = queue_index();
+    Handle job;
+    {
+        auto& queue = *m_queues[own];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+    }
+    // a long job before stealing, there are fewer of them, and they'd hold up whatever waits for them the most
+    if (!job && take_long && m_long_queued.load() > 0) {
+        std::lock_guard lock(m_long_queue.mutex);
+        if (!m_long_queue.jobs.empty()) {
+            job = std::move(m_long_queue.jobs.front());
+            m_long_queue.jobs.pop_front();
+        }
+    }
+    // stealing the oldest jobs of the others, starting from the next queue, so that not everyone goes after the same one
+    const int queue_count = static_cast<int>(m_queues.size());
+    for (int i = 1; i < queue_count && !job; i++) {
+        auto& queue = *m_queues[(own + i) % queue_count];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+    }
+    if (!job) {
+        return false;
+    }
+    (job->long_running ? m_long_queued : m_queued)--;
+    run(std::move(job));
+    return true;
+}
+
+void JobSystem::run(Handle job) {
+    {
+        PROFILE_ZONE("job");
+        try {
+            job->fn();
+        } catch (...) {
+            job->error = std::current_exception();
+        }
+    }
+    // whatever it captured goes away now, not when the last handle does
+    job->fn = nullptr;
+
+    std::vector<Handle> continuations;
+    {
+        std::lock_guard lock(job->mutex);
+        job->done = true;
+        std::swap(continuations, job->continuations);
+    }
+    job->finished.store(true);
+    for (auto& next : continuations) {
+        if (--next->waiting_for == 0) {
+            schedule(std::move(next));
+        }
+    }
+    wake_waiters();
+}
+
+void JobSystem::wake_waiters() {
+    if (m_waiting.load() > 0) {
+        { std::lock_guard lock(m_sleep_mutex); }
+        m_wake.notify_all();
+    }
+}
+
+void JobSystem::work(int index) {
+    t_system = this;
+    t_queue = index;
+    PROFILE_THREAD("job worker");
+    while (true) {
+        if (run_one(true)) {
+            continue;
+        }
+        std::unique_lock lock(m_sleep_mutex);
+        m_wake.wait(lock, [&] { return m_stop || m_queued.load() > 0 || m_long_queued.load() > 0; });
+        // queued jobs are finished first, something may be waiting for them
+        if (m_stop && m_queued.load() == 0 && m_long_queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void JobSystem::wait(const Handle& job) {
+    if (!job) {
+        return;
+    }
+    m_waiting++;
+    while (!job->finished.load()) {
+        if (run_one(false)) {
+            continue;
+        }
+        std::unique_lock lock(m_sleep_mutex);
+        m_wake.wait(lock, [&] { return job->finished.load() || m_queued.load() > 0; });
+    }
+    m_waiting--;
+    if (job->error) {
+        std::rethrow_exception(job->error);
+    }
+}
+
+void JobSystem::wait(const std::vector<Handle>& jobs) {
+    std::exception_ptr error;
+    for (const auto& job : jobs) {
+        try {
+            wait(job);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::on_main_thread(std::function<void()> fn) {
+    std::lock_guard lock(m_main_mutex);
+    m_main_callbacks.push_back(std::move(fn));
+}
+
+JobSystem::Handle JobSystem::then_on_main_thread(const Handle& job, std::function<void()> fn) {
+    return submit([this, fn = std::move(fn)]() mutable { on_main_thread(std::move(fn)); }, {job});
+}
+
+void JobSystem::run_main_thread_callbacks() {
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard lock(m_main_mutex);
+        std::swap(callbacks, m_main_callbacks);
+    }
+    // callbacks queued by these run the next time around
+    for (auto& callback : callbacks) {
+        callback();
+    }
+}
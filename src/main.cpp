@@ -53,14 +53,21 @@ int main () {
             }, issue);
         };
 
-        for(const auto& issue : app_state->moduleLoader.LoadModules(module_load_candidates, app_state->inputMgr, app_state->resourceStore)) {
+        for(const auto& issue : app_state->moduleLoader.LoadModules(module_load_candidates, app_state->inputMgr, app_state->definitions, app_state->noise)) {
             deal_with_an_issue(issue);
         }
         if (any_issues_critical) {
             return 0;
         }
 
-        for(const auto& issue : app_state->resourceStore.LoadModuleResources(app_state->moduleLoader)) {
+        for(const auto& issue : app_state->definitions.LoadModuleDefinitions(app_state->moduleLoader)) {
+            deal_with_an_issue(issue);
+        }
+        if (any_issues_critical) {
+            return 0;
+        }
+
+        for(const auto& issue : app_state->resourceStore.LoadModuleResources(app_state->definitions)) {
             deal_with_an_issue(issue);
         }
         if (any_issues_critical) {
@@ -68,6 +75,7 @@ int main () {
         }
         
         BehaviourStack state_stack;
+        state_stack.jobs = &app_state->jobs;
         state_stack.push(new behaviours::MainMenu(app_state));
         std::cout << "========================================================\n";
         state_stack.run();
@@ -0,0 +1,244 @@
+#include "noise.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+#include "job_system.hpp"
+#include "profiler.hpp"
+
+namespace noise {
+namespace {
+constexpr double TAU = 6.283185307179586;
+
+// splitmix64, small and the same everywhere
+struct Shuffler {
+    uint64_t state;
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+double fade(double t) {
+    return t * t * t * (t * (t * 6.0 - 15.0) + 10.0);
+}
+
+double lerp(double t, double a, double b) {
+    return a + t * (b - a);
+}
+
+// dot product with one of the 12 cube edge directions (the last 4 repeat some of them)
+double grad(int hash, double x, double y, double z) {
+    const int h = hash & 15;
+    const double u = h < 8 ? x : y;
+    const double v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+constexpr int SIMPLEX_GRADIENTS[12][3] = {
+    {1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0},
+    {1, 0, 1}, {-1, 0, 1}, {1, 0, -1}, {-1, 0, -1},
+    {0, 1, 1}, {0, -1, 1}, {0, 1, -1}, {0, -1, -1}
+};
+
+double simplex_corner(int gradient, double x, double y, double z) {
+    double t = 0.6 - x * x - y * y - z * z;
+    if (t < 0.0) {
+        return 0.0;
+    }
+    t *= t;
+    const auto& g = SIMPLEX_GRADIENTS[gradient];
+    return t * t * (g[0] * x + g[1] * y + g[2] * z);
+}
+
+struct Point {
+    double x, y, z;
+};
+
+Point cylinder_point(double x, double y, double period) {
+    const double angle = x / period * TAU;
+    const double radius = period / TAU;
+    return {radius * std::cos(angle), radius * std::sin(angle), y};
+}
+}
+
+Source::Source(uint32_t seed) {
+    std::array<uint8_t, 256> perm;
+    std::iota(perm.begin(), perm.end(), 0);
+    Shuffler shuffler{seed};
+    for (int i = 255; i > 0; i--) {
+        std::swap(perm[i], perm[shuffler.next() % (i + 1)]);
+    }
+    for (int i = 0; i < 512; i++) {
+        m_perm[i] = perm[i & 255];
+    }
+}
+
+double Source::perlin(double x, double y, double z) const {
+    const double fx = std::floor(x);
+    const double fy = std::floor(y);
+    const double fz = std::floor(z);
+    const int X = static_cast<int>(fx) & 255;
+    const int Y = static_cast<int>(fy) & 255;
+    const int Z = static_cast<int>(fz) & 255;
+    x -= fx;
+    y -= fy;
+    z -= fz;
+    const double u = fade(x);
+    const double v = fade(y);
+    const double w = fade(z);
+
+    const int A = m_perm[X] + Y;
+    const int AA = m_perm[A] + Z;
+    const int AB = m_perm[A + 1] + Z;
+    const int B = m_perm[X + 1] + Y;
+    const int BA = m_perm[B] + Z;
+    const int BB = m_perm[B + 1] + Z;
+
+    return lerp(w,
+        lerp(v,
+            lerp(u, grad(m_perm[AA], x, y, z), grad(m_perm[BA], x - 1, y, z)),
+            lerp(u, grad(m_perm[AB], x, y - 1, z), grad(m_perm[BB], x - 1, y - 1, z))),
+        lerp(v,
+            lerp(u, grad(m_perm[AA + 1], x, y, z - 1), grad(m_perm[BA + 1], x - 1, y, z - 1)),
+            lerp(u, grad(m_perm[AB + 1], x, y - 1, z - 1), grad(m_perm[BB + 1], x - 1, y - 1, z - 1))));
+}
+
+// Stefan Gustavson's 3D simplex noise
+double Source::simplex(double x, double y, double z) const {
+    constexpr double F3 = 1.0 / 3.0;
+    constexpr double G3 = 1.0 / 6.0;
+
+    // which simplex cell, and where in it
+    const double s = (x + y + z) * F3;
+    const int i = static_cast<int>(std::floor(x + s));
+    const int j = static_cast<int>(std::floor(y + s));
+    const int k = static_cast<int>(std::floor(z + s));
+    const double t = (i + j + k) * G3;
+    const double x0 = x - (i - t);
+    const double y0 = y - (j - t);
+    const double z0 = z - (k - t);
+
+    // which of the six tetrahedra
+    int i1, j1, k1, i2, j2, k2;
+    if (x0 >= y0) {
+        if (y0 >= z0)      { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+        else if (x0 >= z0) { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1; }
+        else               { i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1; }
+    } else {
+        if (y0 < z0)       { i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1; }
+        else if (x0 < z0)  { i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1; }
+        else               { i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+    }
+
+    const double n0 = simplex_corner(hash(i, j, k) % 12, x0, y0, z0);
+    const double n1 = simplex_corner(hash(i + i1, j + j1, k + k1) % 12, x0 - i1 + G3, y0 - j1 + G3, z0 - k1 + G3);
+    const double n2 = simplex_corner(hash(i + i2, j + j2, k + k2) % 12, x0 - i2 + 2.0 * G3, y0 - j2 + 2.0 * G3, z0 - k2 + 2.0 * G3);
+    const double n3 = simplex_corner(hash(i + 1, j + 1, k + 1) % 12, x0 - 1.0 + 3.0 * G3, y0 - 1.0 + 3.0 * G3, z0 - 1.0 + 3.0 * G3);
+    return 32.0 * (n0 + n1 + n2 + n3);
+}
+
+double Source::value(double x, double y, double z) const {
+    const double fx = std::floor(x);
+    const double fy = std::floor(y);
+    const double fz = std::floor(z);
+    const int X = static_cast<int>(fx);
+    const int Y = static_cast<int>(fy);
+    const int Z = static_cast<int>(fz);
+    const double u = fade(x - fx);
+    const double v = fade(y - fy);
+    const double w = fade(z - fz);
+    const auto at = [&](int dx, int dy, int dz) { return hash(X + dx, Y + dy, Z + dz) * (2.0 / 255.0) - 1.0; };
+
+    return lerp(w,
+        lerp(v, lerp(u, at(0, 0, 0), at(1, 0, 0)), lerp(u, at(0, 1, 0), at(1, 1, 0))),
+        lerp(v, lerp(u, at(0, 0, 1), at(1, 0, 1)), lerp(u, at(0, 1, 1), at(1, 1, 1))));
+}
+
+double Source::basis(Basis b, double x, double y, double z) const {
+    switch (b) {
+        case Basis::Perlin: return perlin(x, y, z);
+        case Basis::Simplex: return simplex(x, y, z);
+        case Basis::Value: return value(x, y, z);
+    }
+    return 0.0;
+}
+
+double sample(const Source& source, const Settings& settings, double x, double y, double z) {
+    if (settings.fractal == Fractal::None) {
+        return source.basis(settings.basis, x * settings.frequency, y * settings.frequency, z * settings.frequency);
+    }
+    double frequency = settings.frequency;
+    double amplitude = 1.0;
+    double sum = 0.0;
+    double total_amplitude = 0.0;
+    const int octaves = std::max(settings.octaves, 1);
+    for (int octave = 0; octave < octaves; octave++) {
+        // every octave somewhere else in the lattice, so that they don't all line up at the origin
+        const double offset = octave * 19.19;
+        double n = source.basis(settings.basis, x * frequency + offset, y * frequency + offset, z * frequency + offset);
+        if (settings.fractal == Fractal::Ridged) {
+            n = 1.0 - std::abs(n);
+            n *= n;
+        }
+        sum += n * amplitude;
+        total_amplitude += amplitude;
+        amplitude *= settings.persistence;
+        frequency *= settings.lacunarity;
+    }
+    return total_amplitude > 0.0 ? sum / total_amplitude : 0.0;
+}
+
+double sample_cylinder(const Source& source, const Settings& settings, double x, double y, double period) {
+    const auto p = cylinder_point(x, y, period);
+    return sample(source, settings, p.x, p.y, p.z);
+}
+
+void fill(const Source& source, const Settings& settings, int width, int height, bool cylinder, std::span<float> out, JobSystem* jobs) {
+    fill_region(source, settings, 0, 0, width, height, width, cylinder, out, jobs);
+}
+
+void fill_region(const Source& source, const Settings& settings, int x0, int y0, int width, int height, int world_width, bool cylinder, std::span<float> out, JobSystem* jobs) {
+    PROFILE_ZONE("noise fill");
+    if (width <= 0 || height <= 0 || world_width <= 0) {
+        return;
+    }
+    // the trigonometry only depends on the column, so it's done once per column instead of once per cell
+    std::vector<Point> columns(width);
+    for (int x = 0; x < width; x++) {
+        const double u = (x0 + x) / static_cast<double>(world_width);
+        columns[x] = cylinder ? cylinder_point(u, 0.0, 1.0) : Point{u, 0.0, 0.0};
+    }
+    const auto row = [&](int y) {
+        const double v = (y0 + y) / static_cast<double>(world_width);
+        float* dst = out.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+            const auto& c = columns[x];
+            dst[x] = static_cast<float>(cylinder ? sample(source, settings, c.x, c.y, v) : sample(source, settings, c.x, v, 0.0));
+        }
+    };
+    if (jobs != nullptr) {
+        jobs->parallel_for(0, height, 4, row);
+    } else {
+        for (int y = 0; y < height; y++) {
+            row(y);
+        }
+    }
+}
+
+std::optional<Basis> basis_from_name(std::string_view name) {
+    if (name == "perlin") return Basis::Perlin;
+    if (name == "simplex") return Basis::Simplex;
+    if (name == "value") return Basis::Value;
+    return {};
+}
+
+std::optional<Fractal> fractal_from_name(std::string_view name) {
+    if (name == "none") return Fractal::None;
+    if (name == "fbm") return Fractal::FBm;
+    if (name == "ridged") return Fractal::Ridged;
+    return {};
+}
+}
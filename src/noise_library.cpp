@@ -0,0 +1,94 @@
+#include "noise_library.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+struct LuaNoise {
+    noise::Source source;
+    noise::Settings settings;
+    JobSystem* jobs;
+};
+
+LuaNoise NewNoise(NoiseLibrary& library, sol::optional<sol::table> args) {
+    noise::Settings settings;
+    if (args.has_value()) {
+        const sol::table& t = *args;
+        const auto basis_name = t.get_or<std::string>("basis", std::string("perlin"));
+        const auto fractal_name = t.get_or<std::string>("fractal", std::string("fbm"));
+        const auto basis = noise::basis_from_name(basis_name);
+        const auto fractal = noise::fractal_from_name(fractal_name);
+        if (!basis.has_value()) {
+            throw sol::error("Noise.new: there's no basis called " + basis_name);
+        }
+        if (!fractal.has_value()) {
+            throw sol::error("Noise.new: there's no fractal called " + fractal_name);
+        }
+        settings.basis = *basis;
+        settings.fractal = *fractal;
+        settings.seed = static_cast<uint32_t>(t.get_or<long long>("seed", 0LL));
+        settings.octaves = t.get_or<int>("octaves", settings.octaves);
+        settings.frequency = t.get_or<double>("frequency", settings.frequency);
+        settings.lacunarity = t.get_or<double>("lacunarity", settings.lacunarity);
+        settings.persistence = t.get_or<double>("persistence", settings.persistence);
+    }
+    return LuaNoise{noise::Source(settings.seed), settings, library.m_jobs};
+}
+
+double Sample(const LuaNoise& n, double x, double y, sol::optional<double> z) {
+    return noise::sample(n.source, n.settings, x, y, z.value_or(0.0));
+}
+
+double SampleCylinder(const LuaNoise& n, double x, double y, double period) {
+    return noise::sample_cylinder(n.source, n.settings, x, y, period);
+}
+
+// Pushes values as grid[y][x], 1 based like the map. Straight through the C API, going through sol for every number
+// costs more than the noise
+sol::table PushGrid(lua_State* L, const std::vector<float>& values, int width, int height) {
+    lua_createtable(L, height, 0);
+    for (int y = 0; y < height; y++) {
+        lua_createtable(L, width, 0);
+        const float* row = values.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+            lua_pushnumber(L, row[x]);
+            lua_rawseti(L, -2, x + 1);
+        }
+        lua_rawseti(L, -2, y + 1);
+    }
+    return sol::stack::pop<sol::table>(L);
+}
+
+// One call for the whole layer
+sol::table Fill(const LuaNoise& n, sol::this_state ts, int width, int height, sol::optional<bool> cylinder) {
+    if (width <= 0 || height <= 0) {
+        throw sol::error("fill: the size has to be positive");
+    }
+    std::vector<float> values(static_cast<size_t>(width) * height);
+    noise::fill(n.source, n.settings, width, height, cylinder.value_or(true), values, n.jobs);
+    return PushGrid(ts, values, width, height);
+}
+
+// A part of a layer world_width wide, from the 1 based column x and row y - for chunk generators, see WorldGenChunk.
+// Chunks are made in parallel already, so this one stays on the thread it's called from
+sol::table FillRegion(const LuaNoise& n, sol::this_state ts, int x, int y, int width, int height, int world_width, sol::optional<bool> cylinder) {
+    if (width <= 0 || height <= 0 || world_width <= 0) {
+        throw sol::error("fillRegion: the sizes have to be positive");
+    }
+    std::vector<float> values(static_cast<size_t>(width) * height);
+    noise::fill_region(n.source, n.settings, x - 1, y - 1, width, height, world_width, cylinder.value_or(true), values);
+    return PushGrid(ts, values, width, height);
+}
+}
+
+void NoiseLibrary::InjectSymbols(sol::state& lua) {
+    lua.new_usertype<LuaNoise>("NoiseGenerator",
+        sol::no_constructor,
+        "sample", &Sample,
+        "sampleCylinder", &SampleCylinder,
+        "fill", &Fill,
+        "fillRegion", &FillRegion
+    );
+    lua.create_named_table("Noise",
+        "new", [this](sol::optional<sol::table> args) { return NewNoise(*this, std::move(args)); }
+    );
+}
@@ -0,0 +1,206 @@
+#include "path_planner.hpp"
+#include <algorithm>
+
+namespace {
+// more changes than this between two plans, and starting over is cheaper than repairing
+constexpr size_t MAX_REPAIRED_TILES = 1024;
+} // namespace
+
+PathResult PathPlanner::plan(
+    const CylinderHexWorld<HexData>& world, HexCoords from, HexCoords to,
+    std::vector<HexCoords>& path, const PathOptions& options
+) {
+    PathResult result;
+    path.clear();
+    if (world.width <= 0) {
+        return result;
+    }
+    const int root = world.wrapped_index(from.q, from.r);
+    const int goal = world.wrapped_index(to.q, to.r);
+    if (root == -1 || goal == -1) {
+        return result;
+    }
+
+    const bool same_search = root == m_root && world.width == m_width && world.height == m_height
+        && options.units == m_options.units && options.blocking_type == m_options.blocking_type
+        && m_changed.size() <= MAX_REPAIRED_TILES && m_stamp.size() >= world.data.size();
+    if (!same_search) {
+        restart(world, root, goal, options);
+    } else {
+        if (goal != m_goal) {
+            m_km += m_costs.heuristic(world, world.coords_of_index(m_goal), world.coords_of_index(goal));
+            m_goal = goal;
+        }
+        for (const int idx : m_changed) {
+            if (!touched(idx)) continue; // gets the new cost when the search gets there
+            m_step_cost[idx] = step_cost(world, idx);
+            update_tile(world, idx);
+        }
+        m_changed.clear();
+    }
+    // the options might only differ in this, which doesn't change the search
+    m_options.max_cost = options.max_cost;
+
+    if (root != goal && step_cost(world, goal) == UNKNOWN) {
+        return result;
+    }
+    result.expanded = search(world);
+    const int cost = m_g[goal];
+    if (cost == UNKNOWN || cost > options.max_cost) {
+        return result;
+    }
+    result.found = true;
+    result.cost = cost;
+
+    // back from the goal, always to the neighbour closest to the unit
+    for (int at = goal; ; ) {
+        path.push_back(world.coords_of_index(at));
+        if (at == root) break;
+        const auto hc = world.coords_of_index(at);
+        int best = -1;
+        for (const auto [dq, dr] : axial_directions) {
+            const int other = world.wrapped_index(hc.q + dq, hc.r + dr);
+            if (other == -1 || !touched(other)) continue;
+            if (best == -1 || m_g[other] < m_g[best]) {
+                best = other;
+            }
+        }
+        if (best == -1 || m_g[best] == UNKNOWN || path.size() > world.data.size()) {
+            // can't happen with a finished search, but better no path than a loop
+            path.clear();
+            return PathResult{.expanded = result.expanded};
+        }
+        at = best;
+    }
+    std::reverse(path.begin(), path.end());
+    Pathfinder::unwrap_path(world, from, path);
+    return result;
+}
+
+void PathPlanner::mark_changed(const CylinderHexWorld<HexData>& world, HexCoords hc) {
+    if (m_root == -1 || world.width != m_width || world.height != m_height) {
+        return;
+    }
+    const int idx = world.wrapped_index(hc.q, hc.r);
+    if (idx != -1 && m_changed.size() <= MAX_REPAIRED_TILES) {
+        m_changed.insert(idx);
+    }
+}
+
+void PathPlanner::restart(const CylinderHexWorld<HexData>& world, int root, int goal, const PathOptions& options) {
+    m_root = root;
+    m_goal = goal;
+    m_width = world.width;
+    m_height = world.height;
+    m_options = options;
+    m_km = 0;
+    m_changed.clear();
+
+    const size_t tile_count = world.data.size();
+    if (m_stamp.size() < tile_count) {
+        m_stamp.resize(tile_count, 0);
+        m_g.resize(tile_count);
+        m_rhs.resize(tile_count);
+        m_step_cost.resize(tile_count);
+    }
+    m_generation++;
+    if (m_generation == 0) {
+        std::fill(m_stamp.begin(), m_stamp.end(), 0);
+        m_generation = 1;
+    }
+    m_open.clear();
+    m_open.reserve_items(tile_count);
+
+    touch(world, root);
+    m_rhs[root] = 0;
+    m_open.push_or_update(root, key(world, root));
+}
+
+void PathPlanner::touch(const CylinderHexWorld<HexData>& world, int idx) {
+    if (touched(idx)) {
+        return;
+    }
+    m_stamp[idx] = m_generation;
+    m_g[idx] = UNKNOWN;
+    m_rhs[idx] = UNKNOWN;
+    m_step_cost[idx] = step_cost(world, idx);
+}
+
+int PathPlanner::step_cost(const CylinderHexWorld<HexData>& world, int idx) const {
+    const int cost = m_costs.entering_cost(world, idx);
+    if (cost == Pathfinder::IMPASSABLE) {
+        return UNKNOWN;
+    }
+    if (m_options.units != nullptr && m_options.blocking_type != UnitType::Unspecified
+        && m_options.units->occupied(idx, m_options.blocking_type)) {
+        return UNKNOWN;
+    }
+    return cost;
+}
+
+PathPlanner::Key PathPlanner::key(const CylinderHexWorld<HexData>& world, int idx) const {
+    const int best = std::min(m_g[idx], m_rhs[idx]);
+    const int to_goal = m_costs.heuristic(world, world.coords_of_index(idx), world.coords_of_index(m_goal));
+    return {best + to_goal + m_km, best};
+}
+
+void PathPlanner::update_tile(const CylinderHexWorld<HexData>& world, int idx) {
+    touch(world, idx);
+    if (idx != m_root) {
+        int best = UNKNOWN;
+        if (m_step_cost[idx] != UNKNOWN) {
+            const auto hc = world.coords_of_index(idx);
+            for (const auto [dq, dr] : axial_directions) {
+                const int other = world.wrapped_index(hc.q + dq, hc.r + dr);
+                if (other != -1 && touched(other)) {
+                    best = std::min(best, m_g[other]);
+                }
+            }
+        }
+        m_rhs[idx] = best == UNKNOWN ? UNKNOWN : best + m_step_cost[idx];
+    }
+    if (m_g[idx] != m_rhs[idx]) {
+        m_open.push_or_update(idx, key(world, idx));
+    } else {
+        m_open.remove(idx);
+    }
+}
+
+void PathPlanner::update_around(const CylinderHexWorld<HexData>& world, int idx) {
+    const auto hc = world.coords_of_index(idx);
+    for (const auto [dq, dr] : axial_directions) {
+        const int other = world.wrapped_index(hc.q + dq, hc.r + dr);
+        if (other != -1) {
+            update_tile(world, other);
+        }
+    }
+}
+
+int PathPlanner::search(const CylinderHexWorld<HexData>& world) {
+    int expanded = 0;
+    touch(world, m_goal);
+    while (!m_open.empty()) {
+        if (!(m_open.top_priority() < key(world, m_goal)) && m_g[m_goal] == m_rhs[m_goal]) {
+            break;
+        }
+        const int current = m_open.top();
+        const Key queued_key = m_open.top_priority();
+        const Key current_key = key(world, current);
+        if (queued_key < current_key) {
+            // queued for an older goal
+            m_open.push_or_update(current, current_key);
+            continue;
+        }
+        expanded++;
+        if (m_g[current] > m_rhs[current]) {
+            m_g[current] = m_rhs[current];
+            m_open.pop();
+            update_around(world, current);
+        } else {
+            m_g[current] = UNKNOWN;
+            update_tile(world, current);
+            update_around(world, current);
+        }
+    }
+    return expanded;
+}
@@ -0,0 +1,128 @@
+#include "pathfinding.hpp"
+#include <algorithm>
+
+namespace {
+SearchScratch& pathfinding_scratch() {
+    thread_local SearchScratch scratch;
+    return scratch;
+}
+} // namespace
+
+void SearchScratch::begin(size_t tile_count) {
+    if (stamp.size() < tile_count) {
+        stamp.resize(tile_count, 0);
+        cost.resize(tile_count);
+        came_from.resize(tile_count);
+    }
+    generation++;
+    if (generation == 0) {
+        // stamps wrapped around, old ones could look current
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+    open.clear();
+    open.reserve_items(tile_count);
+}
+
+Pathfinder::Pathfinder(const std::vector<int>& movement_costs) {
+    set_movement_costs(movement_costs);
+}
+
+void Pathfinder::set_movement_costs(const std::vector<int>& movement_costs) {
+    m_costs.clear();
+    m_min_cost = std::numeric_limits<int>::max();
+    m_max_cost = 1;
+    for (const auto cost : movement_costs) {
+        if (cost < 1) {
+            m_costs.push_back(IMPASSABLE);
+        } else {
+            m_costs.push_back(cost);
+            m_min_cost = std::min(m_min_cost, cost);
+            m_max_cost = std::max(m_max_cost, cost);
+        }
+    }
+    if (m_min_cost == std::numeric_limits<int>::max()) {
+        m_min_cost = 1;
+    }
+}
+
+PathResult Pathfinder::find_path(
+    const CylinderHexWorld<HexData>& world, HexCoords from, HexCoords to,
+    std::vector<HexCoords>& path, const PathOptions& options
+) const {
+    PathResult result;
+    path.clear();
+    if (world.width <= 0) {
+        return result;
+    }
+    const int start = world.wrapped_index(from.q, from.r);
+    const int goal = world.wrapped_index(to.q, to.r);
+    if (start == -1 || goal == -1) {
+        return result;
+    }
+
+    const bool check_units = options.units != nullptr && options.blocking_type != UnitType::Unspecified;
+    const auto blocked = [&](int idx) {
+        return check_units && options.units->occupied(idx, options.blocking_type);
+    };
+    if (start != goal && (entering_cost(world, goal) == IMPASSABLE || blocked(goal))) {
+        return result;
+    }
+
+    auto& scratch = pathfinding_scratch();
+    scratch.begin(world.data.size());
+    const auto goal_coords = world.coords_of_index(goal);
+    scratch.touch(start, 0, -1);
+    scratch.open.push_or_update(start, heuristic(world, world.coords_of_index(start), goal_coords));
+
+    while (!scratch.open.empty()) {
+        const int current = scratch.open.pop();
+        result.expanded++;
+        if (current == goal) {
+            result.found = true;
+            break;
+        }
+        const int current_cost = scratch.cost[current];
+        const auto cc = world.coords_of_index(current);
+        for (const auto [dq, dr] : axial_directions) {
+            const int next = world.wrapped_index(cc.q + dq, cc.r + dr);
+            if (next == -1) continue;
+            const int step = entering_cost(world, next);
+            if (step == IMPASSABLE) continue;
+            const int next_cost = current_cost + step;
+            if (next_cost > options.max_cost) continue;
+            // with a consistent heuristic, anything already closed has a cost that's at least as good
+            if (scratch.touched(next) && scratch.cost[next] <= next_cost) continue;
+            if (blocked(next)) continue;
+            scratch.touch(next, next_cost, current);
+            scratch.open.push_or_update(next, next_cost + heuristic(world, world.coords_of_index(next), goal_coords));
+        }
+    }
+
+    if (!result.found) {
+        return result;
+    }
+    result.cost = scratch.cost[goal];
+    for (int at = goal; at != -1; at = scratch.came_from[at]) {
+        path.push_back(world.coords_of_index(at));
+    }
+    std::reverse(path.begin(), path.end());
+    unwrap_path(world, from, path);
+    return result;
+}
+
+void Pathfinder::unwrap_path(const CylinderHexWorld<HexData>& world, HexCoords from, std::vector<HexCoords>& path) {
+    if (path.empty()) {
+        return;
+    }
+    auto previous = path.front();
+    path.front() = from;
+    for (size_t i = 1; i < path.size(); i++) {
+        const auto current = path[i];
+        int dq = current.q - previous.q;
+        if (dq > 1) dq -= world.width;
+        if (dq < -1) dq += world.width;
+        path[i] = path[i - 1] + HexCoords::from_axial(dq, current.r - previous.r);
+        previous = current;
+    }
+}
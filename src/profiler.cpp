@@ -0,0 +1,157 @@
+#include "profiler.hpp"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace {
+// written only by its thread, read by anyone. The fields are atomic, so that a reader racing with the writer
+// gets garbage it can detect (by the head moving past it), and not undefined behaviour
+struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> start{0};
+    std::atomic<int64_t> end{0};
+};
+
+struct ThreadRing {
+    std::array<Slot, profiler::RING_SIZE> slots;
+    // how many zones were ever written, the next one goes to head % RING_SIZE
+    std::atomic<uint64_t> head{0};
+    int id = 0;
+    std::atomic<const char*> name{nullptr};
+};
+
+struct Registry {
+    std::mutex mutex;
+    // rings stay around after their thread is gone, so that what it did is still in the dump
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    profiler::Clock::time_point epoch = profiler::Clock::now();
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadRing& this_thread_ring() {
+    thread_local ThreadRing* ring = [] {
+        auto& reg = registry();
+        std::lock_guard lock(reg.mutex);
+        auto& created = reg.rings.emplace_back(std::make_unique<ThreadRing>());
+        created->id = static_cast<int>(reg.rings.size());
+        return created.get();
+    }();
+    return *ring;
+}
+
+struct CopiedZone {
+    const char* name;
+    int64_t start;
+    int64_t end;
+};
+
+// What's in the ring now and wasn't overwritten while copying it
+void copy_ring(const ThreadRing& ring, std::vector<CopiedZone>& out) {
+    const uint64_t head = ring.head.load(std::memory_order_acquire);
+    const uint64_t first = head > profiler::RING_SIZE ? head - profiler::RING_SIZE : 0;
+    const size_t copied_from = out.size();
+    for (uint64_t i = first; i < head; i++) {
+        const auto& slot = ring.slots[i % profiler::RING_SIZE];
+        out.push_back(CopiedZone{
+            slot.name.load(std::memory_order_relaxed),
+            slot.start.load(std::memory_order_relaxed),
+            slot.end.load(std::memory_order_relaxed)
+        });
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // the writer may have gone around meanwhile. It could be writing the slot at the new head already,
+    // so everything up to that one could be torn
+    const uint64_t new_head = ring.head.load(std::memory_order_relaxed) + 1;
+    const uint64_t valid_from = new_head > profiler::RING_SIZE ? new_head - profiler::RING_SIZE : 0;
+    if (valid_from > first) {
+        const auto torn = std::min<uint64_t>(valid_from - first, head - first);
+        out.erase(out.begin() + copied_from, out.begin() + copied_from + torn);
+    }
+}
+
+void write_escaped(std::FILE* file, const char* text) {
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+        }
+        std::fputc(*c, file);
+    }
+}
+} // namespace
+
+namespace profiler {
+    int64_t to_ns(Clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t - registry().epoch).count();
+    }
+
+    void record(const char* name, Clock::time_point start, Clock::time_point end) {
+        record(name, to_ns(start), to_ns(end));
+    }
+
+    void record(const char* name, int64_t start_ns, int64_t end_ns) {
+        auto& ring = this_thread_ring();
+        const uint64_t head = ring.head.load(std::memory_order_relaxed);
+        // pairs with the fence in copy_ring - whoever sees these writes, sees the head from before them
+        std::atomic_thread_fence(std::memory_order_release);
+        auto& slot = ring.slots[head % RING_SIZE];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(start_ns, std::memory_order_relaxed);
+        slot.end.store(end_ns, std::memory_order_relaxed);
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    void set_thread_name(const char* name) {
+        this_thread_ring().name.store(name, std::memory_order_relaxed);
+    }
+
+    bool write_chrome_trace(const std::string& path, double seconds) {
+        std::vector<std::pair<const ThreadRing*, std::vector<CopiedZone>>> copies;
+        {
+            auto& reg = registry();
+            std::lock_guard lock(reg.mutex);
+            for (const auto& ring : reg.rings) {
+                copies.emplace_back(ring.get(), std::vector<CopiedZone>{});
+            }
+        }
+        for (auto& [ring, zones] : copies) {
+            copy_ring(*ring, zones);
+        }
+
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            return false;
+        }
+        const int64_t since = now_ns() - static_cast<int64_t>(seconds * 1e9);
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+        bool first = true;
+        const auto separate = [&] {
+            if (!first) {
+                std::fputs(",\n", file);
+            }
+            first = false;
+        };
+        for (const auto& [ring, zones] : copies) {
+            if (const char* name = ring->name.load(std::memory_order_relaxed); name != nullptr) {
+                separate();
+                std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", ring->id);
+                write_escaped(file, name);
+                std::fputs("\"}}", file);
+            }
+            for (const auto& zone : zones) {
+                if (zone.end < since || zone.name == nullptr) continue;
+                separate();
+                std::fputs("{\"name\":\"", file);
+                write_escaped(file, zone.name);
+                // complete events, in microseconds
+                std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                             ring->id, zone.start / 1000.0, (zone.end - zone.start) / 1000.0);
+            }
+        }
+        std::fputs("\n]}\n", file);
+        return std::fclose(file) == 0;
+    }
+}
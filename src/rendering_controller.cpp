@@ -0,0 +1,149 @@
+#include "rendering_controller.hpp"
+#include <raymath.h>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+// rays that miss the ground, or hit it very far away (looking at the horizon), are cut off here
+constexpr float MAX_VIEW_DISTANCE = 200.0f;
+// hexes are 2 high and sqrt3 wide, and reach this far from their center
+constexpr float HEX_HALF_HEIGHT = 1.0f;
+constexpr float HEX_HALF_WIDTH = sqrt3 / 2.0f;
+} // namespace
+
+Vector3 intersect_with_ground_plane(const Ray ray, float plane_height) {
+    const auto moveunit = (plane_height - ray.position.y) / ray.direction.y;
+    return Vector3Add(ray.position, Vector3Scale(ray.direction, moveunit));
+}
+
+bool RenderingController::ViewKey::operator==(const ViewKey& other) const {
+    return std::memcmp(&view, &other.view, sizeof(Matrix)) == 0 && fovy == other.fovy && projection == other.projection
+        && screen_width == other.screen_width && screen_height == other.screen_height
+        && world_width == other.world_width && world_height == other.world_height;
+}
+
+bool RenderingController::update_visible(const Camera3D& camera, const CylinderHexWorld<HexData>& world) {
+    const ViewKey key{
+        .view = GetCameraMatrix(camera),
+        .fovy = camera.fovy,
+        .projection = camera.projection,
+        .screen_width = GetScreenWidth(),
+        .screen_height = GetScreenHeight(),
+        .world_width = world.width,
+        .world_height = world.height,
+    };
+    if (m_valid && key == m_key) {
+        m_added_chunks.clear();
+        m_removed_chunks.clear();
+        return false;
+    }
+    m_key = key;
+    m_valid = true;
+    m_revision++;
+
+    const float w = static_cast<float>(key.screen_width);
+    const float h = static_cast<float>(key.screen_height);
+    std::array<Vector2, 4> corners;
+    const std::array<Vector2, 4> screen_corners = {{{0, 0}, {w, 0}, {w, h}, {0, h}}};
+    for (size_t i = 0; i < corners.size(); i++) {
+        const auto ray = GetMouseRay(screen_corners[i], camera);
+        float distance = -ray.position.y / ray.direction.y;
+        if (!(distance > 0.0f) || distance > MAX_VIEW_DISTANCE) {
+            distance = MAX_VIEW_DISTANCE;
+        }
+        const auto on_ground = Vector3Add(ray.position, Vector3Scale(ray.direction, distance));
+        corners[i] = Vector2{on_ground.x, on_ground.z};
+    }
+    compute_rows(corners, world);
+    compute_chunks(world);
+    return true;
+}
+
+bool RenderingController::is_visible(HexCoords hc) const {
+    // one span per row at most, sorted by r
+    const auto row = std::lower_bound(m_rows.begin(), m_rows.end(), hc.r, [](const HexRowSpan& span, int r) { return span.r < r; });
+    return row != m_rows.end() && row->r == hc.r && hc.q >= row->q_from && hc.q <= row->q_to;
+}
+
+void RenderingController::compute_rows(std::array<Vector2, 4> corners, const CylinderHexWorld<HexData>& world) {
+    m_rows.clear();
+    m_hex_count = 0;
+    float y_min = corners[0].y;
+    float y_max = corners[0].y;
+    for (const auto c : corners) {
+        y_min = std::min(y_min, c.y);
+        y_max = std::max(y_max, c.y);
+    }
+    // hexes in row r have their centers at y = 1.5r
+    const int r_from = std::max(0, static_cast<int>(std::floor((y_min - HEX_HALF_HEIGHT) / 1.5f)));
+    const int r_to = std::min(world.height - 1, static_cast<int>(std::ceil((y_max + HEX_HALF_HEIGHT) / 1.5f)));
+
+    for (int r = r_from; r <= r_to; r++) {
+        // how far the view reaches sideways anywhere within the height of the row
+        const float band_from = 1.5f * r - HEX_HALF_HEIGHT;
+        const float band_to = 1.5f * r + HEX_HALF_HEIGHT;
+        float x_min = INFINITY;
+        float x_max = -INFINITY;
+        const auto include = [&](float x) {
+            x_min = std::min(x_min, x);
+            x_max = std::max(x_max, x);
+        };
+        for (size_t i = 0; i < corners.size(); i++) {
+            const auto a = corners[i];
+            const auto b = corners[(i + 1) % corners.size()];
+            if (a.y >= band_from && a.y <= band_to) {
+                include(a.x);
+            }
+            // the edge crosses the top or the bottom of the row
+            for (const float y : {band_from, band_to}) {
+                if ((a.y - y) * (b.y - y) < 0.0f) {
+                    include(a.x + (b.x - a.x) * (y - a.y) / (b.y - a.y));
+                }
+            }
+        }
+        if (x_min > x_max) {
+            continue;
+        }
+        // a hex is in when its center is within half a hex from the covered stretch
+        const float q_offset = r / 2.0f;
+        const int q_from = static_cast<int>(std::ceil((x_min - HEX_HALF_WIDTH) / sqrt3 - q_offset));
+        const int q_to = static_cast<int>(std::floor((x_max + HEX_HALF_WIDTH) / sqrt3 - q_offset));
+        if (q_from > q_to) {
+            continue;
+        }
+        m_rows.push_back(HexRowSpan{r, q_from, q_to});
+        m_hex_count += q_to - q_from + 1;
+    }
+}
+
+void RenderingController::compute_chunks(const CylinderHexWorld<HexData>& world) {
+    m_new_chunks.clear();
+    m_placements.clear();
+    if (world.width > 0) {
+        const int chunks_wide = world.chunks_wide();
+        for (const auto& row : m_rows) {
+            const int chunk_row = row.r / WORLD_CHUNK_SIZE;
+            // step from chunk to chunk, the span can go around the world
+            for (int q = row.q_from; q <= row.q_to; ) {
+                const int normalized = positive_modulo(q, world.width);
+                const int column = normalized / WORLD_CHUNK_SIZE;
+                const int chunk = chunk_row * chunks_wide + column;
+                m_new_chunks.push_back(chunk);
+                m_placements.push_back(ChunkPlacement{chunk, (q - normalized) / world.width});
+                q += std::min((column + 1) * WORLD_CHUNK_SIZE, world.width) - normalized;
+            }
+        }
+    }
+    std::sort(m_placements.begin(), m_placements.end());
+    m_placements.erase(std::unique(m_placements.begin(), m_placements.end()), m_placements.end());
+    std::sort(m_new_chunks.begin(), m_new_chunks.end());
+    m_new_chunks.erase(std::unique(m_new_chunks.begin(), m_new_chunks.end()), m_new_chunks.end());
+
+    m_added_chunks.clear();
+    m_removed_chunks.clear();
+    std::set_difference(m_new_chunks.begin(), m_new_chunks.end(), m_chunks.begin(), m_chunks.end(), std::back_inserter(m_added_chunks));
+    std::set_difference(m_chunks.begin(), m_chunks.end(), m_new_chunks.begin(), m_new_chunks.end(), std::back_inserter(m_removed_chunks));
+    std::swap(m_chunks, m_new_chunks);
+}
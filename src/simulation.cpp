@@ -0,0 +1,63 @@
+#include "simulation.hpp"
+#include <algorithm>
+
+Simulation::Simulation(GameState& gs, SimulationSettings settings)
+    : m_gs(gs)
+    , m_settings(settings)
+    , m_tick_length(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / std::max(1, settings.ticks_per_second))))
+{
+    m_next_tick = std::chrono::steady_clock::now() + m_tick_length;
+    m_front.time = m_next_tick - m_tick_length;
+}
+
+bool Simulation::advance() {
+    run_due_ticks();
+    if (!m_back_is_new) {
+        return false;
+    }
+    std::swap(m_front, m_back);
+    m_back_is_new = false;
+    return true;
+}
+
+float Simulation::interpolation_alpha() const {
+    const auto since = std::chrono::steady_clock::now() - m_front.time;
+    return std::clamp(static_cast<float>(since.count()) / static_cast<float>(m_tick_length.count()), 0.0f, 1.0f);
+}
+
+void Simulation::run_due_ticks() {
+    const auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < m_settings.max_catch_up_ticks && m_next_tick <= now; i++) {
+        run_tick(m_next_tick);
+        m_next_tick += m_tick_length;
+    }
+    if (m_next_tick <= now) {
+        // too far behind, the simulation slows down instead of running ever more ticks per frame
+        const auto missed = (now - m_next_tick) / m_tick_length + 1;
+        m_next_tick += missed * m_tick_length;
+        m_stats.dropped += missed;
+    }
+}
+
+void Simulation::run_tick(std::chrono::steady_clock::time_point due) {
+    const auto start = std::chrono::steady_clock::now();
+    m_tick_steps.clear();
+    m_gs.Tick(m_tick_steps);
+    const float took = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // a frame can run several ticks, the steps of all of them are kept until it takes the snapshot
+    if (!m_back_is_new) {
+        m_back.steps_since_last.clear();
+    }
+    m_back.tick = m_gs.tick;
+    m_back.time = due;
+    m_back.steps.assign(m_tick_steps.begin(), m_tick_steps.end());
+    m_back.steps_since_last.insert(m_back.steps_since_last.end(), m_tick_steps.begin(), m_tick_steps.end());
+    m_back_is_new = true;
+
+    m_stats.ticks++;
+    m_stats.last_tick_ms = took;
+    m_stats.max_tick_ms = std::max(m_stats.max_tick_ms, took);
+    m_total_tick_ms += took;
+    m_stats.average_tick_ms = static_cast<float>(m_total_tick_ms / m_stats.ticks);
+}
@@ -0,0 +1,352 @@
+#include "terrain_chunks.hpp"
+#include "terrain_renderer.hpp"
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <raymath.h>
+#include "profiler.hpp"
+
+namespace {
+constexpr int CHUNK_HEXES = WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE;
+
+// the rotating part of the matrix only, for normals
+Vector3 transform_direction(Vector3 v, const Matrix& m) {
+    return Vector3{
+        m.m0 * v.x + m.m4 * v.y + m.m8 * v.z,
+        m.m1 * v.x + m.m5 * v.y + m.m9 * v.z,
+        m.m2 * v.x + m.m6 * v.y + m.m10 * v.z
+    };
+}
+
+uint32_t revision_of(int chunk, const TerrainFrame& frame) {
+    // before the game state knows about the world's chunks
+    return chunk < static_cast<int>(frame.chunk_revisions.size()) ? frame.chunk_revisions[chunk] : 0;
+}
+
+size_t mesh_bytes(const Mesh& mesh, bool has_normals) {
+    // positions, texcoords (raylib makes that buffer even without them) and colors, normals when there are any
+    const size_t per_vertex = 3 * sizeof(float) + 2 * sizeof(float) + 4 + (has_normals ? 3 * sizeof(float) : 0);
+    return static_cast<size_t>(mesh.vertexCount) * per_vertex;
+}
+} // namespace
+
+TerrainChunkBaker::~TerrainChunkBaker() {
+    // the jobs point at this, those that didn't start yet find nothing to do
+    std::unique_lock lock(m_mutex);
+    m_jobs.clear();
+    m_idle.wait(lock, [&] { return m_running == 0; });
+}
+
+void TerrainChunkBaker::update(std::span<const int> chunks, const TerrainFrame& frame) {
+    PROFILE_ZONE("terrain chunks");
+    m_stats.draw_calls = 0;
+    m_stats.triangles = 0;
+    const auto& world = frame.world;
+    if (world.width != m_world_width || world.height != m_world_height) {
+        drop_all();
+        m_chunks.clear();
+        m_chunks.resize(world.chunk_count());
+        m_world_width = world.width;
+        m_world_height = world.height;
+        m_generation++;
+    }
+    if (frame.scale != m_scale) {
+        m_scale = frame.scale;
+        m_generation++;
+    }
+
+    // moved out rather than swapped, so that m_results keeps its capacity for the workers
+    std::pmr::vector<Result> finished(&frame.scratch);
+    {
+        std::lock_guard lock(m_mutex);
+        finished.reserve(m_results.size());
+        std::move(m_results.begin(), m_results.end(), std::back_inserter(finished));
+        m_results.clear();
+    }
+    for (auto& result : finished) {
+        m_stats.bakes++;
+        m_stats.total_bake_ms += result.bake_ms;
+        m_stats.max_bake_ms = std::max(m_stats.max_bake_ms, result.bake_ms);
+        // from before the world was replaced, the chunk might not even exist
+        if (result.generation != m_generation) continue;
+        auto& chunk = m_chunks[result.chunk];
+        // otherwise a newer bake of it is on the way, or it's not wanted anymore
+        if (chunk.in_view && chunk.requested && chunk.requested_revision == result.revision && chunk.requested_generation == result.generation) {
+            chunk.requested = false;
+            upload(result, frame.scratch);
+        }
+    }
+
+    m_left_view.clear();
+    std::set_difference(m_in_view.begin(), m_in_view.end(), chunks.begin(), chunks.end(), std::back_inserter(m_left_view));
+    for (const auto c : m_left_view) {
+        if (c < static_cast<int>(m_chunks.size())) {
+            drop(c);
+        }
+    }
+    m_in_view.assign(chunks.begin(), chunks.end());
+    for (const auto c : chunks) {
+        auto& chunk = m_chunks[c];
+        chunk.in_view = true;
+        const auto revision = revision_of(c, frame);
+        if (chunk.baked && chunk.revision == revision && chunk.generation == m_generation) {
+            continue;
+        }
+        if (chunk.requested && chunk.requested_revision == revision && chunk.requested_generation == m_generation) {
+            continue;
+        }
+        request(c, frame);
+    }
+
+    if (!(frame.hovered == m_hovered)) {
+        set_tint(m_hovered, WHITE, frame.scratch);
+        set_tint(frame.hovered, BLUE, frame.scratch);
+        m_hovered = frame.hovered;
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_stats.pending = static_cast<int>(m_jobs.size() + m_results.size()) + m_baking;
+}
+
+bool TerrainChunkBaker::draw(ChunkPlacement placement, const TerrainFrame& frame, Shader shader) {
+    if (placement.chunk >= static_cast<int>(m_chunks.size())) {
+        return false;
+    }
+    // a chunk that changed keeps being drawn as it was, until the new bake is uploaded
+    const auto& chunk = m_chunks[placement.chunk];
+    if (!chunk.baked) {
+        return false;
+    }
+    const auto origin = frame.world.chunk_bounds(placement.chunk).first;
+    const auto [x, y] = HexCoords::from_axial(origin.q + placement.wrap * frame.world.width, origin.r).to_world_unscaled();
+    const Matrix transform = MatrixTranslate(x, TERRAIN_HEIGHT, y);
+    for (const auto& mesh : chunk.meshes) {
+        const auto& model = frame.resources.m_hex_table[mesh.kind].model;
+        Material material = model.materials[model.meshMaterial[mesh.mesh]];
+        material.shader = shader;
+        DrawMesh(mesh.gpu, material, transform);
+        m_stats.draw_calls++;
+        m_stats.triangles += mesh.gpu.triangleCount;
+    }
+    return true;
+}
+
+void TerrainChunkBaker::unload() {
+    drop_all();
+    m_generation++;
+}
+
+void TerrainChunkBaker::bake_next() {
+    Job job;
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_jobs.empty()) {
+            // it was dropped
+            m_running--;
+            m_idle.notify_all();
+            return;
+        }
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_baking++;
+    }
+    auto result = bake(job);
+    std::lock_guard lock(m_mutex);
+    m_results.push_back(std::move(result));
+    m_baking--;
+    m_running--;
+    // under the lock, the destructor may be waiting to free the baker
+    m_idle.notify_all();
+}
+
+TerrainChunkBaker::Result TerrainChunkBaker::bake(const Job& job) {
+    PROFILE_ZONE("bake chunk");
+    const auto start = std::chrono::steady_clock::now();
+    Result result{.chunk = job.chunk, .revision = job.revision, .generation = job.generation, .meshes = {}, .bake_ms = 0.0};
+    const auto& kinds = *job.kinds;
+    const Matrix scaling = MatrixScale(job.scale, job.scale, job.scale);
+
+    for (int r = 0; r < job.size_r; r++) {
+        for (int q = 0; q < job.size_q; q++) {
+            const int local = q + r * WORLD_CHUNK_SIZE;
+            const int tileid = job.tiles[local];
+            if (tileid == -1) continue;
+            const auto& model = kinds[tileid].model;
+            // where DrawModelEx would put the tile, relative to the first hex of the chunk
+            const auto [x, y] = HexCoords::from_axial(q, r).to_world_unscaled();
+            const Matrix transform = MatrixMultiply(model.transform, MatrixMultiply(scaling, MatrixTranslate(x, 0.0f, y)));
+            const Matrix normal_matrix = MatrixTranspose(MatrixInvert(model.transform));
+
+            for (int m = 0; m < model.meshCount; m++) {
+                const auto& source = model.meshes[m];
+                auto baked = std::find_if(result.meshes.begin(), result.meshes.end(), [&](const BakedMesh& b) {
+                    return b.kind == tileid && b.mesh == m;
+                });
+                if (baked == result.meshes.end()) {
+                    baked = result.meshes.emplace(result.meshes.end());
+                    baked->kind = tileid;
+                    baked->mesh = m;
+                    baked->tile_vertices.assign(CHUNK_HEXES, {0, 0});
+                }
+                // indexed meshes are unrolled, merged meshes would outgrow 16 bit indices anyway
+                const int count = source.indices != nullptr ? source.triangleCount * 3 : source.vertexCount;
+                baked->tile_vertices[local] = {static_cast<int>(baked->vertices.size() / 3), count};
+                for (int k = 0; k < count; k++) {
+                    const int v = source.indices != nullptr ? source.indices[k] : k;
+                    const auto position = Vector3Transform(Vector3{source.vertices[v * 3], source.vertices[v * 3 + 1], source.vertices[v * 3 + 2]}, transform);
+                    baked->vertices.insert(baked->vertices.end(), {position.x, position.y, position.z});
+                    if (source.normals != nullptr) {
+                        const auto normal = Vector3Normalize(transform_direction(Vector3{source.normals[v * 3], source.normals[v * 3 + 1], source.normals[v * 3 + 2]}, normal_matrix));
+                        baked->normals.insert(baked->normals.end(), {normal.x, normal.y, normal.z});
+                    }
+                    if (source.texcoords != nullptr) {
+                        baked->texcoords.insert(baked->texcoords.end(), {source.texcoords[v * 2], source.texcoords[v * 2 + 1]});
+                    }
+                }
+                // white, so that single tiles can be tinted later
+                baked->colors.resize(baked->colors.size() + count * 4, 255);
+            }
+        }
+    }
+
+    result.bake_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void TerrainChunkBaker::request(int c, const TerrainFrame& frame) {
+    const auto& world = frame.world;
+    const auto& kinds = frame.resources.m_hex_table;
+    const auto [origin, size] = world.chunk_bounds(c);
+    Job job{
+        .chunk = c,
+        .revision = revision_of(c, frame),
+        .generation = m_generation,
+        .size_q = size.first,
+        .size_r = size.second,
+        .tiles = std::vector<int>(CHUNK_HEXES, -1),
+        .scale = frame.scale,
+        .kinds = &kinds
+    };
+    // the worker gets a copy, so the world can change while it's baking
+    for (int r = 0; r < job.size_r; r++) {
+        for (int q = 0; q < job.size_q; q++) {
+            const auto& hx = world.data[(origin.r + r) * world.width + origin.q + q];
+            if (frame.shows(hx)) {
+                job.tiles[q + r * WORLD_CHUNK_SIZE] = hx.tileid;
+            }
+        }
+    }
+
+    auto& chunk = m_chunks[c];
+    chunk.requested = true;
+    chunk.requested_revision = job.revision;
+    chunk.requested_generation = job.generation;
+    {
+        std::lock_guard lock(m_mutex);
+        auto queued = std::find_if(m_jobs.begin(), m_jobs.end(), [&](const Job& j) { return j.chunk == c; });
+        if (queued != m_jobs.end()) {
+            // its job is on the way already
+            *queued = std::move(job);
+            return;
+        }
+        m_jobs.push_back(std::move(job));
+        m_running++;
+    }
+    if (m_job_system != nullptr) {
+        m_job_system->submit([this] { bake_next(); });
+    } else {
+        bake_next();
+    }
+}
+
+void TerrainChunkBaker::upload(Result& result, std::pmr::memory_resource& scratch) {
+    auto& chunk = m_chunks[result.chunk];
+    free_meshes(chunk);
+    chunk.baked = true;
+    chunk.revision = result.revision;
+    chunk.generation = result.generation;
+    m_stats.chunks++;
+
+    for (auto& baked : result.meshes) {
+        Mesh gpu{};
+        gpu.vertexCount = static_cast<int>(baked.vertices.size() / 3);
+        gpu.triangleCount = gpu.vertexCount / 3;
+        gpu.vertices = baked.vertices.data();
+        gpu.normals = baked.normals.empty() ? nullptr : baked.normals.data();
+        gpu.texcoords = baked.texcoords.empty() ? nullptr : baked.texcoords.data();
+        gpu.colors = baked.colors.data();
+        UploadMesh(&gpu, false);
+        // the data stays in the vectors, raylib must not free it with the mesh
+        gpu.vertices = nullptr;
+        gpu.normals = nullptr;
+        gpu.texcoords = nullptr;
+        gpu.colors = nullptr;
+
+        const size_t bytes = mesh_bytes(gpu, !baked.normals.empty());
+        m_stats.meshes++;
+        m_stats.vertices += gpu.vertexCount;
+        m_stats.gpu_bytes += bytes;
+        chunk.meshes.push_back(ChunkMesh{.kind = baked.kind, .mesh = baked.mesh, .gpu = gpu, .bytes = bytes, .tile_vertices = std::move(baked.tile_vertices)});
+    }
+
+    if (locate(m_hovered).first == result.chunk) {
+        set_tint(m_hovered, BLUE, scratch);
+    }
+}
+
+void TerrainChunkBaker::free_meshes(Chunk& chunk) {
+    for (auto& mesh : chunk.meshes) {
+        m_stats.meshes--;
+        m_stats.vertices -= mesh.gpu.vertexCount;
+        m_stats.gpu_bytes -= mesh.bytes;
+        UnloadMesh(mesh.gpu);
+    }
+    chunk.meshes.clear();
+    if (chunk.baked) {
+        m_stats.chunks--;
+    }
+    chunk.baked = false;
+}
+
+void TerrainChunkBaker::drop(int c) {
+    auto& chunk = m_chunks[c];
+    free_meshes(chunk);
+    chunk.requested = false;
+    chunk.in_view = false;
+
+    std::lock_guard lock(m_mutex);
+    std::erase_if(m_jobs, [&](const Job& j) { return j.chunk == c; });
+}
+
+void TerrainChunkBaker::drop_all() {
+    for (size_t c = 0; c < m_chunks.size(); c++) {
+        drop(static_cast<int>(c));
+    }
+    std::lock_guard lock(m_mutex);
+    m_jobs.clear();
+    m_results.clear();
+}
+
+std::pair<int, int> TerrainChunkBaker::locate(HexCoords hc) const {
+    if (m_world_width <= 0 || hc.r < 0 || hc.r >= m_world_height) {
+        return {-1, -1};
+    }
+    const int q = positive_modulo(hc.q, m_world_width);
+    const int chunks_wide = (m_world_width + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+    const int chunk = (hc.r / WORLD_CHUNK_SIZE) * chunks_wide + q / WORLD_CHUNK_SIZE;
+    return {chunk, q % WORLD_CHUNK_SIZE + (hc.r % WORLD_CHUNK_SIZE) * WORLD_CHUNK_SIZE};
+}
+
+void TerrainChunkBaker::set_tint(HexCoords hc, Color tint, std::pmr::memory_resource& scratch) {
+    const auto [c, local] = locate(hc);
+    if (c == -1 || c >= static_cast<int>(m_chunks.size())) {
+        return;
+    }
+    std::pmr::vector<Color> colors(&scratch);
+    for (const auto& mesh : m_chunks[c].meshes) {
+        const auto [first, count] = mesh.tile_vertices[local];
+        if (count == 0) continue;
+        colors.assign(count, tint);
+        UpdateMeshBuffer(mesh.gpu, 3, colors.data(), count * static_cast<int>(sizeof(Color)), first * static_cast<int>(sizeof(Color)));
+    }
+}
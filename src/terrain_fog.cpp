@@ -0,0 +1,123 @@
+#include "terrain_fog.hpp"
+#include <algorithm>
+#include <rlgl.h>
+#include "profiler.hpp"
+
+namespace {
+// past this many row runs, a single upload of the whole texture is cheaper
+constexpr int MAX_PARTIAL_UPLOADS = 256;
+} // namespace
+
+unsigned char TerrainFog::texel_of(const HexData& hx) const {
+    // 0, 85, 170, 255 for NONE, FOG, NORMAL, SUPERIOR
+    return static_cast<unsigned char>(static_cast<int>(hx.getFractionVisibility(m_fraction)) * 85);
+}
+
+void TerrainFog::update(const CylinderHexWorld<HexData>& world, int fraction, VisibilityChanges& changes, std::pmr::memory_resource& scratch) {
+    PROFILE_ZONE("fog");
+    m_stats.uploads = 0;
+    m_stats.texels = 0;
+    if (world.width <= 0 || world.height <= 0) {
+        return;
+    }
+    if (m_texture.id == 0 || m_texture.width != world.width || m_texture.height != world.height || fraction != m_fraction) {
+        if (m_texture.id != 0 && (m_texture.width != world.width || m_texture.height != world.height)) {
+            UnloadTexture(m_texture);
+            m_texture = Texture2D{};
+        }
+        if (m_texture.id == 0) {
+            Image image{
+                .data = MemAlloc(world.width * world.height),
+                .width = world.width,
+                .height = world.height,
+                .mipmaps = 1,
+                .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE
+            };
+            m_texture = LoadTextureFromImage(image);
+            UnloadImage(image);
+        }
+        m_fraction = fraction;
+        changes.reset();
+    }
+
+    if (changes.everything) {
+        upload_all(world);
+    } else if (!changes.hexes.empty()) {
+        upload_changes(world, changes.hexes, scratch);
+    }
+    changes.hexes.clear();
+    changes.everything = false;
+}
+
+void TerrainFog::upload_all(const CylinderHexWorld<HexData>& world) {
+    m_scratch.resize(world.data.size());
+    for (size_t i = 0; i < world.data.size(); i++) {
+        m_scratch[i] = texel_of(world.data[i]);
+    }
+    UpdateTexture(m_texture, m_scratch.data());
+    m_stats.uploads++;
+    m_stats.texels += static_cast<int>(m_scratch.size());
+    m_stats.full_uploads++;
+}
+
+void TerrainFog::upload_changes(const CylinderHexWorld<HexData>& world, std::vector<HexKey>& hexes, std::pmr::memory_resource& scratch) {
+    // sorted by row, so that neighbouring hexes go up together
+    std::pmr::vector<std::pair<int, int>> rows(&scratch);
+    rows.reserve(hexes.size());
+    for (const auto key : hexes) {
+        const auto hc = key.coords();
+        if (hc.r >= 0 && hc.r < world.height) {
+            rows.emplace_back(hc.r, positive_modulo(hc.q, world.width));
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    int runs = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (i == 0 || rows[i].first != rows[i - 1].first || rows[i].second != rows[i - 1].second + 1) {
+            runs++;
+        }
+    }
+    if (runs > MAX_PARTIAL_UPLOADS) {
+        upload_all(world);
+        return;
+    }
+
+    for (size_t first = 0; first < rows.size(); ) {
+        size_t last = first;
+        while (last + 1 < rows.size() && rows[last + 1].first == rows[first].first && rows[last + 1].second == rows[last].second + 1) {
+            last++;
+        }
+        const auto [r, q] = rows[first];
+        const int length = static_cast<int>(last - first + 1);
+        m_scratch.resize(length);
+        for (int i = 0; i < length; i++) {
+            m_scratch[i] = texel_of(world.data[r * world.width + q + i]);
+        }
+        UpdateTextureRec(m_texture, Rectangle{static_cast<float>(q), static_cast<float>(r), static_cast<float>(length), 1.0f}, m_scratch.data());
+        m_stats.uploads++;
+        m_stats.texels += length;
+        first = last + 1;
+    }
+}
+
+void TerrainFog::bind() const {
+    rlActiveTextureSlot(TEXTURE_SLOT);
+    rlEnableTexture(m_texture.id);
+    rlActiveTextureSlot(0);
+}
+
+void TerrainFog::unbind() const {
+    rlActiveTextureSlot(TEXTURE_SLOT);
+    rlDisableTexture();
+    rlActiveTextureSlot(0);
+}
+
+void TerrainFog::unload() {
+    if (m_texture.id != 0) {
+        UnloadTexture(m_texture);
+        m_texture = Texture2D{};
+    }
+    m_fraction = -1;
+}
@@ -0,0 +1,53 @@
+#include "terrain_lod.hpp"
+#include <raymath.h>
+
+namespace {
+TerrainLod level_without_hysteresis(float distance, const TerrainLodSettings& settings) {
+    if (distance < settings.prism_distance) return TerrainLod::Full;
+    if (distance < settings.quad_distance) return TerrainLod::Prism;
+    return TerrainLod::Quad;
+}
+
+// the level stays until the distance gets far enough past the boundary
+TerrainLod level_with_hysteresis(TerrainLod current, float distance, const TerrainLodSettings& settings) {
+    const float boundaries[] = {settings.prism_distance, settings.quad_distance};
+    int level = static_cast<int>(current);
+    while (level < TERRAIN_LOD_COUNT - 1 && distance > boundaries[level] * (1.0f + settings.hysteresis)) {
+        level++;
+    }
+    while (level > 0 && distance < boundaries[level - 1] * (1.0f - settings.hysteresis)) {
+        level--;
+    }
+    return static_cast<TerrainLod>(level);
+}
+} // namespace
+
+bool TerrainLodSelector::update(Vector3 camera_position, const RenderingController& view, const CylinderHexWorld<HexData>& world) {
+    bool changed = false;
+    m_next.clear();
+    for (const auto placement : view.visible_placements()) {
+        const auto* previous = m_levels.find(key_of(placement));
+        TerrainLod level = TerrainLod::Full;
+        if (settings.enabled) {
+            const auto [origin, size] = world.chunk_bounds(placement.chunk);
+            // the middle of the chunk, where the camera sees it
+            const float q = origin.q + placement.wrap * world.width + (size.first - 1) / 2.0f;
+            const float r = origin.r + (size.second - 1) / 2.0f;
+            const Vector3 middle{sqrt3 * (q + r / 2.0f), 0.0f, 1.5f * r};
+            const float distance = Vector3Distance(camera_position, middle);
+            level = previous != nullptr ? level_with_hysteresis(*previous, distance, settings) : level_without_hysteresis(distance, settings);
+        }
+        changed |= previous == nullptr || *previous != level;
+        m_next.insert_or_assign(key_of(placement), level);
+    }
+    std::swap(m_levels, m_next);
+    if (changed) {
+        m_revision++;
+    }
+    return changed;
+}
+
+TerrainLod TerrainLodSelector::level_of(ChunkPlacement placement) const {
+    const auto* level = m_levels.find(key_of(placement));
+    return level != nullptr ? *level : TerrainLod::Full;
+}
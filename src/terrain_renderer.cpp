@@ -0,0 +1,536 @@
+#include "terrain_renderer.hpp"
+#include <cmath>
+#include <algorithm>
+#include <raymath.h>
+#include <rlgl.h>
+#include "utils.hpp"
+#include "profiler.hpp"
+
+namespace {
+// how tall the prisms, standing in for tiles at mid range, are
+constexpr float PRISM_HEIGHT = 0.2f;
+
+Color tint_of(HexCoords hc, const TerrainFrame& frame) {
+    return hc == frame.hovered ? BLUE : WHITE;
+}
+
+Matrix tile_transform(const Model& model, HexCoords hc, float scale) {
+    const auto [tx, ty] = hc.to_world_unscaled();
+    // what DrawModelEx does, without the rotation
+    const Matrix placed = MatrixMultiply(MatrixScale(scale, scale, scale), MatrixTranslate(tx, TERRAIN_HEIGHT, ty));
+    return MatrixMultiply(model.transform, placed);
+}
+
+// where the fog uniforms are, -1 for all when the shader didn't load
+template <typename FogShader>
+FogShader load_fog_shader(const char* vertex, const char* fragment) {
+    FogShader loaded{.shader = LoadShader(vertex, fragment)};
+    loaded.fog_texture = GetShaderLocation(loaded.shader, "fogTexture");
+    if (loaded.fog_texture != -1) {
+        loaded.world_size = GetShaderLocation(loaded.shader, "worldSize");
+        loaded.show_hidden = GetShaderLocation(loaded.shader, "showHidden");
+        loaded.model = GetShaderLocation(loaded.shader, "matModel");
+    }
+    return loaded;
+}
+
+size_t model_triangles(const Model& model) {
+    size_t triangles = 0;
+    for (int m = 0; m < model.meshCount; m++) {
+        triangles += model.meshes[m].triangleCount;
+    }
+    return triangles;
+}
+
+// Pointy topped hex prism, as wide as a tile, standing on y = 0. The sides are darker, so that the prisms
+// don't blend into each other with no lighting
+Mesh make_prism_mesh() {
+    constexpr int triangles = 6 + 6 * 2;
+    Mesh mesh{};
+    mesh.vertexCount = triangles * 3;
+    mesh.triangleCount = triangles;
+    mesh.vertices = static_cast<float*>(MemAlloc(mesh.vertexCount * 3 * sizeof(float)));
+    mesh.normals = static_cast<float*>(MemAlloc(mesh.vertexCount * 3 * sizeof(float)));
+    mesh.colors = static_cast<unsigned char*>(MemAlloc(mesh.vertexCount * 4));
+
+    std::array<Vector3, 6> top;
+    std::array<Vector3, 6> bottom;
+    for (int k = 0; k < 6; k++) {
+        const float angle = (30.0f + 60.0f * k) * DEG2RAD;
+        top[k] = Vector3{std::cos(angle), PRISM_HEIGHT, std::sin(angle)};
+        bottom[k] = Vector3{top[k].x, 0.0f, top[k].z};
+    }
+
+    int vertex = 0;
+    // counter clockwise seen from the outside, which is where the normal points
+    const auto add_triangle = [&](Vector3 a, Vector3 b, Vector3 c, Vector3 normal, unsigned char shade) {
+        const Vector3 cross = Vector3CrossProduct(Vector3Subtract(b, a), Vector3Subtract(c, a));
+        if (Vector3DotProduct(cross, normal) < 0.0f) {
+            std::swap(b, c);
+        }
+        for (const auto& v : {a, b, c}) {
+            mesh.vertices[vertex * 3] = v.x;
+            mesh.vertices[vertex * 3 + 1] = v.y;
+            mesh.vertices[vertex * 3 + 2] = v.z;
+            mesh.normals[vertex * 3] = normal.x;
+            mesh.normals[vertex * 3 + 1] = normal.y;
+            mesh.normals[vertex * 3 + 2] = normal.z;
+            mesh.colors[vertex * 4] = shade;
+            mesh.colors[vertex * 4 + 1] = shade;
+            mesh.colors[vertex * 4 + 2] = shade;
+            mesh.colors[vertex * 4 + 3] = 255;
+            vertex++;
+        }
+    };
+    const Vector3 up{0.0f, 1.0f, 0.0f};
+    const Vector3 middle{0.0f, PRISM_HEIGHT, 0.0f};
+    for (int k = 0; k < 6; k++) {
+        const int next = (k + 1) % 6;
+        add_triangle(middle, top[k], top[next], up, 255);
+        const Vector3 outwards = Vector3Normalize(Vector3{top[k].x + top[next].x, 0.0f, top[k].z + top[next].z});
+        add_triangle(top[k], bottom[k], bottom[next], outwards, 170);
+        add_triangle(top[k], bottom[next], top[next], outwards, 170);
+    }
+    UploadMesh(&mesh, false);
+    return mesh;
+}
+} // namespace
+
+void TerrainRenderer::load(JobSystem& jobs) {
+    m_chunks.load(jobs);
+    if (m_loaded) {
+        return;
+    }
+    m_prism = LoadModelFromMesh(make_prism_mesh());
+    m_single = load_fog_shader<FogShader>("resources/shaders/terrain.vs", "resources/shaders/terrain.fs");
+    m_instanced = load_fog_shader<FogShader>("resources/shaders/terrain_instanced.vs", "resources/shaders/terrain.fs");
+    m_loaded = true;
+    if (m_single.fog_texture == -1) {
+        logging::error("Terrain shader didn't load, there's no fog of war");
+    }
+    const int transform_location = GetShaderLocationAttrib(m_instanced.shader, "instanceTransform");
+    m_instance_tint_location = GetShaderLocationAttrib(m_instanced.shader, "instanceTint");
+    if (transform_location == -1 || m_instance_tint_location == -1) {
+        // the shader didn't load, raylib gave us the default one
+        m_instance_tint_location = -1;
+        mode = Mode::PerTile;
+        return;
+    }
+    m_instanced.shader.locs[SHADER_LOC_MATRIX_MODEL] = transform_location;
+}
+
+void TerrainRenderer::unload() {
+    m_chunks.unload();
+    m_fog.unload();
+    if (m_world_texture.id != 0) {
+        UnloadTexture(m_world_texture);
+        m_world_texture = Texture2D{};
+        m_texture_revisions.clear();
+    }
+    if (!m_loaded) {
+        return;
+    }
+    unload_instances(m_tiles);
+    unload_instances(m_prisms);
+    UnloadModel(m_prism);
+    m_prism = Model{};
+    UnloadShader(m_instanced.shader);
+    UnloadShader(m_single.shader);
+    m_instanced = FogShader{};
+    m_single = FogShader{};
+    m_loaded = false;
+    m_instance_tint_location = -1;
+}
+
+void TerrainRenderer::update_fog(const CylinderHexWorld<HexData>& world, int fraction, VisibilityChanges& changes, std::pmr::memory_resource& scratch) {
+    m_fog.update(world, fraction, changes, scratch);
+}
+
+void TerrainRenderer::set_fog_uniforms(const FogShader& fog_shader, const TerrainFrame& frame) {
+    if (fog_shader.fog_texture == -1) {
+        return;
+    }
+    const int slot = TerrainFog::TEXTURE_SLOT;
+    const int world_size[2] = {frame.world.width, frame.world.height};
+    const int show_hidden = frame.show_hidden ? 1 : 0;
+    SetShaderValue(fog_shader.shader, fog_shader.fog_texture, &slot, SHADER_UNIFORM_INT);
+    SetShaderValue(fog_shader.shader, fog_shader.world_size, world_size, SHADER_UNIFORM_IVEC2);
+    SetShaderValue(fog_shader.shader, fog_shader.show_hidden, &show_hidden, SHADER_UNIFORM_INT);
+}
+
+void TerrainRenderer::draw(const RenderingController& view, const TerrainFrame& frame) {
+    PROFILE_ZONE("terrain");
+    m_stats.draw_calls = 0;
+    m_stats.instances = 0;
+    m_stats.lods = {};
+    lod.update(frame.camera_position, view, frame.world);
+    for (const auto placement : view.visible_placements()) {
+        m_stats.lods[static_cast<int>(lod.level_of(placement))].chunks++;
+    }
+    set_fog_uniforms(m_single, frame);
+    set_fog_uniforms(m_instanced, frame);
+    m_fog.bind();
+
+    if (mode == Mode::Baked) {
+        draw_baked(view, frame);
+    } else if (mode == Mode::PerTile || !instancing_available()) {
+        draw_per_tile(view, frame);
+    } else {
+        draw_instanced(view, frame);
+    }
+    draw_prisms(view, frame);
+    draw_quads(view, frame);
+    m_fog.unbind();
+
+    for (const auto& counters : m_stats.lods) {
+        m_stats.draw_calls += counters.draw_calls;
+    }
+}
+
+TerrainRenderer::BuildKey TerrainRenderer::key_of(const RenderingController& view, const TerrainFrame& frame) const {
+    return BuildKey{
+        .view_revision = view.view_revision(),
+        .terrain_revision = frame.terrain_revision,
+        .lod_revision = lod.revision(),
+        .scale = frame.scale
+    };
+}
+
+template <typename F>
+void TerrainRenderer::for_each_tile_at(TerrainLod level, const RenderingController& view, const TerrainFrame& frame, F&& f) const {
+    const auto& world = frame.world;
+    if (world.width <= 0) {
+        return;
+    }
+    const int chunks_wide = world.chunks_wide();
+    for (const auto row : view.visible_rows()) {
+        const int chunk_row = row.r / WORLD_CHUNK_SIZE;
+        // the level is per chunk, so the row is walked a chunk at a time
+        for (int q = row.q_from; q <= row.q_to; ) {
+            const int normalized = positive_modulo(q, world.width);
+            const int column = normalized / WORLD_CHUNK_SIZE;
+            const int last = std::min(row.q_to, q + std::min((column + 1) * WORLD_CHUNK_SIZE, world.width) - normalized - 1);
+            const auto placement = ChunkPlacement{chunk_row * chunks_wide + column, (q - normalized) / world.width};
+            if (lod.level_of(placement) == level) {
+                const auto* hexes = &world.data[row.r * world.width + normalized];
+                for (int i = 0; i <= last - q; i++) {
+                    const auto& hx = hexes[i];
+                    if (frame.shows(hx)) {
+                        f(HexCoords::from_axial(q + i, row.r), hx);
+                    }
+                }
+            }
+            q = last + 1;
+        }
+    }
+}
+
+void TerrainRenderer::rebuild_tiles(const RenderingController& view, const TerrainFrame& frame) {
+    m_tiles.built_from = key_of(view, frame);
+    m_tiles.hovered = frame.hovered;
+    m_stats.rebuilds++;
+
+    const auto& kinds = frame.resources.m_hex_table;
+    if (m_tiles.batches.size() < kinds.size()) {
+        m_tiles.batches.resize(kinds.size());
+    }
+    for (auto& batch : m_tiles.batches) {
+        batch.transforms.clear();
+        batch.tints.clear();
+    }
+    m_tiles.instance_of.clear();
+    m_tiles.instance_of.reserve(view.visible_hex_count());
+
+    for_each_tile_at(TerrainLod::Full, view, frame, [&](HexCoords coords, const HexData& hx) {
+        auto& batch = m_tiles.batches[hx.tileid];
+        m_tiles.instance_of[HexKey::from(coords)] = {hx.tileid, static_cast<int>(batch.transforms.size())};
+        batch.transforms.push_back(tile_transform(kinds[hx.tileid].model, coords, frame.scale));
+        batch.tints.push_back(tint_of(coords, frame));
+    });
+
+    for (size_t kind = 0; kind < kinds.size(); kind++) {
+        if (!m_tiles.batches[kind].transforms.empty()) {
+            upload_tints(kinds[kind].model, m_tiles.batches[kind]);
+        }
+    }
+}
+
+void TerrainRenderer::rebuild_prisms(const RenderingController& view, const TerrainFrame& frame) {
+    m_prisms.built_from = key_of(view, frame);
+    m_prisms.hovered = frame.hovered;
+
+    const auto& kinds = frame.resources.m_hex_table;
+    m_prisms.batches.resize(1);
+    auto& batch = m_prisms.batches[0];
+    batch.transforms.clear();
+    batch.tints.clear();
+    m_prisms.instance_of.clear();
+
+    for_each_tile_at(TerrainLod::Prism, view, frame, [&](HexCoords coords, const HexData& hx) {
+        const auto [tx, ty] = coords.to_world_unscaled();
+        m_prisms.instance_of[HexKey::from(coords)] = {0, static_cast<int>(batch.transforms.size())};
+        batch.transforms.push_back(MatrixTranslate(tx, TERRAIN_HEIGHT, ty));
+        batch.tints.push_back(coords == frame.hovered ? BLUE : kinds[hx.tileid].color);
+    });
+    if (!batch.transforms.empty()) {
+        upload_tints(m_prism, batch);
+    }
+}
+
+void TerrainRenderer::upload_tints(const Model& model, KindBatch& batch) {
+    const int bytes = static_cast<int>(batch.tints.size() * sizeof(Color));
+    if (batch.tints.size() <= batch.buffer_capacity && batch.tint_buffers.size() == static_cast<size_t>(model.meshCount)) {
+        for (const auto buffer : batch.tint_buffers) {
+            rlUpdateVertexBuffer(buffer, batch.tints.data(), bytes, 0);
+        }
+        return;
+    }
+
+    // grow with some room, so that panning around doesn't reallocate every time
+    for (const auto buffer : batch.tint_buffers) {
+        rlUnloadVertexBuffer(buffer);
+    }
+    batch.tint_buffers.clear();
+    batch.buffer_capacity = std::max<size_t>(64, batch.tints.size() * 3 / 2);
+    std::vector<Color> initial(batch.buffer_capacity, WHITE);
+    std::copy(batch.tints.begin(), batch.tints.end(), initial.begin());
+    for (int m = 0; m < model.meshCount; m++) {
+        // the attribute is recorded in the mesh's vertex array, so DrawMeshInstanced picks it up on its own
+        rlEnableVertexArray(model.meshes[m].vaoId);
+        const unsigned int buffer = rlLoadVertexBuffer(initial.data(), static_cast<int>(initial.size() * sizeof(Color)), true);
+        rlSetVertexAttribute(m_instance_tint_location, 4, RL_UNSIGNED_BYTE, true, 0, 0);
+        rlSetVertexAttributeDivisor(m_instance_tint_location, 1);
+        rlEnableVertexAttribute(m_instance_tint_location);
+        rlDisableVertexArray();
+        batch.tint_buffers.push_back(buffer);
+    }
+}
+
+void TerrainRenderer::set_tint(InstanceSet& set, HexCoords hc, Color tint) {
+    const auto* at = set.instance_of.find(HexKey::from(hc));
+    if (at == nullptr) {
+        return;
+    }
+    const auto [kind, instance] = *at;
+    auto& batch = set.batches[kind];
+    batch.tints[instance] = tint;
+    for (const auto buffer : batch.tint_buffers) {
+        rlUpdateVertexBuffer(buffer, &batch.tints[instance], sizeof(Color), instance * sizeof(Color));
+    }
+}
+
+void TerrainRenderer::unload_instances(InstanceSet& set) {
+    for (auto& batch : set.batches) {
+        for (const auto buffer : batch.tint_buffers) {
+            rlUnloadVertexBuffer(buffer);
+        }
+    }
+    set.batches.clear();
+    set.instance_of.clear();
+    set.built_from.reset();
+}
+
+void TerrainRenderer::draw_batch(const KindBatch& batch, const Model& model, LodCounters& counters) {
+    const int instances = static_cast<int>(batch.transforms.size());
+    for (int m = 0; m < model.meshCount; m++) {
+        Material material = model.materials[model.meshMaterial[m]];
+        material.shader = m_instanced.shader;
+        DrawMeshInstanced(model.meshes[m], material, batch.transforms.data(), instances);
+        counters.draw_calls++;
+        counters.triangles += static_cast<size_t>(model.meshes[m].triangleCount) * instances;
+    }
+}
+
+void TerrainRenderer::draw_instanced(const RenderingController& view, const TerrainFrame& frame) {
+    if (m_tiles.built_from != key_of(view, frame)) {
+        rebuild_tiles(view, frame);
+    } else if (!(frame.hovered == m_tiles.hovered)) {
+        set_tint(m_tiles, m_tiles.hovered, WHITE);
+        set_tint(m_tiles, frame.hovered, BLUE);
+        m_tiles.hovered = frame.hovered;
+    }
+
+    const auto& kinds = frame.resources.m_hex_table;
+    for (size_t kind = 0; kind < kinds.size() && kind < m_tiles.batches.size(); kind++) {
+        const auto& batch = m_tiles.batches[kind];
+        if (batch.transforms.empty()) continue;
+        draw_batch(batch, kinds[kind].model, m_stats.lods[static_cast<int>(TerrainLod::Full)]);
+        m_stats.instances += static_cast<int>(batch.transforms.size());
+    }
+}
+
+void TerrainRenderer::draw_tile(HexCoords coords, const HexData& hx, const TerrainFrame& frame) {
+    if (!frame.shows(hx)) {
+        return;
+    }
+    const auto& model = frame.resources.m_hex_table[hx.tileid].model;
+    draw_model(model, tile_transform(model, coords, frame.scale), tint_of(coords, frame), m_stats.lods[static_cast<int>(TerrainLod::Full)]);
+    m_stats.instances++;
+}
+
+void TerrainRenderer::draw_model(const Model& model, const Matrix& transform, Color tint, LodCounters& counters) {
+    for (int m = 0; m < model.meshCount; m++) {
+        Material material = model.materials[model.meshMaterial[m]];
+        material.shader = m_single.shader;
+        // the maps are shared with the model, so the color is put back afterwards, like DrawModelEx does
+        auto& diffuse = material.maps[MATERIAL_MAP_DIFFUSE].color;
+        const Color color = diffuse;
+        diffuse = Color{
+            static_cast<unsigned char>(color.r * tint.r / 255),
+            static_cast<unsigned char>(color.g * tint.g / 255),
+            static_cast<unsigned char>(color.b * tint.b / 255),
+            static_cast<unsigned char>(color.a * tint.a / 255)
+        };
+        DrawMesh(model.meshes[m], material, transform);
+        diffuse = color;
+    }
+    counters.draw_calls += model.meshCount;
+    counters.triangles += model_triangles(model);
+}
+
+void TerrainRenderer::draw_per_tile(const RenderingController& view, const TerrainFrame& frame) {
+    for_each_tile_at(TerrainLod::Full, view, frame, [&](HexCoords coords, const HexData& hx) {
+        draw_tile(coords, hx, frame);
+    });
+}
+
+void TerrainRenderer::draw_baked(const RenderingController& view, const TerrainFrame& frame) {
+    m_full_chunks.clear();
+    for (const auto placement : view.visible_placements()) {
+        if (lod.level_of(placement) == TerrainLod::Full) {
+            m_full_chunks.push_back(placement.chunk);
+        }
+    }
+    std::sort(m_full_chunks.begin(), m_full_chunks.end());
+    m_full_chunks.erase(std::unique(m_full_chunks.begin(), m_full_chunks.end()), m_full_chunks.end());
+    m_chunks.update(m_full_chunks, frame);
+
+    for (const auto placement : view.visible_placements()) {
+        if (lod.level_of(placement) != TerrainLod::Full || m_chunks.draw(placement, frame, m_single.shader)) {
+            continue;
+        }
+        // not baked yet, so that there's no hole in the meantime
+        const auto [origin, size] = frame.world.chunk_bounds(placement.chunk);
+        for (int r = origin.r; r < origin.r + size.second; r++) {
+            for (int q = origin.q; q < origin.q + size.first; q++) {
+                draw_tile(HexCoords::from_axial(q + placement.wrap * frame.world.width, r), frame.world.data[r * frame.world.width + q], frame);
+            }
+        }
+    }
+    auto& counters = m_stats.lods[static_cast<int>(TerrainLod::Full)];
+    counters.draw_calls += m_chunks.stats().draw_calls;
+    counters.triangles += m_chunks.stats().triangles;
+}
+
+void TerrainRenderer::draw_prisms(const RenderingController& view, const TerrainFrame& frame) {
+    if (m_prism.meshCount == 0) {
+        return;
+    }
+    auto& counters = m_stats.lods[static_cast<int>(TerrainLod::Prism)];
+    if (!instancing_available()) {
+        for_each_tile_at(TerrainLod::Prism, view, frame, [&](HexCoords coords, const HexData& hx) {
+            const Color tint = coords == frame.hovered ? BLUE : frame.resources.m_hex_table[hx.tileid].color;
+            draw_model(m_prism, tile_transform(m_prism, coords, 1.0f), tint, counters);
+        });
+        return;
+    }
+
+    if (m_prisms.built_from != key_of(view, frame)) {
+        rebuild_prisms(view, frame);
+    } else if (!(frame.hovered == m_prisms.hovered)) {
+        // back to the colour of the kind
+        const int idx = frame.world.wrapped_index(m_prisms.hovered.q, m_prisms.hovered.r);
+        if (idx != -1 && frame.shows(frame.world.data[idx])) {
+            set_tint(m_prisms, m_prisms.hovered, frame.resources.m_hex_table[frame.world.data[idx].tileid].color);
+        }
+        set_tint(m_prisms, frame.hovered, BLUE);
+        m_prisms.hovered = frame.hovered;
+    }
+    if (!m_prisms.batches.empty() && !m_prisms.batches[0].transforms.empty()) {
+        draw_batch(m_prisms.batches[0], m_prism, counters);
+    }
+}
+
+void TerrainRenderer::update_world_texture(const RenderingController& view, const TerrainFrame& frame) {
+    const auto& world = frame.world;
+    if (m_world_texture.id == 0 || m_world_texture.width != world.width || m_world_texture.height != world.height) {
+        if (m_world_texture.id != 0) {
+            UnloadTexture(m_world_texture);
+        }
+        Image image = GenImageColor(world.width, world.height, BLANK);
+        m_world_texture = LoadTextureFromImage(image);
+        UnloadImage(image);
+        m_texture_revisions.assign(world.chunk_count(), std::nullopt);
+    }
+
+    // only the chunks that are drawn as quads are kept up to date
+    const auto& kinds = frame.resources.m_hex_table;
+    for (const auto placement : view.visible_placements()) {
+        const int c = placement.chunk;
+        const uint32_t revision = c < static_cast<int>(frame.chunk_revisions.size()) ? frame.chunk_revisions[c] : 0;
+        if (lod.level_of(placement) != TerrainLod::Quad || m_texture_revisions[c] == revision) {
+            continue;
+        }
+        const auto [origin, size] = world.chunk_bounds(c);
+        m_texture_scratch.resize(size.first * size.second);
+        for (int r = 0; r < size.second; r++) {
+            for (int q = 0; q < size.first; q++) {
+                const auto& hx = world.data[(origin.r + r) * world.width + origin.q + q];
+                m_texture_scratch[r * size.first + q] = frame.shows(hx) ? kinds[hx.tileid].color : BLANK;
+            }
+        }
+        const Rectangle area{static_cast<float>(origin.q), static_cast<float>(origin.r), static_cast<float>(size.first), static_cast<float>(size.second)};
+        UpdateTextureRec(m_world_texture, area, m_texture_scratch.data());
+        m_texture_revisions[c] = revision;
+    }
+}
+
+void TerrainRenderer::draw_quads(const RenderingController& view, const TerrainFrame& frame) {
+    auto& counters = m_stats.lods[static_cast<int>(TerrainLod::Quad)];
+    if (counters.chunks == 0) {
+        return;
+    }
+    update_world_texture(view, frame);
+
+    const auto& world = frame.world;
+    const float width = static_cast<float>(world.width);
+    const float height = static_cast<float>(world.height);
+    const float y = TERRAIN_HEIGHT + PRISM_HEIGHT;
+    // the texture is in axial coordinates, so a chunk is a parallelogram, with tile centers in the middle of the pixels
+    const auto corner = [&](float q, float r, float u, float v) {
+        rlTexCoord2f(u, v);
+        rlVertex3f(sqrt3 * (q + r / 2.0f), y, 1.5f * r);
+    };
+
+    // all of them go through raylib's batch, as a single draw. The vertices are already where they go in the world
+    BeginShaderMode(m_single.shader);
+    if (m_single.model != -1) {
+        SetShaderValueMatrix(m_single.shader, m_single.model, MatrixIdentity());
+    }
+    rlCheckRenderBatchLimit(counters.chunks * 4);
+    rlSetTexture(m_world_texture.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(255, 255, 255, 255);
+    rlNormal3f(0.0f, 1.0f, 0.0f);
+    for (const auto placement : view.visible_placements()) {
+        if (lod.level_of(placement) != TerrainLod::Quad) continue;
+        const auto [origin, size] = world.chunk_bounds(placement.chunk);
+        const float q0 = origin.q + placement.wrap * world.width - 0.5f;
+        const float q1 = q0 + size.first;
+        const float r0 = origin.r - 0.5f;
+        const float r1 = r0 + size.second;
+        const float u0 = origin.q / width;
+        const float u1 = (origin.q + size.first) / width;
+        const float v0 = origin.r / height;
+        const float v1 = (origin.r + size.second) / height;
+        corner(q0, r0, u0, v0);
+        corner(q0, r1, u0, v1);
+        corner(q1, r1, u1, v1);
+        corner(q1, r0, u1, v0);
+        counters.triangles += 2;
+    }
+    rlEnd();
+    rlSetTexture(0);
+    EndShaderMode();
+    counters.draw_calls++;
+}
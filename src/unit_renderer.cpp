@@ -0,0 +1,160 @@
+#include "unit_renderer.hpp"
+#include <raymath.h>
+#include "profiler.hpp"
+
+namespace {
+// how high above the ground units, and the ring around the selected one, are
+constexpr float UNIT_HEIGHT = 0.3f;
+constexpr float UNIT_RADIUS = 0.4f;
+
+Color unit_color(UnitType type, int fraction) {
+    Color color = GREEN;
+    if (type == UnitType::Millitary) {
+        color = RED;
+    } else if (type == UnitType::Special) {
+        color = YELLOW;
+    }
+    // every other fraction a bit darker, so that they can be told apart
+    const float shade = 1.0f - 0.15f * (fraction % 4);
+    return Color{
+        static_cast<unsigned char>(color.r * shade),
+        static_cast<unsigned char>(color.g * shade),
+        static_cast<unsigned char>(color.b * shade),
+        color.a
+    };
+}
+} // namespace
+
+void UnitRenderer::load() {
+    if (m_loaded) {
+        return;
+    }
+    m_body = GenMeshSphere(UNIT_RADIUS, 12, 16);
+    // the torus is made around the z axis, it's laid flat in the transforms
+    m_ring = GenMeshTorus(0.05f, 1.55f, 32, 8);
+    m_material = LoadMaterialDefault();
+    Shader shader = LoadShader("resources/shaders/units_instanced.vs", "resources/shaders/units_instanced.fs");
+    const int transform_location = GetShaderLocationAttrib(shader, "instanceTransform");
+    m_instancing = transform_location != -1;
+    if (m_instancing) {
+        shader.locs[SHADER_LOC_MATRIX_MODEL] = transform_location;
+        m_material.shader = shader;
+    } else {
+        // the shader didn't load, raylib gave us the default one
+        UnloadShader(shader);
+    }
+    m_loaded = true;
+}
+
+void UnitRenderer::unload() {
+    if (!m_loaded) {
+        return;
+    }
+    UnloadMesh(m_body);
+    UnloadMesh(m_ring);
+    // takes the shader with it
+    UnloadMaterial(m_material);
+    m_body = Mesh{};
+    m_ring = Mesh{};
+    m_material = Material{};
+    m_loaded = false;
+    m_instancing = false;
+}
+
+UnitRenderer::Batch& UnitRenderer::batch_of(UnitType type, int fraction) {
+    // only a handful of them, a search is fine
+    for (auto& batch : m_batches) {
+        if (batch.type == type && batch.fraction == fraction) {
+            return batch;
+        }
+    }
+    return m_batches.emplace_back(Batch{type, fraction, {}});
+}
+
+template <UnitType Type>
+void UnitRenderer::add_unit(const UnitStore& units, UnitHandle handle, Vector2 position) {
+    const auto* unit = units.get<Type>(handle);
+    batch_of(Type, unit->fraction).transforms.push_back(MatrixTranslate(position.x, UNIT_HEIGHT, position.y));
+    m_stats.units++;
+}
+
+Vector2 UnitRenderer::position_of(UnitHandle handle, HexCoords coords, int world_width, std::span<const UnitStep> steps, float alpha) const {
+    const auto [tx, ty] = coords.to_world_unscaled();
+    const Vector2 to{ tx, ty };
+    // only the units moving this tick, so a search is fine
+    for (const auto& step : steps) {
+        if (!(step.handle == handle)) continue;
+        // the step may go over the seam of the cylinder, it's taken the short way around
+        int dq = step.from.q - step.to.q;
+        if (dq > world_width / 2) {
+            dq -= world_width;
+        } else if (dq < -world_width / 2) {
+            dq += world_width;
+        }
+        const auto [fx, fy] = HexCoords::from_axial(coords.q + dq, coords.r + step.from.r - step.to.r).to_world_unscaled();
+        return Vector2Lerp(Vector2{ fx, fy }, to, alpha);
+    }
+    return to;
+}
+
+void UnitRenderer::draw(const RenderingController& view, const CylinderHexWorld<HexData>& world, const UnitStore& units, std::optional<HexCoords> selected,
+                        std::span<const UnitStep> steps, float alpha) {
+    PROFILE_ZONE("units");
+    m_stats = Stats{};
+    if (!m_loaded || world.width <= 0) {
+        return;
+    }
+    for (auto& batch : m_batches) {
+        batch.transforms.clear();
+    }
+    m_rings.clear();
+
+    for (const auto placement : view.visible_placements()) {
+        for (const auto tile : units.occupied_tiles_in_chunk(placement.chunk)) {
+            // the chunk may be only partly on screen
+            const auto coords = HexCoords::from_axial(tile % world.width + placement.wrap * world.width, tile / world.width);
+            if (!view.is_visible(coords)) continue;
+            // units share the tile's spot, the one on top is shown
+            const auto on_tile = units.get_all_on_hex(coords);
+            const auto [tx, ty] = coords.to_world_unscaled();
+            Vector2 position{ tx, ty };
+            if (on_tile.military.has_value()) {
+                position = position_of(*on_tile.military, coords, world.width, steps, alpha);
+                add_unit<UnitType::Millitary>(units, *on_tile.military, position);
+            } else if (on_tile.special.has_value()) {
+                position = position_of(*on_tile.special, coords, world.width, steps, alpha);
+                add_unit<UnitType::Special>(units, *on_tile.special, position);
+            } else if (on_tile.civilian.has_value()) {
+                position = position_of(*on_tile.civilian, coords, world.width, steps, alpha);
+                add_unit<UnitType::Civilian>(units, *on_tile.civilian, position);
+            }
+            if (selected.has_value() && units.tile_index(*selected) == tile) {
+                // the ring goes along with the unit
+                m_rings.push_back(MatrixMultiply(MatrixRotateX(90.0f * DEG2RAD), MatrixTranslate(position.x, UNIT_HEIGHT, position.y)));
+            }
+        }
+    }
+
+    for (const auto& batch : m_batches) {
+        if (batch.transforms.empty()) continue;
+        draw_instances(m_body, unit_color(batch.type, batch.fraction), batch.transforms);
+        m_stats.batches++;
+    }
+    if (!m_rings.empty()) {
+        draw_instances(m_ring, RED, m_rings);
+        m_stats.batches++;
+    }
+}
+
+void UnitRenderer::draw_instances(const Mesh& mesh, Color color, std::span<const Matrix> transforms) {
+    m_material.maps[MATERIAL_MAP_DIFFUSE].color = color;
+    if (m_instancing) {
+        DrawMeshInstanced(mesh, m_material, transforms.data(), static_cast<int>(transforms.size()));
+        m_stats.draw_calls++;
+        return;
+    }
+    for (const auto& transform : transforms) {
+        DrawMesh(mesh, m_material, transform);
+        m_stats.draw_calls++;
+    }
+}
@@ -0,0 +1,358 @@
+#include "worldgen.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+#include <variant>
+#include "job_system.hpp"
+#include "profiler.hpp"
+
+void WorldGenMap::SetSize(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        throw sol::error("setSize: the map has to be at least 1x1");
+    }
+    world = CylinderHexWorld<HexData>(width, height, {}, {});
+}
+
+void WorldGenMap::SetTileCoords(int new_mode) {
+    if (new_mode != AXIAL && new_mode != OFFSET) {
+        throw sol::error("setTileCoords: the mode is either Map.AXIAL or Map.OFFSET");
+    }
+    mode = new_mode;
+}
+
+int WorldGenMap::IndexOf(int x, int y) const {
+    const int row = y - 1;
+    if (row < 0 || row >= world.height) {
+        throw sol::error("y = " + std::to_string(y) + " is outside of the map");
+    }
+    const int q = mode == AXIAL ? x - 1 : HexCoords::from_offset(x - 1, row).q;
+    return world.wrapped_index(q, row);
+}
+
+void WorldGenMap::SetTileAt(int x, int y, int tile) {
+    world.data[IndexOf(x, y)].tileid = tile;
+}
+
+int WorldGenMap::GetTileAt(int x, int y) const {
+    return world.data[IndexOf(x, y)].tileid;
+}
+
+void WorldGenMap::FillRow(int y, sol::table tiles, sol::optional<int> first_x) {
+    const int x0 = first_x.value_or(1);
+    const int count = static_cast<int>(tiles.size());
+    for (int i = 0; i < count; i++) {
+        world.data[IndexOf(x0 + i, y)].tileid = tiles.raw_get<int>(i + 1);
+    }
+}
+
+void WorldGenMap::FillRect(int x, int y, int w, int h, int tile) {
+    for (int row = y; row < y + h; row++) {
+        for (int column = x; column < x + w; column++) {
+            world.data[IndexOf(column, row)].tileid = tile;
+        }
+    }
+}
+
+std::tuple<void*, int> WorldGenMap::RawTiles() {
+    static_assert(std::is_standard_layout_v<HexData> && offsetof(HexData, tileid) == 0, "FFI code expects the tile id at the start of HexData");
+    static_assert(sizeof(decltype(HexData::tileid)) == sizeof(int32_t) && sizeof(HexData) % sizeof(int32_t) == 0, "FFI code walks the tiles as int32_ts");
+    return {static_cast<void*>(world.data.data()), static_cast<int>(sizeof(HexData) / sizeof(int32_t))};
+}
+
+void WorldGenMap::ReportProgress(double fraction) {
+    if (task == nullptr) {
+        return;
+    }
+    task->progress = static_cast<float>(std::clamp(fraction, 0.0, 1.0));
+    if (task->cancel_requested) {
+        throw sol::error("the world generation was cancelled");
+    }
+}
+
+bool WorldGenMap::Cancelled() const {
+    return task != nullptr && task->cancel_requested;
+}
+
+void WorldGenMap::RegisterUsertype(sol::state_view lua) {
+    lua.new_usertype<WorldGenMap>("WorldGenMap",
+        sol::no_constructor,
+        "AXIAL", sol::var(AXIAL),
+        "OFFSET", sol::var(OFFSET),
+        "width", sol::readonly_property([](const WorldGenMap& map) { return map.world.width; }),
+        "height", sol::readonly_property([](const WorldGenMap& map) { return map.world.height; }),
+        "setSize", &WorldGenMap::SetSize,
+        "setTileCoords", &WorldGenMap::SetTileCoords,
+        "setTileAt", &WorldGenMap::SetTileAt,
+        "getTileAt", &WorldGenMap::GetTileAt,
+        "fillRow", &WorldGenMap::FillRow,
+        "fillRect", &WorldGenMap::FillRect,
+        "rawTiles", &WorldGenMap::RawTiles,
+        "reportProgress", &WorldGenMap::ReportProgress,
+        "cancelled", &WorldGenMap::Cancelled
+    );
+}
+
+int WorldGenChunk::IndexOf(int x, int y) const {
+    const int q = x - 1;
+    const int r = y - 1;
+    if (q < q0 || q >= q0 + width || r < r0 || r >= r0 + height) {
+        throw sol::error("(" + std::to_string(x) + ", " + std::to_string(y) + ") is outside of chunk " + std::to_string(index));
+    }
+    return r * world->width + q;
+}
+
+void WorldGenChunk::SetTileAt(int x, int y, int tile) {
+    world->data[IndexOf(x, y)].tileid = tile;
+}
+
+int WorldGenChunk::GetTileAt(int x, int y) const {
+    return world->data[IndexOf(x, y)].tileid;
+}
+
+void WorldGenChunk::FillRow(int y, sol::table tiles, sol::optional<int> first_x) {
+    const int x0 = first_x.value_or(q0 + 1);
+    const int count = static_cast<int>(tiles.size());
+    for (int i = 0; i < count; i++) {
+        world->data[IndexOf(x0 + i, y)].tileid = tiles.raw_get<int>(i + 1);
+    }
+}
+
+void WorldGenChunk::FillRect(int x, int y, int w, int h, int tile) {
+    for (int row = y; row < y + h; row++) {
+        for (int column = x; column < x + w; column++) {
+            world->data[IndexOf(column, row)].tileid = tile;
+        }
+    }
+}
+
+std::tuple<void*, int> WorldGenChunk::RawTiles() {
+    return {static_cast<void*>(world->data.data()), static_cast<int>(sizeof(HexData) / sizeof(int32_t))};
+}
+
+void WorldGenChunk::RegisterUsertype(sol::state_view lua) {
+    lua.new_usertype<WorldGenChunk>("WorldGenChunk",
+        sol::no_constructor,
+        "x", sol::readonly_property([](const WorldGenChunk& chunk) { return chunk.q0 + 1; }),
+        "y", sol::readonly_property([](const WorldGenChunk& chunk) { return chunk.r0 + 1; }),
+        "width", sol::readonly(&WorldGenChunk::width),
+        "height", sol::readonly(&WorldGenChunk::height),
+        "index", sol::readonly(&WorldGenChunk::index),
+        "seed", sol::readonly(&WorldGenChunk::seed),
+        "worldSeed", sol::readonly(&WorldGenChunk::world_seed),
+        "worldWidth", sol::readonly_property([](const WorldGenChunk& chunk) { return chunk.world->width; }),
+        "worldHeight", sol::readonly_property([](const WorldGenChunk& chunk) { return chunk.world->height; }),
+        "setTileAt", &WorldGenChunk::SetTileAt,
+        "getTileAt", &WorldGenChunk::GetTileAt,
+        "fillRow", &WorldGenChunk::FillRow,
+        "fillRect", &WorldGenChunk::FillRect,
+        "rawTiles", &WorldGenChunk::RawTiles
+    );
+}
+
+uint32_t ChunkSeed(uint32_t world_seed, int chunk) {
+    // splitmix64 of both, so that neighbouring chunks get seeds that have nothing in common
+    uint64_t z = ((static_cast<uint64_t>(world_seed) << 32) | static_cast<uint32_t>(chunk)) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+namespace {
+// The generators get the options as a table of name = value
+sol::table OptionsTable(sol::state_view lua, const WorldGenOptions& options) {
+    auto table = lua.create_table();
+    for (const auto& [name, value] : options) {
+        std::visit([&](const auto& v) { table[name] = v; }, value);
+    }
+    return table;
+}
+
+// What the VMs of a chunked generator share. Each VM takes the next chunk nobody has taken yet, until there are none left
+struct ChunkQueue {
+    CylinderHexWorld<HexData>& world;
+    const WorldGenOptions& options;
+    uint32_t world_seed;
+    WorldGenTask* task;
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+    // a chunk failed, or the task was cancelled - everyone stops
+    std::atomic<bool> failed{false};
+};
+
+void RunChunks(const sol::protected_function& generator, ChunkQueue& queue) {
+    PROFILE_ZONE("worldgen chunks");
+    sol::state_view lua(generator.lua_state());
+    WorldGenChunk::RegisterUsertype(lua);
+    sol::optional<sol::protected_function> randomseed = lua["math"]["randomseed"];
+    const auto options_table = OptionsTable(lua, queue.options);
+    const int count = queue.world.chunk_count();
+    try {
+        for (int chunk = queue.next++; chunk < count && !queue.failed; chunk = queue.next++) {
+            if (queue.task != nullptr && queue.task->cancel_requested) {
+                queue.failed = true;
+                return;
+            }
+            const auto [origin, size] = queue.world.chunk_bounds(chunk);
+            WorldGenChunk c{&queue.world, chunk, origin.q, origin.r, size.first, size.second, ChunkSeed(queue.world_seed, chunk), queue.world_seed};
+            // whatever the previous chunk left in the generator of this VM, math.random starts over
+            if (randomseed.has_value()) {
+                randomseed.value().call(c.seed);
+            }
+            sol::protected_function_result res = generator.call(&c, options_table);
+            if (!res.valid()) {
+                sol::error err = res;
+                logging::error("World gen failed on chunk", chunk, "-", err.what());
+                queue.failed = true;
+                return;
+            }
+            const int finished = ++queue.done;
+            if (queue.task != nullptr) {
+                queue.task->progress = static_cast<float>(finished) / count;
+            }
+        }
+    } catch (std::exception& e) {
+        logging::error("World gen failed:", e.what());
+        queue.failed = true;
+    }
+}
+}
+
+std::optional<CylinderHexWorld<HexData>> GenerateWorldChunked(const WorldGen& gen, const WorldGenOptions& options, JobSystem* jobs, const WorldGenVMFactory& make_vm, int vm_count, WorldGenTask* task) {
+    PROFILE_ZONE("worldgen chunked");
+    if (!gen.chunked.has_value()) {
+        return {};
+    }
+    uint32_t world_seed = 2137;
+    if (const auto it = options.find("seed"); it != options.end() && std::holds_alternative<double>(it->second)) {
+        world_seed = static_cast<uint32_t>(static_cast<int64_t>(std::get<double>(it->second)));
+    }
+
+    CylinderHexWorld<HexData> world(gen.chunked->width, gen.chunked->height, {}, {});
+    ChunkQueue queue{world, options, world_seed, task};
+    if (jobs != nullptr && make_vm) {
+        const int vms = std::clamp(vm_count > 0 ? vm_count : jobs->worker_count() + 1, 1, world.chunk_count());
+        jobs->parallel_for(0, vms, 1, [&](int) {
+            // the generator has to go before its VM does
+            auto instance = make_vm(gen.entry_point);
+            if (!instance.has_value()) {
+                logging::error("Couldn't make a VM for the world generator", gen.name);
+                queue.failed = true;
+                return;
+            }
+            const auto generator = FindGeneratorFunction(instance->root, gen.name);
+            if (!generator.has_value()) {
+                logging::error("The module of", gen.name, "didn't declare it again in another VM");
+                queue.failed = true;
+                return;
+            }
+            RunChunks(generator.value(), queue);
+        });
+    } else {
+        RunChunks(gen.generator, queue);
+    }
+
+    if (task != nullptr && task->cancel_requested) {
+        logging::info("World generation cancelled");
+        return {};
+    }
+    if (queue.failed) {
+        return {};
+    }
+    return world;
+}
+
+std::optional<CylinderHexWorld<HexData>> GenerateWorld(const WorldGen& gen, const WorldGenOptions& options) {
+    if (gen.chunked.has_value()) {
+        return GenerateWorldChunked(gen, options);
+    }
+    return GenerateWorld(gen.generator, options);
+}
+
+std::optional<CylinderHexWorld<HexData>> GenerateWorld(const sol::protected_function& generator, const WorldGenOptions& options, WorldGenTask* task) {
+    PROFILE_ZONE("worldgen");
+
+    // the generator runs in the VM it came from
+    sol::state_view lua(generator.lua_state());
+    WorldGenMap::RegisterUsertype(lua);
+    WorldGenMap map;
+    map.task = task;
+    const auto options_table = OptionsTable(lua, options);
+    try {
+        sol::protected_function_result res;
+        {
+            PROFILE_ZONE("lua: worldgen");
+            res = generator.call(&map, options_table);
+        }
+        if (res.status() != sol::call_status::ok) {
+            if (map.Cancelled()) {
+                logging::info("World generation cancelled");
+                return {};
+            }
+            sol::error err = res;
+            std::cerr << "Failed to run the world gen. Status = " << static_cast<int>(res.status()) << '\n';
+            std::cerr << "Stack top: " << err.what() << '\n';
+            return {};
+        }
+        return std::move(map.world);
+    } catch (std::exception& e) {
+        std::cerr << "World Gen failed: " << e.what() << '\n';
+    } catch (...) {
+        std::cerr << "World gen somehow failed\n";
+    }
+    return {};
+}
+
+sol::optional<sol::protected_function> FindGeneratorFunction(const sol::table& module_root, const std::string& name) {
+    sol::optional<sol::table> generators = module_root["declarations"]["world_generators"];
+    if (!generators.has_value()) {
+        return {};
+    }
+    for (const auto& [_, value] : generators.value()) {
+        if (value.get_type() != sol::type::table) continue;
+        sol::table gen = value;
+        sol::optional<std::string> gen_name = gen["name"];
+        if (gen_name.has_value() && gen_name.value() == name) {
+            return gen["generator"].get<sol::optional<sol::protected_function>>();
+        }
+    }
+    return {};
+}
+
+std::shared_ptr<WorldGenTask> GenerateWorldAsync(const WorldGen& gen, WorldGenOptions options, JobSystem& jobs, WorldGenVMFactory make_vm, std::function<void(WorldGenTask&)> on_finished) {
+    auto task = std::make_shared<WorldGenTask>();
+    task->on_finished = std::move(on_finished);
+    // a long job, a thread waiting for something else mustn't end up making the whole world
+    const auto job = jobs.submit_long([task, &gen, &jobs, options = std::move(options), make_vm = std::move(make_vm)] {
+        PROFILE_ZONE("worldgen job");
+        if (task->cancel_requested) {
+            return;
+        }
+        if (gen.chunked.has_value()) {
+            task->result = GenerateWorldChunked(gen, options, &jobs, make_vm, 0, task.get());
+            return;
+        }
+        // the VM of the module belongs to the main thread, this one is the worker's alone
+        auto instance = make_vm(gen.entry_point);
+        if (!instance.has_value()) {
+            logging::error("Couldn't make a VM for the world generator", gen.name);
+            return;
+        }
+        const auto generator = FindGeneratorFunction(instance->root, gen.name);
+        if (!generator.has_value()) {
+            logging::error("The module of", gen.name, "didn't declare it again in another VM");
+            return;
+        }
+        task->result = GenerateWorld(generator.value(), options, task.get());
+    });
+    // the worker is done with the task when this runs, the main thread has it to itself
+    jobs.then_on_main_thread(job, [task] {
+        task->finished = true;
+        task->succeeded = task->result.has_value() && !task->cancel_requested;
+        if (task->on_finished) {
+            task->on_finished(*task);
+        }
+    });
+    return task;
+}
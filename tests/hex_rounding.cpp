@@ -0,0 +1,63 @@
+// Checks HexCoords::rounded_to_hex on fractional coordinates right next to hex edges, where a
+// rounding mistake puts the point in the wrong hex. Returns 1 if any point lands wrong
+#include <array>
+#include <iostream>
+#include "hex.hpp"
+
+namespace {
+constexpr float ACROSS = 0.02f; // how far from the edge the points are, in hex widths
+constexpr int ALONG = 20; // points per edge
+
+struct Cube {
+    float q, r, s;
+};
+
+Cube lerp(Cube a, Cube b, float t) {
+    return {a.q + (b.q - a.q) * t, a.r + (b.r - a.r) * t, a.s + (b.s - a.s) * t};
+}
+
+// the corner between the edges towards directions a and b
+Cube corner(HexCoords hc, int a, int b) {
+    const auto [aq, ar] = axial_directions[a];
+    const auto [bq, br] = axial_directions[b];
+    const float q = (aq + bq) / 3.0f;
+    const float r = (ar + br) / 3.0f;
+    return {hc.q + q, hc.r + r, hc.s - q - r};
+}
+
+int check(HexCoords expected, Cube at) {
+    const auto got = HexCoords::rounded_to_hex(at.q, at.r, at.s);
+    if (got == expected) {
+        return 0;
+    }
+    std::cerr << "(" << at.q << ", " << at.r << ", " << at.s << ") rounded to (" << got.q << ", " << got.r << ", " << got.s
+              << "), expected (" << expected.q << ", " << expected.r << ", " << expected.s << ")\n";
+    return 1;
+}
+}
+
+int main() {
+    int failures = 0;
+    for (const auto hc : HexCoords::from_axial(0, 0).spiral(3)) {
+        for (int edge = 0; edge < 6; edge++) {
+            const auto [dq, dr] = axial_directions[edge];
+            const HexCoords neighbour{hc.q + dq, hc.r + dr, hc.s - dq - dr};
+            const auto from = corner(hc, (edge + 5) % 6, edge);
+            const auto to = corner(hc, edge, (edge + 1) % 6);
+            // skipping the corners themselves, three hexes are equally close there
+            for (int i = 1; i < ALONG; i++) {
+                const auto on_edge = lerp(from, to, static_cast<float>(i) / ALONG);
+                const Cube inside{on_edge.q - dq * ACROSS, on_edge.r - dr * ACROSS, on_edge.s + (dq + dr) * ACROSS};
+                const Cube outside{on_edge.q + dq * ACROSS, on_edge.r + dr * ACROSS, on_edge.s - (dq + dr) * ACROSS};
+                failures += check(hc, inside);
+                failures += check(neighbour, outside);
+            }
+        }
+    }
+    if (failures > 0) {
+        std::cerr << failures << " points rounded to the wrong hex\n";
+        return 1;
+    }
+    std::cout << "hex rounding ok\n";
+    return 0;
+}